@@ -23,6 +23,7 @@
 #include <cmath>
 #include <sstream>
 #include <stdexcept>
+#include <algorithm>
 
 #ifndef CLOTHOID_ASSERT
   #define CLOTHOID_ASSERT(COND,MSG)         \
@@ -522,6 +523,21 @@ namespace Clothoid {
   // -------------------------------------------------------------------------
   // -------------------------------------------------------------------------
 
+  //! \cond NODOC
+  // integrals with c = 0
+  static
+  inline
+  void
+  evalXY( valueType   a,
+          valueType   b,
+          valueType & xx,
+          valueType & yy ) {
+    if      ( a == 0 )                   evalXYazero( 1, b, &xx, &yy ) ; // segment or circle arc
+    else if ( std::abs(a) < A_THRESOLD ) evalXYaSmall( a, b, A_SERIE_SIZE, xx, yy ) ;
+    else                                 evalXYaLarge( a, b, xx, yy ) ;
+  }
+  //! \endcond
+
   void
   GeneralizedFresnelCS( valueType   a,
                         valueType   b,
@@ -530,8 +546,7 @@ namespace Clothoid {
                         valueType & intS ) {
 
     valueType xx, yy ;
-    if ( std::abs(a) < A_THRESOLD ) evalXYaSmall( a, b, A_SERIE_SIZE, xx, yy ) ;
-    else                            evalXYaLarge( a, b, xx, yy ) ;
+    evalXY( a, b, xx, yy ) ;
 
     valueType cosc = cos(c) ;
     valueType sinc = sin(c) ;
@@ -540,6 +555,21 @@ namespace Clothoid {
     intS = xx * sinc + yy * cosc ;
   }
 
+  void
+  GeneralizedFresnelCS( valueType   a,
+                        valueType   b,
+                        valueType   cosc,
+                        valueType   sinc,
+                        valueType & intC,
+                        valueType & intS ) {
+
+    valueType xx, yy ;
+    evalXY( a, b, xx, yy ) ;
+
+    intC = xx * cosc - yy * sinc ;
+    intS = xx * sinc + yy * cosc ;
+  }
+
   // -------------------------------------------------------------------------
   // -------------------------------------------------------------------------
   
@@ -553,8 +583,9 @@ namespace Clothoid {
 
     CLOTHOID_ASSERT( nk > 0 && nk < 4, "nk = " << nk << " must be in 1..3" ) ;
 
-    if ( std::abs(a) < A_THRESOLD ) evalXYaSmall( nk, a, b, A_SERIE_SIZE, intC, intS ) ;
-    else                            evalXYaLarge( nk, a, b, intC, intS ) ;
+    if      ( a == 0 )                   evalXYazero( nk, b, intC, intS ) ; // segment or circle arc
+    else if ( std::abs(a) < A_THRESOLD ) evalXYaSmall( nk, a, b, A_SERIE_SIZE, intC, intS ) ;
+    else                                 evalXYaLarge( nk, a, b, intC, intS ) ;
 
     valueType cosc = cos(c) ;
     valueType sinc = sin(c) ;
@@ -788,28 +819,332 @@ namespace Clothoid {
     y_D = sin(theta)*scale ;
   }
 
+  //! \cond NODOC
+
+  // second and third derivatives of the offset curve with heading `theta`
+  // and curvature `theta_D`, shared with ClothoidEvaluator
+  static
+  inline
   void
-  ClothoidCurve::eval_DD( valueType s, valueType offs, valueType & x_DD, valueType & y_DD ) const {
-    valueType theta   = theta0 + s*(k+s*(dk/2)) ;
-    valueType theta_D = k+s*dk ;
-    valueType C       = cos(theta) ;
-    valueType S       = sin(theta) ;
-    valueType tmp1    = theta_D*(1-theta_D*offs) ;
-    valueType tmp2    = offs*dk ;
+  offsetEval_DD( valueType   theta,
+                 valueType   theta_D,
+                 valueType   dk,
+                 valueType   offs,
+                 valueType & x_DD,
+                 valueType & y_DD ) {
+    valueType C    = cos(theta) ;
+    valueType S    = sin(theta) ;
+    valueType tmp1 = theta_D*(1-theta_D*offs) ;
+    valueType tmp2 = offs*dk ;
     x_DD = -tmp1*S - C*tmp2 ;
     y_DD =  tmp1*C - S*tmp2 ;
   }
 
+  static
+  inline
+  void
+  offsetEval_DDD( valueType   theta,
+                  valueType   theta_D,
+                  valueType   dk,
+                  valueType   offs,
+                  valueType & x_DDD,
+                  valueType & y_DDD ) {
+    valueType C    = cos(theta) ;
+    valueType S    = sin(theta) ;
+    valueType tmp1 = theta_D*theta_D*(theta_D*offs-1) ;
+    valueType tmp2 = dk*(1-3*theta_D*offs) ;
+    x_DDD = tmp1*C-tmp2*S ;
+    y_DDD = tmp1*S+tmp2*C ;
+  }
+
+  //! \endcond
+
+  void
+  ClothoidCurve::eval_DD( valueType s, valueType offs, valueType & x_DD, valueType & y_DD ) const {
+    offsetEval_DD( theta0 + s*(k+s*(dk/2)), k+s*dk, dk, offs, x_DD, y_DD ) ;
+  }
+
   void
   ClothoidCurve::eval_DDD( valueType s, valueType offs, valueType & x_DDD, valueType & y_DDD ) const {
+    offsetEval_DDD( theta0 + s*(k+s*(dk/2)), k+s*dk, dk, offs, x_DDD, y_DDD ) ;
+  }
+
+  // ---------------------------------------------------------------------------
+  // ---------------------------------------------------------------------------
+
+  void
+  ClothoidEvaluator::setup( ClothoidCurve const & c ) {
+    x0         = c.x0 ;
+    y0         = c.y0 ;
+    theta0     = c.theta0 ;
+    k          = c.k ;
+    dk         = c.dk ;
+    s_min      = c.s_min ;
+    s_max      = c.s_max ;
+    cos_theta0 = cos(theta0) ;
+    sin_theta0 = sin(theta0) ;
+  }
+
+  void
+  ClothoidEvaluator::eval( valueType   s,
+                           valueType & theta,
+                           valueType & kappa,
+                           valueType & x,
+                           valueType & y ) const {
+    valueType X, Y ;
+    evalXY( dk*s*s, k*s, X, Y ) ;
+    x = x0 + s*(X * cos_theta0 - Y * sin_theta0) ;
+    y = y0 + s*(X * sin_theta0 + Y * cos_theta0) ;
+    theta = theta0 + s*(k+s*(dk/2)) ;
+    kappa = k + s*dk ;
+  }
+
+  void
+  ClothoidEvaluator::eval( valueType s, valueType & x, valueType & y ) const {
+    valueType X, Y ;
+    evalXY( dk*s*s, k*s, X, Y ) ;
+    x = x0 + s*(X * cos_theta0 - Y * sin_theta0) ;
+    y = y0 + s*(X * sin_theta0 + Y * cos_theta0) ;
+  }
+
+  void
+  ClothoidEvaluator::eval_D( valueType s, valueType & x_D, valueType & y_D ) const {
+    if ( k == 0 && dk == 0 ) { x_D = cos_theta0 ; y_D = sin_theta0 ; return ; }
+    valueType theta = theta0 + s*(k+s*(dk/2)) ;
+    x_D = cos(theta) ;
+    y_D = sin(theta) ;
+  }
+
+  void
+  ClothoidEvaluator::eval_DD( valueType s, valueType & x_DD, valueType & y_DD ) const {
+    eval_DD( s, 0, x_DD, y_DD ) ;
+  }
+
+  void
+  ClothoidEvaluator::eval_DDD( valueType s, valueType & x_DDD, valueType & y_DDD ) const {
+    eval_DDD( s, 0, x_DDD, y_DDD ) ;
+  }
+
+  void
+  ClothoidEvaluator::evalTangent( valueType   s,
+                                  valueType   offs,
+                                  valueType & x,
+                                  valueType & y,
+                                  valueType & tx,
+                                  valueType & ty ) const {
+    valueType X, Y ;
+    evalXY( dk*s*s, k*s, X, Y ) ;
+    eval_D( s, tx, ty ) ;
+    x = x0 + s*(X * cos_theta0 - Y * sin_theta0) - offs * ty ;
+    y = y0 + s*(X * sin_theta0 + Y * cos_theta0) + offs * tx ;
+  }
+
+  void
+  ClothoidEvaluator::eval( valueType s, valueType offs, valueType & x, valueType & y ) const {
+    valueType tx, ty ;
+    evalTangent( s, offs, x, y, tx, ty ) ;
+  }
+
+  void
+  ClothoidEvaluator::eval_D( valueType s, valueType offs, valueType & x_D, valueType & y_D ) const {
+    valueType theta_D = k+s*dk ;
+    valueType scale   = 1-offs*theta_D ;
+    eval_D( s, x_D, y_D ) ;
+    x_D *= scale ;
+    y_D *= scale ;
+  }
+
+  void
+  ClothoidEvaluator::eval_DD( valueType s, valueType offs, valueType & x_DD, valueType & y_DD ) const {
+    offsetEval_DD( theta(s), theta_D(s), dk, offs, x_DD, y_DD ) ;
+  }
+
+  void
+  ClothoidEvaluator::eval_DDD( valueType s, valueType offs, valueType & x_DDD, valueType & y_DDD ) const {
+    offsetEval_DDD( theta(s), theta_D(s), dk, offs, x_DDD, y_DDD ) ;
+  }
+
+  void
+  ClothoidEvaluator::eval( valueType   s,
+                           valueType   offs,
+                           valueType & x,
+                           valueType & y,
+                           valueType & x_D,
+                           valueType & y_D ) const {
+    valueType scale = 1-offs*theta_D(s) ;
+    evalTangent( s, offs, x, y, x_D, y_D ) ;
+    x_D *= scale ;
+    y_D *= scale ;
+  }
+
+  bool
+  ClothoidEvaluator::bbTriangle( valueType    s_begin,
+                                 valueType    s_end,
+                                 valueType    offs,
+                                 Triangle2D & t ) const {
+    valueType theta_max = theta( s_end ) ;
+    valueType theta_min = theta( s_begin ) ;
+    valueType dtheta    = std::abs( theta_max-theta_min ) ;
+    if ( dtheta >= m_pi_2 ) return false ;
+    valueType * p0 = t.p1 ;
+    valueType * p1 = t.p2 ;
+    valueType * p2 = t.p3 ;
+    valueType alpha, t0[2], t1[2] ;
+    // the tangents without offset
+    evalTangent( s_begin, offs, p0[0], p0[1], t0[0], t0[1] ) ;
+    evalTangent( s_end,   offs, p1[0], p1[1], t1[0], t1[1] ) ;
+    if ( dtheta > 0.0001 * m_pi_2 ) {
+      valueType det = t1[0]*t0[1]-t0[0]*t1[1] ;
+      alpha = ((p1[1]-p0[1])*t1[0] - (p1[0]-p0[0])*t1[1])/det ;
+    } else {
+      // se angolo troppo piccolo uso approx piu rozza
+      alpha = s_end - s_begin ;
+    }
+    p2[0] = p0[0] + alpha*t0[0] ;
+    p2[1] = p0[1] + alpha*t0[1] ;
+    return true ;
+  }
+
+  // gradient with respect to (x0,y0,theta0,k,dk,s)
+  void
+  ClothoidCurve::eval_grad( valueType   s,
+                            valueType & x,
+                            valueType & y,
+                            valueType   x_grad[6],
+                            valueType   y_grad[6] ) const {
+    valueType C[3], S[3] ;
+    GeneralizedFresnelCS( 3, dk*s*s, k*s, theta0, C, S ) ;
+    valueType s2    = s*s ;
+    valueType s3    = s2*s/2 ;
+    valueType theta = theta0 + s*(k+s*(dk/2)) ;
+    x = x0 + s*C[0] ;
+    y = y0 + s*S[0] ;
+    x_grad[0] = 1 ;          y_grad[0] = 0 ;
+    x_grad[1] = 0 ;          y_grad[1] = 1 ;
+    x_grad[2] = -s*S[0] ;    y_grad[2] = s*C[0] ;
+    x_grad[3] = -s2*S[1] ;   y_grad[3] = s2*C[1] ;
+    x_grad[4] = -s3*S[2] ;   y_grad[4] = s3*C[2] ;
+    x_grad[5] = cos(theta) ; y_grad[5] = sin(theta) ;
+  }
+
+  void
+  ClothoidCurve::eval_grad( valueType   s,
+                            valueType   offs,
+                            valueType & x,
+                            valueType & y,
+                            valueType   x_grad[6],
+                            valueType   y_grad[6] ) const {
+    eval_grad( s, x, y, x_grad, y_grad ) ;
+    // the normal N = (-sin(theta),cos(theta)) has dN/dtheta = -T
+    valueType tx = x_grad[5] ;
+    valueType ty = y_grad[5] ;
+    valueType dtheta[6] = { 0, 0, 1, s, s*s/2, k+s*dk } ;
+    x -= offs * ty ;
+    y += offs * tx ;
+    for ( indexType j = 2 ; j < 6 ; ++j ) {
+      x_grad[j] -= offs * tx * dtheta[j] ;
+      y_grad[j] -= offs * ty * dtheta[j] ;
+    }
+  }
+
+  void
+  ClothoidCurve::eval_grad( indexType       ns,
+                            valueType const s[],
+                            valueType       offs,
+                            valueType       x[],
+                            valueType       y[],
+                            valueType       x_grad[],
+                            valueType       y_grad[] ) const {
+    for ( indexType i = 0 ; i < ns ; ++i )
+      eval_grad( s[i], offs, x[i], y[i], x_grad+6*i, y_grad+6*i ) ;
+  }
+
+  // family of offset curves
+  void
+  ClothoidCurve::eval( valueType       s,
+                       indexType       n_offs,
+                       valueType const offs[],
+                       valueType       x[],
+                       valueType       y[] ) const {
+    valueType C, S ;
+    GeneralizedFresnelCS( dk*s*s, k*s, theta0, C, S ) ;
+    valueType theta = theta0 + s*(k+s*(dk/2)) ;
+    valueType nx    = -sin(theta) ;
+    valueType ny    =  cos(theta) ;
+    valueType xx    = x0 + s*C ;
+    valueType yy    = y0 + s*S ;
+    for ( indexType j = 0 ; j < n_offs ; ++j ) {
+      x[j] = xx + offs[j] * nx ;
+      y[j] = yy + offs[j] * ny ;
+    }
+  }
+
+  void
+  ClothoidCurve::eval_D( valueType       s,
+                         indexType       n_offs,
+                         valueType const offs[],
+                         valueType       x_D[],
+                         valueType       y_D[] ) const {
     valueType theta   = theta0 + s*(k+s*(dk/2)) ;
     valueType theta_D = k+s*dk ;
     valueType C       = cos(theta) ;
     valueType S       = sin(theta) ;
-    valueType tmp1    = theta_D*theta_D*(theta_D*offs-1) ;
-    valueType tmp2    = dk*(1-3*theta_D*offs) ;
-    x_DDD = tmp1*C-tmp2*S ;
-    y_DDD = tmp1*S+tmp2*C ;
+    for ( indexType j = 0 ; j < n_offs ; ++j ) {
+      valueType scale = 1-offs[j]*theta_D ;
+      x_D[j] = C*scale ;
+      y_D[j] = S*scale ;
+    }
+  }
+
+  void
+  ClothoidCurve::eval( valueType       s,
+                       indexType       n_offs,
+                       valueType const offs[],
+                       valueType       x[],
+                       valueType       y[],
+                       valueType       x_D[],
+                       valueType       y_D[] ) const {
+    valueType C, S ;
+    GeneralizedFresnelCS( dk*s*s, k*s, theta0, C, S ) ;
+    valueType theta   = theta0 + s*(k+s*(dk/2)) ;
+    valueType theta_D = k+s*dk ;
+    valueType ct      = cos(theta) ;
+    valueType st      = sin(theta) ;
+    valueType xx      = x0 + s*C ;
+    valueType yy      = y0 + s*S ;
+    for ( indexType j = 0 ; j < n_offs ; ++j ) {
+      valueType scale = 1-offs[j]*theta_D ;
+      x[j]   = xx - offs[j] * st ;
+      y[j]   = yy + offs[j] * ct ;
+      x_D[j] = ct*scale ;
+      y_D[j] = st*scale ;
+    }
+  }
+
+  void
+  ClothoidCurve::eval( indexType       ns,
+                       valueType const s[],
+                       indexType       n_offs,
+                       valueType const offs[],
+                       valueType       x[],
+                       valueType       y[] ) const {
+    for ( indexType i = 0 ; i < ns ; ++i )
+      eval( s[i], n_offs, offs, x+i*n_offs, y+i*n_offs ) ;
+  }
+
+  void
+  ClothoidCurve::eval( indexType       ns,
+                       valueType const s[],
+                       indexType       n_offs,
+                       valueType const offs[],
+                       valueType       x[],
+                       valueType       y[],
+                       valueType       x_D[],
+                       valueType       y_D[] ) const {
+    for ( indexType i = 0 ; i < ns ; ++i ) {
+      indexType ij = i*n_offs ;
+      eval( s[i], n_offs, offs, x+ij, y+ij, x_D+ij, y_D+ij ) ;
+    }
   }
 
   static
@@ -948,10 +1283,10 @@ namespace Clothoid {
     if ( dtheta < m_pi_2 ) {
       valueType alpha, t0[2] ;
       eval( s_min, offs, p0[0], p0[1] ) ;
+      eval( s_max, offs, p1[0], p1[1] ) ;
       eval_D( s_min, t0[0], t0[1] ) ; // no offset
       if ( dtheta > 0.0001 * m_pi_2 ) {
         valueType t1[2] ;
-        eval( s_max, offs, p1[0], p1[1] ) ;
         eval_D( s_max, t1[0], t1[1] ) ; // no offset
         // risolvo il sistema
         // p0 + alpha * t0 = p1 + beta * t1
@@ -970,29 +1305,38 @@ namespace Clothoid {
     }
   }
 
-  void
-  ClothoidCurve::bbSplit( valueType               split_angle,
-                          valueType               split_size,
-                          valueType               split_offs,
-                          vector<ClothoidCurve> & c,
-                          vector<Triangle2D>    & t ) const {
-
-    // step 0: controllo se curvatura passa per 0
-    valueType k_min = theta_D( s_min ) ;
-    valueType k_max = theta_D( s_max ) ;
-    c.clear() ;
-    t.clear() ;
-    if ( k_min * k_max < 0 ) {
-      // risolvo (s-s_min)*dk+k_min = 0 --> s = s_min-k_min/dk
-      valueType s_med = s_min-k_min/dk ;
-      ClothoidCurve tmp(*this) ;
-      tmp.trim(s_min,s_med) ;
-      tmp.bbSplit_internal( split_angle, split_size, split_offs, c, t ) ;
-      tmp.trim(s_med,s_max) ;
-      tmp.bbSplit_internal( split_angle, split_size, split_offs, c, t ) ;
-    } else {
-      bbSplit_internal( split_angle, split_size, split_offs, c, t ) ;
+  bool
+  ClothoidCurve::bbTriangle( indexType       n_offs,
+                             valueType const offs[],
+                             Triangle2D      t[] ) const {
+    valueType theta_max = theta( s_max ) ;
+    valueType theta_min = theta( s_min ) ;
+    valueType dtheta    = std::abs( theta_max-theta_min ) ;
+    if ( dtheta >= m_pi_2 ) return false ;
+    // punti e tangenti estremi calcolati una volta sola
+    valueType x_min, y_min, x_max, y_max ;
+    eval( s_min, x_min, y_min ) ;
+    eval( s_max, x_max, y_max ) ;
+    valueType t0[2], t1[2] ;
+    eval_D( s_min, t0[0], t0[1] ) ; // no offset
+    eval_D( s_max, t1[0], t1[1] ) ; // no offset
+    bool      small = dtheta <= 0.0001 * m_pi_2 ;
+    valueType det   = t1[0]*t0[1]-t0[0]*t1[1] ;
+    for ( indexType j = 0 ; j < n_offs ; ++j ) {
+      valueType * p0 = t[j].p1 ;
+      valueType * p1 = t[j].p2 ;
+      valueType * p2 = t[j].p3 ;
+      p0[0] = x_min - offs[j] * t0[1] ;
+      p0[1] = y_min + offs[j] * t0[0] ;
+      p1[0] = x_max - offs[j] * t1[1] ;
+      p1[1] = y_max + offs[j] * t1[0] ;
+      valueType alpha ;
+      if ( small ) alpha = s_max - s_min ; // se angolo troppo piccolo uso approx piu rozza
+      else         alpha = ((p1[1]-p0[1])*t1[0] - (p1[0]-p0[0])*t1[1])/det ;
+      p2[0] = p0[0] + alpha*t0[0] ;
+      p2[1] = p0[1] + alpha*t0[1] ;
     }
+    return true ;
   }
 
   static
@@ -1003,136 +1347,1803 @@ namespace Clothoid {
     return std::abs(a) ;
   }
 
-  void
-  ClothoidCurve::bbSplit_internal( valueType               split_angle,
-                                   valueType               split_size,
-                                   valueType               split_offs,
-                                   vector<ClothoidCurve> & c,
-                                   vector<Triangle2D>    & t ) const {
+  //! \cond NODOC
+
+  // maximum depth of the bisection, at this depth the segment is
+  // shorter than the rounding of the curvilinear abscissa
+  static indexType const SPLIT_MAX_DEPTH = 64 ;
+
+  // end point of a segment of the splitting, evaluated once and
+  // shared by the two segments which have it as end point
+  typedef IntersectWorkspace::Point SplitPoint ;
+
+  //! \endcond
 
-    valueType theta_min, kappa_min, x_min, y_min,
-              theta_max, kappa_max, x_max, y_max ;
+  void
+  IntersectWorkspace::Point::setup( ClothoidEvaluator const & e, valueType _s, indexType _depth ) {
+    valueType kappa ;
+    s     = _s ;
+    depth = _depth ;
+    e.eval( s, theta, kappa, x, y ) ;
+    e.eval_D( s, tx, ty ) ; // no offset
+  }
 
-    eval( s_min, theta_min, kappa_min, x_min, y_min ) ;
-    eval( s_max, theta_max, kappa_max, x_max, y_max ) ;
+  //! \cond NODOC
 
-    valueType dtheta = std::abs( theta_max - theta_min ) ;
-    valueType dx     = x_max - x_min ;
-    valueType dy     = y_max - y_min ;
+  // same test of the recursive splitting, a leaf also turns less than
+  // pi/2 so that its bounding triangle exists whatever `split_angle`
+  static
+  bool
+  splitLeaf( SplitPoint const & a,
+             SplitPoint const & b,
+             valueType          split_angle,
+             valueType          split_size ) {
+    valueType dtheta = std::abs( b.theta - a.theta ) ;
+    valueType dx     = b.x - a.x ;
+    valueType dy     = b.y - a.y ;
     valueType len    = hypot( dy, dx ) ;
-    valueType dangle = abs2pi(atan2( dy, dx )-theta_min) ;
-    if ( dtheta <= split_angle && len*tan(dangle) <= split_size ) {
-      Triangle2D tt ;
-      this->bbTriangle(split_offs,tt) ;
-      c.push_back(*this) ;
-      t.push_back(tt) ;
-    } else {
-      ClothoidCurve cc(*this) ;
-      valueType s_med = (s_min+s_max)/2 ;
-      cc.trim(s_min,s_med) ;
-      cc.bbSplit_internal( split_angle, split_size, split_offs, c, t ) ;
-      cc.trim(s_med,s_max) ;
-      cc.bbSplit_internal( split_angle, split_size, split_offs, c, t ) ;
-    }
+    valueType dangle = abs2pi(atan2( dy, dx )-a.theta) ;
+    return dtheta <= split_angle && dtheta < m_pi_2 && len*tan(dangle) <= split_size ;
   }
 
+  // same triangles of ClothoidCurve::bbTriangle using the end points
+  static
   bool
-  ClothoidCurve::intersect_internal( ClothoidCurve & c1,
-                                     valueType       c1_offs,
-                                     valueType     & s1,
-                                     ClothoidCurve & c2,
-                                     valueType       c2_offs,
-                                     valueType     & s2,
-                                     indexType       max_iter,
-                                     valueType       tolerance ) const {
-    valueType angle1a = c1.theta(c1.s_min) ;
-    valueType angle1b = c1.theta(c1.s_max) ;
-    valueType angle2a = c2.theta(c2.s_min) ;
-    valueType angle2b = c2.theta(c2.s_max) ;
-    // cerca angoli migliori per partire
-    valueType dmax = abs2pi(angle1a-angle2a) ;
-    valueType dab  = abs2pi(angle1a-angle2b) ;
-    valueType dba  = abs2pi(angle1b-angle2a) ;
-    valueType dbb  = abs2pi(angle1b-angle2b) ;
-    s1 = c1.s_min ; s2 = c2.s_min ;
-    if ( dmax < dab ) { dmax = dab ; s2 = c2.s_max ; }
-    if ( dmax < dba ) { dmax = dba ; s1 = c1.s_min ; s2 = c2.s_min ; }
-    if ( dmax < dbb ) {              s1 = c1.s_min ; s2 = c2.s_max ; }
-    for ( indexType i = 0 ; i < max_iter ; ++i ) {
-      valueType t1[2], t2[2], p1[2], p2[2] ;
-      c1.eval( s1, c1_offs, p1[0], p1[1] ) ;
-      c1.eval_D( s1, c1_offs, t1[0], t1[1] ) ;
-      c2.eval( s2, c2_offs, p2[0], p2[1] ) ;
-      c2.eval_D( s2, c2_offs, t2[0], t2[1] ) ;
-      /*
-      // risolvo il sistema
-      // p1 + alpha * t1 = p2 + beta * t2
-      // alpha * t1 - beta * t2 = p2 - p1
-      //
-      //  / t1[0] -t2[0] \ / alpha \ = / p2[0] - p1[0] \
-      //  \ t1[1] -t2[1] / \ beta  /   \ p2[1] - p1[1] /
-      */
-      valueType det = t2[0]*t1[1]-t1[0]*t2[1] ;
-      valueType px  = p2[0]-p1[0] ;
-      valueType py  = p2[1]-p1[1] ;
-      s1 += (py*t2[0] - px*t2[1])/det ;
-      s2 += (t1[0]*py - t1[1]*px)/det ;
-      if ( s1 <= c1.s_min || s1 >= c1.s_max ||
-           s2 <= c2.s_min || s2 >= c2.s_max ) break ;
-      if ( std::abs(px) <= tolerance ||
-           std::abs(py) <= tolerance ) return true ;
+  splitTriangles( ClothoidEvaluator const & e,
+                  SplitPoint        const & a,
+                  SplitPoint        const & b,
+                  indexType                 n_offs,
+                  valueType         const   offs[],
+                  Triangle2D                t[] ) {
+    valueType dtheta = std::abs( e.theta(b.s)-e.theta(a.s) ) ;
+    if ( dtheta >= m_pi_2 ) return false ;
+    bool      small = dtheta <= 0.0001 * m_pi_2 ;
+    valueType det   = b.tx*a.ty-a.tx*b.ty ;
+    for ( indexType j = 0 ; j < n_offs ; ++j ) {
+      valueType p0[2], p1[2], p2[2] ;
+      p0[0] = a.x - offs[j] * a.ty ;
+      p0[1] = a.y + offs[j] * a.tx ;
+      p1[0] = b.x - offs[j] * b.ty ;
+      p1[1] = b.y + offs[j] * b.tx ;
+      valueType alpha ;
+      if ( small ) alpha = b.s - a.s ; // se angolo troppo piccolo uso approx piu rozza
+      else         alpha = ((p1[1]-p0[1])*b.tx - (p1[0]-p0[0])*b.ty)/det ;
+      p2[0] = p0[0] + alpha*a.tx ;
+      p2[1] = p0[1] + alpha*a.ty ;
+      t[j] = Triangle2D( p0, p1, p2 ) ;
     }
-    return false ;
+    return true ;
   }
 
+  /*
+   * Depth first bisection with an explicit stack of the right end points
+   * of the pending segments, the leaves are passed to `sink` in the
+   * order of the curvilinear abscissa.
+   * Each end point is evaluated once.
+   */
+  template <typename SINK>
+  static
   void
-  ClothoidCurve::intersect( valueType             offs,
-                            ClothoidCurve const & clot,
-                            valueType             clot_offs,
-                            vector<valueType>   & s1,
-                            vector<valueType>   & s2,
-                            indexType             max_iter,
-                            valueType             tolerance ) const {
-    vector<ClothoidCurve> c0, c1 ;
-    vector<Triangle2D>    t0, t1 ;
-    bbSplit( m_pi/50, (s_max-s_min)/3, offs, c0, t0 ) ;
-    clot.bbSplit( m_pi/50, (clot.s_max-clot.s_min)/3, clot_offs, c1, t1 ) ;
-    s1.clear() ;
-    s2.clear() ;
-    for ( indexType i = 0 ; i < indexType(c0.size()) ; ++i ) {
-      for ( indexType j = 0 ; j < indexType(c1.size()) ; ++j ) {
-        if ( t0[i].overlap(t1[j]) ) {
-          // uso newton per cercare intersezione
-          valueType tmp_s1, tmp_s2 ;
-          bool ok = intersect_internal( c0[i], offs,      tmp_s1,
-                                        c1[j], clot_offs, tmp_s2,
-                                        max_iter, tolerance ) ;
-          if ( ok ) {
-            s1.push_back(tmp_s1) ;
-            s2.push_back(tmp_s2) ;
-          }
-        }
+  splitIterative( ClothoidCurve     const & curve,
+                  ClothoidEvaluator const & e,
+                  valueType                 split_angle,
+                  valueType                 split_size,
+                  SINK                    & sink ) {
+    SplitPoint stack[SPLIT_MAX_DEPTH+1] ;
+    indexType  npts = 0 ;
+    SplitPoint a, b ;
+    valueType  s_min = curve.getSmin() ;
+    valueType  s_max = curve.getSmax() ;
+    a.setup( e, s_min, 0 ) ;
+    // step 0: controllo se curvatura passa per 0
+    valueType k_min = curve.theta_D( s_min ) ;
+    valueType k_max = curve.theta_D( s_max ) ;
+    if ( k_min * k_max < 0 ) {
+      // risolvo (s-s_min)*dk+k_min = 0 --> s = s_min-k_min/dk
+      stack[npts++].setup( e, s_max, 0 ) ;
+      b.setup( e, s_min-k_min/curve.getKappa_D(), 0 ) ;
+    } else {
+      b.setup( e, s_max, 0 ) ;
+    }
+    while ( true ) {
+      if ( b.depth >= SPLIT_MAX_DEPTH ||
+           splitLeaf( a, b, split_angle, split_size ) ) {
+        sink( a, b ) ;
+        if ( npts == 0 ) break ;
+        a = b ;
+        b = stack[--npts] ;
+      } else {
+        indexType depth = b.depth+1 ;
+        b.depth = depth ;
+        stack[npts++] = b ;
+        b.setup( e, (a.s+b.s)/2, depth ) ;
       }
     }
   }
-  
-  // collision detection
-  bool
-  ClothoidCurve::approsimate_collision( valueType             offs,
-                                        ClothoidCurve const & clot,
-                                        valueType             clot_offs,
-                                        valueType             max_angle,
-                                        valueType             max_size ) const {
-    vector<ClothoidCurve> c0, c1 ;
-    vector<Triangle2D>    t0, t1 ;
-    bbSplit( max_angle, max_size, offs, c0, t0 ) ;
-    clot.bbSplit( max_angle, max_size, clot_offs, c1, t1 ) ;
-    for ( indexType i = 0 ; i < indexType(c0.size()) ; ++i ) {
-      for ( indexType j = 0 ; j < indexType(c1.size()) ; ++j ) {
-        if ( t0[i].overlap(t1[j]) ) return true ;
+
+  // store the leaves in vectors
+  class SplitVectorSink {
+    ClothoidCurve const     & curve ;
+    ClothoidEvaluator const & e ;
+    indexType                 n_offs ;
+    valueType const         * offs ;
+    vector<ClothoidCurve>   & c ;
+    vector<Triangle2D>      & t ;
+  public:
+    SplitVectorSink( ClothoidCurve const     & _curve,
+                     ClothoidEvaluator const & _e,
+                     indexType                 _n_offs,
+                     valueType const           _offs[],
+                     vector<ClothoidCurve>   & _c,
+                     vector<Triangle2D>      & _t )
+    : curve(_curve), e(_e), n_offs(_n_offs), offs(_offs), c(_c), t(_t)
+    {}
+
+    void
+    operator () ( SplitPoint const & a, SplitPoint const & b ) {
+      c.push_back( curve ) ;
+      c.back().trim( a.s, b.s ) ;
+      t.resize( t.size() + n_offs ) ;
+      bool ok = splitTriangles( e, a, b, n_offs, offs, &t[t.size()-n_offs] ) ;
+      CLOTHOID_ASSERT( ok, "bbSplit, no bounding triangle for the segment [" <<
+                       a.s << "," << b.s << "] at the maximum depth" ) ;
+    }
+  } ;
+
+  // store the leaves in caller owned arrays, count the overflow
+  class SplitArraySink {
+    ClothoidCurve const     & curve ;
+    ClothoidEvaluator const & e ;
+    valueType                 offs ;
+    ClothoidCurve           * c ;
+    Triangle2D              * t ;
+    indexType                 capacity ;
+  public:
+    indexType n ;
+
+    SplitArraySink( ClothoidCurve const     & _curve,
+                    ClothoidEvaluator const & _e,
+                    valueType                 _offs,
+                    ClothoidCurve             _c[],
+                    Triangle2D                _t[],
+                    indexType                 _capacity )
+    : curve(_curve), e(_e), offs(_offs), c(_c), t(_t), capacity(_capacity), n(0)
+    {}
+
+    void
+    operator () ( SplitPoint const & a, SplitPoint const & b ) {
+      if ( n < capacity ) {
+        c[n] = curve ;
+        c[n].trim( a.s, b.s ) ;
+        bool ok = splitTriangles( e, a, b, 1, &offs, t+n ) ;
+        CLOTHOID_ASSERT( ok, "bbSplit, no bounding triangle for the segment [" <<
+                         a.s << "," << b.s << "] at the maximum depth" ) ;
       }
+      ++n ;
     }
-    return false ;
+  } ;
+
+  /*
+   * Node of the bisection tree of bbSplit built on demand.
+   * The box of a leaf is the box of its triangle, the box of an inner
+   * node contains the triangles of all the leaves below it:
+   * the offset curve has length Lo = L - offs*(theta(b)-theta(a)) and lies
+   * in the box of its end points enlarged by Lo/2, the apex of a leaf
+   * triangle is at distance at most max(Lo,L) from the curve.
+   * The bound needs a convex curve, i.e. no inflection and 1-offs*kappa > 0,
+   * otherwise the box is the whole plane.
+   */
+  typedef IntersectWorkspace::Node SplitNode ;
+
+  //! \endcond
+
+  void
+  IntersectWorkspace::Node::setup( ClothoidCurve     const & curve,
+                                   ClothoidEvaluator const & e,
+                                   valueType                 offs,
+                                   valueType                 split_angle,
+                                   valueType                 split_size,
+                                   bool                      convex ) {
+    child      = -1 ;
+    zero_split = false ;
+    s_mid      = (a.s+b.s)/2 ;
+    leaf       = depth >= SPLIT_MAX_DEPTH || splitLeaf( a, b, split_angle, split_size ) ;
+    if ( leaf ) {
+      bool ok = splitTriangles( e, a, b, 1, &offs, &t ) ;
+      CLOTHOID_ASSERT( ok, "bbSplit, no bounding triangle for the segment [" <<
+                       a.s << "," << b.s << "] at the maximum depth" ) ;
+      xmin = min( t.x1(), min( t.x2(), t.x3() ) ) ;
+      ymin = min( t.y1(), min( t.y2(), t.y3() ) ) ;
+      xmax = max( t.x1(), max( t.x2(), t.x3() ) ) ;
+      ymax = max( t.y1(), max( t.y2(), t.y3() ) ) ;
+      return ;
+    }
+    convex = convex && split_angle < m_pi_2 &&
+             1-offs*curve.theta_D(a.s) > 0 && 1-offs*curve.theta_D(b.s) > 0 ;
+    if ( !convex ) {
+      xmin = ymin = -HUGE_VAL ;
+      xmax = ymax =  HUGE_VAL ;
+      return ;
+    }
+    valueType x0 = a.x - offs*a.ty, y0 = a.y + offs*a.tx ;
+    valueType x1 = b.x - offs*b.ty, y1 = b.y + offs*b.tx ;
+    valueType L  = b.s - a.s ;
+    valueType Lo = L - offs*(b.theta-a.theta) ;
+    valueType d  = (Lo/2 + max( Lo, L ))*(1+1e-10) +
+                   1e-10*max( max( std::abs(x0), std::abs(y0) ),
+                              max( std::abs(x1), std::abs(y1) ) ) ;
+    xmin = min( x0, x1 ) - d ; xmax = max( x0, x1 ) + d ;
+    ymin = min( y0, y1 ) - d ; ymax = max( y0, y1 ) + d ;
+  }
+
+  //! \cond NODOC
+
+  // root of the tree, with the split at zero curvature of bbSplit
+  static
+  void
+  splitRoot( ClothoidCurve     const & curve,
+             ClothoidEvaluator const & e,
+             valueType                 offs,
+             valueType                 split_angle,
+             valueType                 split_size,
+             vector<SplitNode>       & nodes,
+             indexType               & n_eval ) {
+    nodes.resize(1) ;
+    SplitNode & root = nodes[0] ;
+    root.a.setup( e, curve.getSmin(), 0 ) ;
+    root.b.setup( e, curve.getSmax(), 0 ) ;
+    root.depth = 0 ;
+    n_eval += 2 ;
+    valueType k_min = curve.theta_D( curve.getSmin() ) ;
+    valueType k_max = curve.theta_D( curve.getSmax() ) ;
+    if ( k_min * k_max < 0 ) {
+      root.setup( curve, e, offs, split_angle, split_size, false ) ;
+      root.leaf       = false ;
+      root.zero_split = true ;
+      root.s_mid      = curve.getSmin()-k_min/curve.getKappa_D() ;
+    } else {
+      root.setup( curve, e, offs, split_angle, split_size, true ) ;
+    }
+  }
+
+  // create the two children of nodes[i]
+  static
+  void
+  splitOpen( ClothoidCurve     const & curve,
+             ClothoidEvaluator const & e,
+             valueType                 offs,
+             valueType                 split_angle,
+             valueType                 split_size,
+             vector<SplitNode>       & nodes,
+             indexType                 i,
+             indexType               & n_eval ) {
+    indexType ic = indexType(nodes.size()) ;
+    nodes.resize( nodes.size()+2 ) ;
+    SplitNode & n  = nodes[i] ;
+    SplitNode & c0 = nodes[ic] ;
+    SplitNode & c1 = nodes[ic+1] ;
+    // the halves of the split at zero curvature start again from depth 0
+    indexType depth = n.zero_split ? n.depth : n.depth+1 ;
+    c0.a = n.a ;
+    c0.b.setup( e, n.s_mid, 0 ) ;
+    c1.a = c0.b ;
+    c1.b = n.b ;
+    c0.depth = c1.depth = depth ;
+    ++n_eval ;
+    c0.setup( curve, e, offs, split_angle, split_size, true ) ;
+    c1.setup( curve, e, offs, split_angle, split_size, true ) ;
+    n.child = ic ;
+  }
+
+  // leaves of the trees of ClothoidCurve::distance, turning at most pi/16
+  static valueType const DISTANCE_SPLIT_ANGLE = m_pi/16 ;
+  static indexType const DISTANCE_MAX_ITER    = 20 ;
+
+  // point of the offset curve at a split point
+  static
+  inline
+  void
+  splitOffset( SplitPoint const & a, valueType offs, valueType & x, valueType & y ) {
+    x = a.x - offs*a.ty ;
+    y = a.y + offs*a.tx ;
+  }
+
+  // distance of the boxes of two nodes, a lower bound of the distance of the curves
+  static
+  inline
+  valueType
+  splitBoxDistance( SplitNode const & A, SplitNode const & B ) {
+    valueType dx = max( valueType(0), max( A.xmin-B.xmax, B.xmin-A.xmax ) ) ;
+    valueType dy = max( valueType(0), max( A.ymin-B.ymax, B.ymin-A.ymax ) ) ;
+    return hypot( dx, dy ) ;
+  }
+
+  /*
+   * Local minimum of f(s,t) = |P(s)-Q(t)|^2 in [a0,b0]x[a1,b1]
+   * starting from (s,t): Newton step when the Hessian is positive definite,
+   * Gauss-Newton step otherwise, projected on the box, with backtracking.
+   * A variable at the bound with the gradient pointing outside is kept fixed.
+   */
+  static
+  valueType
+  distanceNewton( ClothoidEvaluator const & e0, valueType offs0, valueType a0, valueType b0,
+                  ClothoidEvaluator const & e1, valueType offs1, valueType a1, valueType b1,
+                  valueType & s, valueType & t, valueType tolerance ) {
+    valueType px, py, qx, qy ;
+    e0.eval( s, offs0, px, py ) ;
+    e1.eval( t, offs1, qx, qy ) ;
+    valueType dx = px-qx, dy = py-qy ;
+    valueType f  = dx*dx+dy*dy ;
+    for ( indexType iter = 0 ; iter < DISTANCE_MAX_ITER && f > 0 ; ++iter ) {
+      valueType px_D, py_D, px_DD, py_DD, qx_D, qy_D, qx_DD, qy_DD ;
+      e0.eval_D( s, offs0, px_D, py_D ) ;
+      e0.eval_DD( s, offs0, px_DD, py_DD ) ;
+      e1.eval_D( t, offs1, qx_D, qy_D ) ;
+      e1.eval_DD( t, offs1, qx_DD, qy_DD ) ;
+      valueType g0  = dx*px_D + dy*py_D ;
+      valueType g1  = -(dx*qx_D + dy*qy_D) ;
+      valueType n0  = px_D*px_D + py_D*py_D ;
+      valueType n1  = qx_D*qx_D + qy_D*qy_D ;
+      valueType h00 = n0 + dx*px_DD + dy*py_DD ;
+      valueType h11 = n1 - dx*qx_DD - dy*qy_DD ;
+      valueType h01 = -(px_D*qx_D + py_D*qy_D) ;
+      bool fix0 = ( s <= a0 && g0 > 0 ) || ( s >= b0 && g0 < 0 ) ;
+      bool fix1 = ( t <= a1 && g1 > 0 ) || ( t >= b1 && g1 < 0 ) ;
+      if ( fix0 && fix1 ) break ;
+      valueType ds = 0, dt = 0 ;
+      if ( fix0 ) {
+        if ( h11 <= 0 ) h11 = n1 ;
+        if ( h11 <= 0 ) break ;
+        dt = -g1/h11 ;
+      } else if ( fix1 ) {
+        if ( h00 <= 0 ) h00 = n0 ;
+        if ( h00 <= 0 ) break ;
+        ds = -g0/h00 ;
+      } else {
+        if ( h00*h11 <= h01*h01 || h00 <= 0 ) { // Gauss-Newton, regularized
+          h00 = n0*(1+1e-8) ;
+          h11 = n1*(1+1e-8) ;
+        }
+        valueType det = h00*h11 - h01*h01 ;
+        if ( !(det > 0) ) break ;
+        ds = (h01*g1 - h11*g0)/det ;
+        dt = (h01*g0 - h00*g1)/det ;
+      }
+      valueType lambda = 1, sn = s, tn = t, fn = f ;
+      for ( indexType k = 0 ; k < 30 ; ++k, lambda /= 2 ) {
+        sn = min( b0, max( a0, s+lambda*ds ) ) ;
+        tn = min( b1, max( a1, t+lambda*dt ) ) ;
+        e0.eval( sn, offs0, px, py ) ;
+        e1.eval( tn, offs1, qx, qy ) ;
+        fn = (px-qx)*(px-qx)+(py-qy)*(py-qy) ;
+        if ( fn <= f ) break ;
+      }
+      if ( fn > f ) break ;
+      bool converged = std::abs(sn-s) + std::abs(tn-t) <= tolerance ;
+      s  = sn ; t = tn ; f = fn ;
+      dx = px-qx ; dy = py-qy ;
+      if ( converged ) break ;
+    }
+    return sqrt(f) ;
+  }
+
+  // pair of nodes of ClothoidCurve::distance with the lower bound of the distance
+  class DistancePair {
+  public:
+    valueType lower ;
+    indexType i, j ;
+    DistancePair( valueType _lower, indexType _i, indexType _j )
+    : lower(_lower), i(_i), j(_j) {}
+  } ;
+
+  // the pair with the smallest lower bound is on top of the heap
+  class DistancePairGreater {
+  public:
+    bool
+    operator () ( DistancePair const & a, DistancePair const & b ) const
+    { return a.lower > b.lower ; }
+  } ;
+
+  //! \endcond
+
+  void
+  ClothoidCurve::bbSplit( valueType               split_angle,
+                          valueType               split_size,
+                          valueType               split_offs,
+                          vector<ClothoidCurve> & c,
+                          vector<Triangle2D>    & t ) const {
+    bbSplit( split_angle, split_size, 1, &split_offs, c, t ) ;
+  }
+
+  void
+  ClothoidCurve::bbSplit( valueType               split_angle,
+                          valueType               split_size,
+                          indexType               n_offs,
+                          valueType const         split_offs[],
+                          vector<ClothoidCurve> & c,
+                          vector<Triangle2D>    & t ) const {
+    c.clear() ;
+    t.clear() ;
+    ClothoidEvaluator e(*this) ;
+    SplitVectorSink   sink( *this, e, n_offs, split_offs, c, t ) ;
+    splitIterative( *this, e, split_angle, split_size, sink ) ;
+  }
+
+  indexType
+  ClothoidCurve::bbSplit( valueType     split_angle,
+                          valueType     split_size,
+                          valueType     split_offs,
+                          ClothoidCurve c[],
+                          Triangle2D    t[],
+                          indexType     capacity ) const {
+    ClothoidEvaluator e(*this) ;
+    SplitArraySink    sink( *this, e, split_offs, c, t, capacity ) ;
+    splitIterative( *this, e, split_angle, split_size, sink ) ;
+    return sink.n ;
+  }
+
+  indexType
+  ClothoidCurve::bbSplit( valueType            split_angle,
+                          valueType            split_size,
+                          valueType            split_offs,
+                          IntersectWorkspace & ws ) const {
+    size_t cap = ws.capacity() ;
+    bbSplit( split_angle, split_size, split_offs, ws.c0, ws.t0 ) ;
+    ws.count( cap, ws.capacity() ) ;
+    return indexType(ws.c0.size()) ;
+  }
+
+  // roots of a*s^2+b*s+c in (s0,s1), stable formula
+  static
+  void
+  quadraticRoots( valueType a, valueType b, valueType c,
+                  valueType s0, valueType s1,
+                  vector<valueType> & s ) {
+    valueType r[2] ;
+    indexType nr = 0 ;
+    if ( a == 0 ) {
+      if ( b != 0 ) r[nr++] = -c/b ;
+    } else {
+      valueType disc = b*b-4*a*c ;
+      if ( disc < 0 ) return ;
+      valueType q = -( b + (b < 0 ? -1 : 1)*sqrt(disc) )/2 ;
+      r[nr++] = q/a ;
+      if ( q != 0 ) r[nr++] = c/q ;
+    }
+    for ( indexType i = 0 ; i < nr ; ++i )
+      if ( r[i] > s0 && r[i] < s1 ) s.push_back( r[i] ) ;
+  }
+
+  void
+  ClothoidCurve::headingBreaks( valueType           offs,
+                                valueType           phi,
+                                valueType           period,
+                                vector<valueType> & s ) const {
+    s.clear() ;
+    s.push_back( s_min ) ;
+    // theta(s) = phi+m*period for m in the range of theta
+    valueType th_min = min( theta(s_min), theta(s_max) ) ;
+    valueType th_max = max( theta(s_min), theta(s_max) ) ;
+    if ( dk != 0 ) {
+      valueType s_ext = -k/dk ;
+      if ( s_ext > s_min && s_ext < s_max ) {
+        th_min = min( th_min, theta(s_ext) ) ;
+        th_max = max( th_max, theta(s_ext) ) ;
+      }
+    }
+    for ( valueType m = ceil((th_min-phi)/period) ; phi+m*period <= th_max ; m += 1 )
+      quadraticRoots( dk/2, k, theta0-phi-m*period, s_min, s_max, s ) ;
+    // cusp of the offset curve, 1-offs*kappa(s) = 0
+    if ( offs != 0 )
+      quadraticRoots( 0, dk, k-1/offs, s_min, s_max, s ) ;
+    s.push_back( s_max ) ;
+    std::sort( s.begin(), s.end() ) ;
+  }
+
+  void
+  ClothoidCurve::monotoneSplit( valueType               offs,
+                                vector<ClothoidCurve> & c,
+                                vector<BBox2D>        & box ) const {
+    // heading at the multiples of pi/2
+    vector<valueType> s ;
+    headingBreaks( offs, 0, m_pi_2, s ) ;
+
+    c.clear() ;
+    box.clear() ;
+    ClothoidEvaluator e(*this) ;
+    valueType x0, y0, x1, y1 ;
+    e.eval( s[0], offs, x0, y0 ) ;
+    for ( size_t i = 1 ; i < s.size() ; ++i ) {
+      if ( s[i] <= s[i-1] ) continue ; // double root
+      e.eval( s[i], offs, x1, y1 ) ;
+      c.push_back( *this ) ;
+      c.back().trim( s[i-1], s[i] ) ;
+      box.push_back( BBox2D( min(x0,x1), min(y0,y1), max(x0,x1), max(y0,y1) ) ) ;
+      x0 = x1 ; y0 = y1 ;
+    }
+  }
+
+  // distance of the offset curve from a line times the length of (dx,dy)
+  class LineDistance {
+  public:
+    ClothoidEvaluator const & e ;
+    valueType offs, ax, ay, dx, dy ;
+
+    LineDistance( ClothoidEvaluator const & _e, valueType _offs,
+                  valueType _ax, valueType _ay, valueType _dx, valueType _dy )
+    : e(_e), offs(_offs), ax(_ax), ay(_ay), dx(_dx), dy(_dy) {}
+
+    valueType
+    operator () ( valueType s ) const {
+      valueType x, y ;
+      e.eval( s, offs, x, y ) ;
+      return (x-ax)*dy - (y-ay)*dx ;
+    }
+
+    void
+    eval( valueType s, valueType & f, valueType & f_D ) const {
+      valueType x, y, x_D, y_D ;
+      e.eval( s, offs, x, y, x_D, y_D ) ;
+      f   = (x-ax)*dy - (y-ay)*dx ;
+      f_D = x_D*dy - y_D*dx ;
+    }
+  } ;
+
+  // distance of the offset curve from a circle, negative inside
+  class CircleDistance {
+  public:
+    ClothoidEvaluator const & e ;
+    valueType offs, cx, cy, r ;
+
+    CircleDistance( ClothoidEvaluator const & _e, valueType _offs,
+                    valueType _cx, valueType _cy, valueType _r )
+    : e(_e), offs(_offs), cx(_cx), cy(_cy), r(_r) {}
+
+    void
+    eval( valueType s, valueType & f, valueType & f_D ) const {
+      valueType x, y, x_D, y_D ;
+      e.eval( s, offs, x, y, x_D, y_D ) ;
+      valueType dx = x-cx, dy = y-cy, d = hypot( dx, dy ) ;
+      f   = d-r ;
+      f_D = d > 0 ? (dx*x_D+dy*y_D)/d : 0 ;
+    }
+  } ;
+
+  /*
+   * Root of F in [a,b] with F(a)*F(b) < 0: Newton from the secant point,
+   * a step leaving the bracket is replaced by bisection.
+   */
+  template <typename F>
+  static
+  valueType
+  safeguardedNewton( F const & fun,
+                     valueType a, valueType fa,
+                     valueType b, valueType fb,
+                     valueType tolerance ) {
+    valueType s = a - fa*(b-a)/(fb-fa) ;
+    for ( indexType iter = 0 ; iter < 2*SPLIT_MAX_DEPTH ; ++iter ) {
+      if ( !(s > a && s < b) ) s = (a+b)/2 ;
+      valueType f, f_D ;
+      fun.eval( s, f, f_D ) ;
+      if ( f == 0 ) break ;
+      if ( (f < 0) == (fa < 0) ) { a = s ; fa = f ; }
+      else                       { b = s ; fb = f ; }
+      valueType sn = f_D != 0 ? s - f/f_D : (a+b)/2 ;
+      if ( !(sn > a && sn < b) ) sn = (a+b)/2 ;
+      bool converged = std::abs(sn-s) <= tolerance || b-a <= tolerance ;
+      s = sn ;
+      if ( converged ) break ;
+    }
+    return s ;
+  }
+
+  // sort the roots and keep one of those closer than 2*tolerance
+  static
+  void
+  mergeRoots( vector<valueType> & s, valueType tolerance ) {
+    std::sort( s.begin(), s.end() ) ;
+    size_t n = 0 ;
+    for ( size_t i = 0 ; i < s.size() ; ++i )
+      if ( n == 0 || s[i]-s[n-1] > 2*tolerance ) s[n++] = s[i] ;
+    s.resize(n) ;
+  }
+
+  void
+  ClothoidCurve::intersect_segment( valueType           offs,
+                                    valueType           x0,
+                                    valueType           y0,
+                                    valueType           x1,
+                                    valueType           y1,
+                                    vector<valueType> & s,
+                                    vector<valueType> & t,
+                                    valueType           tolerance ) const {
+    s.clear() ;
+    t.clear() ;
+    valueType dx = x1-x0, dy = y1-y0, d2 = dx*dx+dy*dy ;
+    if ( d2 == 0 ) return ;
+    valueType dlen = sqrt(d2) ;
+    valueType ftol = tolerance*dlen ;
+
+    // the distance from the line is monotone between two breaks
+    vector<valueType> brk ;
+    headingBreaks( offs, atan2(dy,dx), m_pi, brk ) ;
+    ClothoidEvaluator e(*this) ;
+    LineDistance      F( e, offs, x0, y0, dx, dy ) ;
+    valueType fa = F( brk[0] ) ;
+    if ( std::abs(fa) <= ftol ) s.push_back( brk[0] ) ;
+    for ( size_t i = 1 ; i < brk.size() ; ++i ) {
+      valueType fb = F( brk[i] ) ;
+      if ( std::abs(fb) <= ftol ) // contact at the break
+        s.push_back( brk[i] ) ;
+      else if ( std::abs(fa) > ftol && (fa < 0) != (fb < 0) )
+        s.push_back( safeguardedNewton( F, brk[i-1], fa, brk[i], fb, tolerance ) ) ;
+      fa = fb ;
+    }
+    mergeRoots( s, tolerance ) ;
+
+    // keep the points on the segment
+    valueType ttol = tolerance/dlen ;
+    size_t n = 0 ;
+    for ( size_t i = 0 ; i < s.size() ; ++i ) {
+      valueType x, y ;
+      e.eval( s[i], offs, x, y ) ;
+      valueType tt = ((x-x0)*dx+(y-y0)*dy)/d2 ;
+      if ( tt < -ttol || tt > 1+ttol ) continue ;
+      s[n++] = s[i] ;
+      t.push_back( min( valueType(1), max( valueType(0), tt ) ) ) ;
+    }
+    s.resize(n) ;
+  }
+
+  // piece of intersect_circle with the evaluations at its end points
+  class CirclePiece {
+  public:
+    valueType sa, xa, ya, fa ;
+    valueType sb, xb, yb, fb ;
+    indexType depth ;
+  } ;
+
+  /*
+   * On a monotone piece the curve lies in the box of its end points,
+   * the direction (P-C) is in the angles covered by the box seen from C
+   * and the tangent in the range of theta: the derivative of |P-C| is
+   * (P-C).T (1-offs*kappa) and keeps its sign if the two ranges are
+   * never perpendicular.
+   */
+  void
+  ClothoidCurve::intersect_circle( valueType           offs,
+                                   valueType           cx,
+                                   valueType           cy,
+                                   valueType           r,
+                                   vector<valueType> & s,
+                                   vector<valueType> & a,
+                                   valueType           tolerance ) const {
+    s.clear() ;
+    a.clear() ;
+    ClothoidEvaluator e(*this) ;
+    CircleDistance    F( e, offs, cx, cy, r ) ;
+
+    vector<valueType> brk ;
+    headingBreaks( offs, 0, m_pi_2, brk ) ;
+    vector<CirclePiece> stack ;
+    stack.reserve( brk.size()+2*SPLIT_MAX_DEPTH ) ;
+    // right most piece on top
+    CirclePiece P ;
+    P.depth = 0 ;
+    P.sb = brk.back() ;
+    e.eval( P.sb, offs, P.xb, P.yb ) ;
+    P.fb = hypot( P.xb-cx, P.yb-cy )-r ;
+    for ( size_t i = brk.size()-1 ; i > 0 ; --i ) {
+      P.sa = brk[i-1] ;
+      e.eval( P.sa, offs, P.xa, P.ya ) ;
+      P.fa = hypot( P.xa-cx, P.ya-cy )-r ;
+      stack.push_back( P ) ;
+      P.sb = P.sa ; P.xb = P.xa ; P.yb = P.ya ; P.fb = P.fa ;
+    }
+    if ( std::abs(P.fb) <= tolerance ) s.push_back( P.sb ) ;
+
+    while ( !stack.empty() ) {
+      P = stack.back() ;
+      stack.pop_back() ;
+      // distances of the box from the center
+      valueType xmin = min( P.xa, P.xb ), xmax = max( P.xa, P.xb ) ;
+      valueType ymin = min( P.ya, P.yb ), ymax = max( P.ya, P.yb ) ;
+      valueType ex   = max( valueType(0), max( xmin-cx, cx-xmax ) ) ;
+      valueType ey   = max( valueType(0), max( ymin-cy, cy-ymax ) ) ;
+      valueType dmin = hypot( ex, ey ) ;
+      valueType dmax = hypot( max( std::abs(xmin-cx), std::abs(xmax-cx) ),
+                              max( std::abs(ymin-cy), std::abs(ymax-cy) ) ) ;
+      if ( dmin-r > tolerance || r-dmax > tolerance ) continue ;
+
+      bool monotone = false ;
+      if ( dmin > 0 ) {
+        valueType xc = (xmin+xmax)/2-cx, yc = (ymin+ymax)/2-cy ;
+        valueType ac = atan2( yc, xc ) ;
+        valueType alpha_min = 0, alpha_max = 0 ;
+        valueType const X[4] = { xmin, xmax, xmin, xmax } ;
+        valueType const Y[4] = { ymin, ymin, ymax, ymax } ;
+        for ( indexType k = 0 ; k < 4 ; ++k ) {
+          valueType da = atan2( Y[k]-cy, X[k]-cx ) - ac ;
+          if      ( da >  m_pi ) da -= 2*m_pi ;
+          else if ( da < -m_pi ) da += 2*m_pi ;
+          alpha_min = min( alpha_min, da ) ;
+          alpha_max = max( alpha_max, da ) ;
+        }
+        valueType th_min = min( theta(P.sa), theta(P.sb) ) ;
+        valueType th_max = max( theta(P.sa), theta(P.sb) ) ;
+        if ( dk != 0 ) {
+          valueType s_ext = -k/dk ;
+          if ( s_ext > P.sa && s_ext < P.sb ) {
+            th_min = min( th_min, theta(s_ext) ) ;
+            th_max = max( th_max, theta(s_ext) ) ;
+          }
+        }
+        // no pi/2+m*pi in the range of alpha-theta
+        valueType lo = ac+alpha_min-th_max ;
+        valueType hi = ac+alpha_max-th_min ;
+        valueType m  = ceil( (lo-m_pi_2)/m_pi ) ;
+        monotone = m_pi_2+m*m_pi > hi ;
+      }
+
+      bool small = P.sb-P.sa <= tolerance || P.depth >= SPLIT_MAX_DEPTH ;
+      if ( monotone || small ) {
+        bool cross = std::abs(P.fa) > tolerance && std::abs(P.fb) > tolerance &&
+                     (P.fa < 0) != (P.fb < 0) ;
+        if ( cross )
+          s.push_back( safeguardedNewton( F, P.sa, P.fa, P.sb, P.fb, tolerance ) ) ;
+        else if ( std::abs(P.fb) <= tolerance )
+          s.push_back( P.sb ) ;
+        else if ( small && std::abs(P.fa) <= tolerance ) // contact inside the piece
+          s.push_back( P.sa ) ;
+        continue ;
+      }
+      // bisect
+      CirclePiece L = P, R = P ;
+      L.sb = R.sa = (P.sa+P.sb)/2 ;
+      e.eval( L.sb, offs, L.xb, L.yb ) ;
+      L.fb = hypot( L.xb-cx, L.yb-cy )-r ;
+      R.xa = L.xb ; R.ya = L.yb ; R.fa = L.fb ;
+      L.depth = R.depth = P.depth+1 ;
+      stack.push_back( R ) ;
+      stack.push_back( L ) ;
+    }
+    mergeRoots( s, tolerance ) ;
+    for ( size_t i = 0 ; i < s.size() ; ++i ) {
+      valueType x, y ;
+      e.eval( s[i], offs, x, y ) ;
+      a.push_back( atan2( y-cy, x-cx ) ) ;
+    }
+  }
+
+  //! \cond NODOC
+
+  // above this angle variation of a segment its cubic model is not used
+  static valueType const TAYLOR_MAX_ANGLE = m_pi/16 ;
+
+  // the model iteration may leave the segment by this fraction of its length
+  static valueType const TAYLOR_MARGIN = 1e-2 ;
+
+  /*
+   * Clamp the Newton iterate s to [a,b], `side` is the end where the
+   * previous iterate was clamped (-1, +1 or 0), true when it is clamped
+   * twice in a row at the same end: the root is outside the segment.
+   */
+  static
+  bool
+  clampIterate( valueType & s, valueType a, valueType b, indexType & side ) {
+    indexType new_side = 0 ;
+    if      ( s < a ) { s = a ; new_side = -1 ; }
+    else if ( s > b ) { s = b ; new_side = +1 ; }
+    bool stuck = new_side != 0 && new_side == side ;
+    side = new_side ;
+    return stuck ;
+  }
+
+  /*
+   * Newton on the two models from (s1,s2), false when the iterate is
+   * stuck outside the segments (enlarged by TAYLOR_MARGIN of their length
+   * for the error of the models) without halving the distance of the
+   * points, as in intersect_internal: there is no intersection.
+   */
+  static
+  bool
+  taylorNewton( TaylorModel const & m1, valueType & s1,
+                TaylorModel const & m2, valueType & s2,
+                indexType max_iter, valueType tolerance ) {
+    valueType u1 = s1-m1.sm ;
+    valueType u2 = s2-m2.sm ;
+    valueType h1 = m1.h*(1+2*TAYLOR_MARGIN) ;
+    valueType h2 = m2.h*(1+2*TAYLOR_MARGIN) ;
+    indexType side1 = 0, side2 = 0 ;
+    valueType dist_prev = HUGE_VAL ;
+    for ( indexType i = 0 ; i < max_iter ; ++i ) {
+      valueType p1[2], t1[2], p2[2], t2[2] ;
+      m1.eval( u1, p1, t1 ) ;
+      m2.eval( u2, p2, t2 ) ;
+      valueType det  = t2[0]*t1[1]-t1[0]*t2[1] ;
+      valueType px   = p2[0]-p1[0] ;
+      valueType py   = p2[1]-p1[1] ;
+      valueType dist = hypot(px,py) ;
+      if ( dist <= tolerance ) break ;
+      if ( det == 0 ) return false ;
+      u1 += (py*t2[0] - px*t2[1])/det ;
+      u2 += (t1[0]*py - t1[1]*px)/det ;
+      bool stuck1 = clampIterate( u1, -h1, h1, side1 ) ;
+      bool stuck2 = clampIterate( u2, -h2, h2, side2 ) ;
+      if ( (stuck1 || stuck2) && dist > dist_prev/2 ) return false ;
+      dist_prev = dist ;
+    }
+    s1 = m1.sm+u1 ;
+    s2 = m2.sm+u2 ;
+    return true ;
+  }
+
+  //! \endcond
+
+  /*
+   * With T = (cos,sin), N = (-sin,cos), o the offset, the derivatives are
+   *   d1 = (1-o*k)*T
+   *   d2 = -o*dk*T + (1-o*k)*k*N
+   *   d3 = -(1-o*k)*k^2*T + dk*(1-3*o*k)*N
+   * the error is O(h^4*k^3) for half length h.
+   */
+  void
+  TaylorModel::setup( ClothoidCurve const & c, valueType offs ) {
+    sm  = (c.getSmin()+c.getSmax())/2 ;
+    h   = (c.getSmax()-c.getSmin())/2 ;
+    use = std::abs( c.theta(c.getSmax())-c.theta(c.getSmin()) ) <= TAYLOR_MAX_ANGLE ;
+    if ( !use ) return ;
+    valueType theta, kappa ;
+    ClothoidEvaluator( c ).eval( sm, theta, kappa, p[0], p[1] ) ;
+    valueType dk = c.getKappa_D() ;
+    valueType C  = cos(theta) ;
+    valueType S  = sin(theta) ;
+    valueType sc = 1-offs*kappa ;
+    valueType a2 = -offs*dk ;
+    valueType b2 = sc*kappa ;
+    valueType a3 = -sc*kappa*kappa ;
+    valueType b3 = dk*(1-3*offs*kappa) ;
+    p[0] -= offs*S ;
+    p[1] += offs*C ;
+    d1[0] = sc*C ;       d1[1] = sc*S ;
+    d2[0] = a2*C-b2*S ;  d2[1] = a2*S+b2*C ;
+    d3[0] = a3*C-b3*S ;  d3[1] = a3*S+b3*C ;
+  }
+
+  /*
+   * The iterates are clamped to the segments and the search stops when
+   * one is clamped twice in a row at the same end without halving the
+   * distance of the points (a root at the end converges on the other
+   * segment). A root is accepted when the distance of the points is
+   * below `tolerance`, the iterate checked is returned if it falls in
+   * [s_min,s_max) of both segments ([s_min,s_max] for the last ones).
+   * With the models (REFINE_TAYLOR) the exact Newton starts from their
+   * intersection: usually one exact step (2 evaluations), a pair of
+   * segments without intersection is discarded by the models alone.
+   */
+  bool
+  ClothoidCurve::intersect_internal( ClothoidCurve & c1,
+                                     valueType       c1_offs,
+                                     valueType     & s1,
+                                     bool            c1_last,
+                                     ClothoidCurve & c2,
+                                     valueType       c2_offs,
+                                     valueType     & s2,
+                                     bool            c2_last,
+                                     indexType       max_iter,
+                                     valueType       tolerance,
+                                     TaylorModel const * m1,
+                                     TaylorModel const * m2,
+                                     indexType     & n_eval ) const {
+    valueType angle1a = c1.theta(c1.s_min) ;
+    valueType angle1b = c1.theta(c1.s_max) ;
+    valueType angle2a = c2.theta(c2.s_min) ;
+    valueType angle2b = c2.theta(c2.s_max) ;
+    // cerca angoli migliori per partire
+    valueType dmax = abs2pi(angle1a-angle2a) ;
+    valueType dab  = abs2pi(angle1a-angle2b) ;
+    valueType dba  = abs2pi(angle1b-angle2a) ;
+    valueType dbb  = abs2pi(angle1b-angle2b) ;
+    s1 = c1.s_min ; s2 = c2.s_min ;
+    if ( dmax < dab ) { dmax = dab ; s2 = c2.s_max ; }
+    if ( dmax < dba ) { dmax = dba ; s1 = c1.s_max ; s2 = c2.s_min ; }
+    if ( dmax < dbb ) {              s1 = c1.s_max ; s2 = c2.s_max ; }
+    ClothoidEvaluator e1( c1 ), e2( c2 ) ;
+    n_eval = 0 ;
+    bool taylor = m1 != 0 && m2 != 0 ;
+    if ( taylor && m1->use && m2->use &&
+         !taylorNewton( *m1, s1, *m2, s2, max_iter, tolerance/10 ) ) return false ;
+    // the model may place the start slightly outside
+    valueType m1a = c1.s_min, m1b = c1.s_max ;
+    valueType m2a = c2.s_min, m2b = c2.s_max ;
+    if ( taylor ) {
+      m1a -= TAYLOR_MARGIN*(c1.s_max-c1.s_min) ; m1b += TAYLOR_MARGIN*(c1.s_max-c1.s_min) ;
+      m2a -= TAYLOR_MARGIN*(c2.s_max-c2.s_min) ; m2b += TAYLOR_MARGIN*(c2.s_max-c2.s_min) ;
+    }
+    indexType side1 = 0, side2 = 0 ;
+    valueType dist_prev = HUGE_VAL ;
+    for ( indexType i = 0 ; i < max_iter ; ++i ) {
+      valueType t1[2], t2[2], p1[2], p2[2] ;
+      e1.eval( s1, c1_offs, p1[0], p1[1], t1[0], t1[1] ) ;
+      e2.eval( s2, c2_offs, p2[0], p2[1], t2[0], t2[1] ) ;
+      n_eval += 2 ;
+      /*
+      // risolvo il sistema
+      // p1 + alpha * t1 = p2 + beta * t2
+      // alpha * t1 - beta * t2 = p2 - p1
+      //
+      //  / t1[0] -t2[0] \ / alpha \ = / p2[0] - p1[0] \
+      //  \ t1[1] -t2[1] / \ beta  /   \ p2[1] - p1[1] /
+      */
+      valueType det  = t2[0]*t1[1]-t1[0]*t2[1] ;
+      valueType px   = p2[0]-p1[0] ;
+      valueType py   = p2[1]-p1[1] ;
+      valueType dist = hypot(px,py) ;
+      if ( dist <= tolerance )
+        return s1 >= c1.s_min && ( c1_last ? s1 <= c1.s_max : s1 < c1.s_max ) &&
+               s2 >= c2.s_min && ( c2_last ? s2 <= c2.s_max : s2 < c2.s_max ) ;
+      s1 += (py*t2[0] - px*t2[1])/det ;
+      s2 += (t1[0]*py - t1[1]*px)/det ;
+      bool stuck1 = clampIterate( s1, m1a, m1b, side1 ) ;
+      bool stuck2 = clampIterate( s2, m2a, m2b, side2 ) ;
+      if ( (stuck1 || stuck2) && dist > dist_prev/2 ) break ;
+      dist_prev = dist ;
+    }
+    return false ;
+  }
+
+  //! \cond NODOC
+
+  // two roots closer than this factor of the tolerance are the same
+  static valueType const ROOT_SAME_TOL = 100 ;
+
+  //! \endcond
+
+  /*
+   * A root on the common end of two segments may be accepted on both,
+   * the abscissae differ by about the tolerance. The roots are few, the
+   * new one is compared with all of them.
+   */
+  void
+  ClothoidCurve::pushRoot( valueType           a,
+                           valueType           b,
+                           valueType           tolerance,
+                           vector<valueType> & s1,
+                           vector<valueType> & s2 ) {
+    valueType tol = ROOT_SAME_TOL*tolerance ;
+    for ( size_t i = 0 ; i < s1.size() ; ++i )
+      if ( std::abs(s1[i]-a) <= tol && std::abs(s2[i]-b) <= tol ) return ;
+    s1.push_back(a) ;
+    s2.push_back(b) ;
+  }
+
+  //! \cond NODOC
+
+  // below this total angle variation a circle arc is intersected numerically
+  static valueType const ARC_ANALYTIC_MIN_ANGLE = 1e-4 ;
+
+  // relative tolerance of the discriminants: a tangent contact is a double root
+  static valueType const ANALYTIC_TANGENT_TOL = 1e-12 ;
+
+  // relative tolerance of the abscissae at the end points and of the
+  // test of collinear segments and of arcs on the same circle
+  static valueType const ANALYTIC_ABSCISSA_TOL = 1e-10 ;
+
+  // segment or circle arc (with offset) ready for closed form intersection
+  class LineOrArc {
+  public:
+    bool      line ;
+    valueType px, py ;   // line: point at s=0, arc: center
+    valueType tx, ty ;   // line: unit direction
+    valueType r ;        // arc: signed radius 1/k-offs
+    valueType theta0, k ;
+    valueType s_min, s_max ;
+    valueType tol ;      // tolerance on the abscissa
+
+    LineOrArc( ClothoidCurve const & c, valueType offs ) {
+      theta0 = c.getTheta0() ;
+      k      = c.getKappa() ;
+      s_min  = c.getSmin() ;
+      s_max  = c.getSmax() ;
+      tx     = cos(theta0) ;
+      ty     = sin(theta0) ;
+      line   = k == 0 ;
+      if ( line ) {
+        px = c.getX0() - offs*ty ;
+        py = c.getY0() + offs*tx ;
+        r  = 0 ;
+      } else {
+        px = c.getX0() - ty/k ;
+        py = c.getY0() + tx/k ;
+        r  = 1/k - offs ;
+      }
+      tol = ANALYTIC_ABSCISSA_TOL*( 1 + std::abs(s_min) + std::abs(s_max) +
+                                    std::abs(px) + std::abs(py) ) ;
+    }
+
+    void
+    point( valueType s, valueType & x, valueType & y ) const {
+      if ( line ) {
+        x = px + s*tx ;
+        y = py + s*ty ;
+      } else {
+        valueType th = theta0 + k*s ;
+        x = px + r*sin(th) ;
+        y = py - r*cos(th) ;
+      }
+    }
+
+    /*
+     * All the curvilinear abscissae of the point (qx,qy) lying on the
+     * curve, an abscissa within `tol` of the range is moved to the end
+     * point, so that a contact at an end point is not lost by rounding.
+     */
+    void
+    abscissae( valueType qx, valueType qy, vector<valueType> & s ) const {
+      s.clear() ;
+      if ( line ) {
+        valueType ss = (qx-px)*tx + (qy-py)*ty ;
+        if ( ss >= s_min-tol && ss <= s_max+tol )
+          s.push_back( max( s_min, min( s_max, ss ) ) ) ;
+      } else {
+        valueType th     = atan2( (qx-px)/r, (py-qy)/r ) ;
+        valueType s0     = (th-theta0)/k ;
+        valueType period = m_2pi/std::abs(k) ;
+        valueType m_lo   = ceil( (s_min-tol-s0)/period ) ;
+        valueType m_hi   = floor( (s_max+tol-s0)/period ) ;
+        for ( valueType m = m_lo ; m <= m_hi ; ++m )
+          s.push_back( max( s_min, min( s_max, s0 + m*period ) ) ) ;
+      }
+    }
+  } ;
+
+  // add the pair (sa,sb) sorted by `sa`, unless already there
+  static
+  void
+  addPair( LineOrArc const   & A,
+           LineOrArc const   & B,
+           valueType           sa,
+           valueType           sb,
+           vector<valueType> & s1,
+           vector<valueType> & s2 ) {
+    for ( size_t i = 0 ; i < s1.size() ; ++i )
+      if ( std::abs(s1[i]-sa) <= A.tol && std::abs(s2[i]-sb) <= B.tol ) return ;
+    // insertion sorted by the abscissa along this curve
+    size_t pos = s1.size() ;
+    s1.push_back(sa) ;
+    s2.push_back(sb) ;
+    while ( pos > 0 && s1[pos-1] > s1[pos] ) {
+      std::swap( s1[pos-1], s1[pos] ) ;
+      std::swap( s2[pos-1], s2[pos] ) ;
+      --pos ;
+    }
+  }
+
+  /*
+   * Collinear segments or arcs of the same circle: the curves share
+   * the intervals with end points at the end points of A or B, the
+   * pairs of abscissae of these points are returned.
+   */
+  static
+  void
+  overlapEnds( LineOrArc const   & A,
+               LineOrArc const   & B,
+               vector<valueType> & sa,
+               vector<valueType> & sb,
+               vector<valueType> & s1,
+               vector<valueType> & s2 ) {
+    valueType se[2], x, y ;
+    se[0] = A.s_min ; se[1] = A.s_max ;
+    for ( indexType i = 0 ; i < 2 ; ++i ) {
+      A.point( se[i], x, y ) ;
+      B.abscissae( x, y, sb ) ;
+      for ( size_t j = 0 ; j < sb.size() ; ++j ) addPair( A, B, se[i], sb[j], s1, s2 ) ;
+    }
+    se[0] = B.s_min ; se[1] = B.s_max ;
+    for ( indexType i = 0 ; i < 2 ; ++i ) {
+      B.point( se[i], x, y ) ;
+      A.abscissae( x, y, sa ) ;
+      for ( size_t j = 0 ; j < sa.size() ; ++j ) addPair( A, B, sa[j], se[i], s1, s2 ) ;
+    }
+  }
+
+  //! \endcond
+
+  bool
+  ClothoidCurve::isLineOrArc() const {
+    if ( dk != 0 ) return false ;
+    if ( isLine() ) return true ;
+    return std::abs(k)*(s_max-s_min) > ARC_ANALYTIC_MIN_ANGLE ;
+  }
+
+  void
+  ClothoidCurve::intersect_analytic( valueType             offs,
+                                     ClothoidCurve const & clot,
+                                     valueType             clot_offs,
+                                     vector<valueType>   & s1,
+                                     vector<valueType>   & s2,
+                                     vector<valueType>   & sa,
+                                     vector<valueType>   & sb ) const {
+    s1.clear() ;
+    s2.clear() ;
+    LineOrArc A( *this, offs ), B( clot, clot_offs ) ;
+    // points of intersection of the supporting lines/circles
+    valueType qx[2], qy[2] ;
+    indexType nq = 0 ;
+    if ( A.line && B.line ) {
+      // A.p + a * A.t = B.p + b * B.t
+      valueType det = A.tx*B.ty - A.ty*B.tx ;
+      valueType dx  = B.px - A.px ;
+      valueType dy  = B.py - A.py ;
+      if ( std::abs(det) <= ANALYTIC_TANGENT_TOL ) {
+        // parallel segments, overlapping when collinear
+        valueType dist = dx*A.ty - dy*A.tx ;
+        if ( std::abs(dist) <= max( A.tol, B.tol ) )
+          overlapEnds( A, B, sa, sb, s1, s2 ) ;
+        return ;
+      }
+      valueType a = (dx*B.ty - dy*B.tx)/det ;
+      qx[0] = A.px + a*A.tx ;
+      qy[0] = A.py + a*A.ty ;
+      nq    = 1 ;
+    } else if ( A.line || B.line ) {
+      LineOrArc const & L = A.line ? A : B ;
+      LineOrArc const & C = A.line ? B : A ;
+      if ( C.r == 0 ) return ; // the offset arc is a point
+      // |L.p + s * L.t - C.p|^2 = r^2
+      valueType ex   = L.px - C.px ;
+      valueType ey   = L.py - C.py ;
+      valueType bb   = ex*L.tx + ey*L.ty ;
+      valueType cc   = ex*ex + ey*ey - C.r*C.r ;
+      valueType disc = bb*bb - cc ;
+      valueType dtol = ANALYTIC_TANGENT_TOL*( bb*bb + ex*ex + ey*ey + C.r*C.r ) ;
+      if ( disc < -dtol ) return ;
+      if ( disc <= dtol ) {
+        // tangent, double root
+        qx[0] = L.px - bb*L.tx ;
+        qy[0] = L.py - bb*L.ty ;
+        nq    = 1 ;
+      } else {
+        valueType q = bb > 0 ? -(bb+sqrt(disc)) : sqrt(disc)-bb ;
+        valueType r[2] = { q, cc/q } ;
+        nq = 2 ;
+        for ( indexType i = 0 ; i < nq ; ++i ) {
+          qx[i] = L.px + r[i]*L.tx ;
+          qy[i] = L.py + r[i]*L.ty ;
+        }
+      }
+    } else {
+      if ( A.r == 0 || B.r == 0 ) return ; // degenerate
+      valueType dx = B.px - A.px ;
+      valueType dy = B.py - A.py ;
+      valueType d  = hypot( dx, dy ) ;
+      valueType rr = std::abs(A.r) + std::abs(B.r) ;
+      if ( d <= ANALYTIC_ABSCISSA_TOL*rr ) {
+        // concentric, overlapping when on the same circle
+        if ( std::abs( std::abs(A.r) - std::abs(B.r) ) <= ANALYTIC_ABSCISSA_TOL*rr )
+          overlapEnds( A, B, sa, sb, s1, s2 ) ;
+        return ;
+      }
+      valueType rA   = A.r*A.r ;
+      valueType a    = (rA-B.r*B.r+d*d)/(2*d) ;
+      valueType h2   = rA - a*a ;
+      valueType htol = ANALYTIC_TANGENT_TOL*( rA + B.r*B.r + d*d ) ;
+      if ( h2 < -htol ) return ;
+      valueType h  = h2 > htol ? sqrt(h2) : 0 ; // tangent, double root
+      valueType ex = dx/d ;
+      valueType ey = dy/d ;
+      qx[0] = A.px + a*ex - h*ey ;
+      qy[0] = A.py + a*ey + h*ex ;
+      qx[1] = A.px + a*ex + h*ey ;
+      qy[1] = A.py + a*ey - h*ex ;
+      nq    = h == 0 ? 1 : 2 ;
+    }
+    for ( indexType i = 0 ; i < nq ; ++i ) {
+      A.abscissae( qx[i], qy[i], sa ) ;
+      B.abscissae( qx[i], qy[i], sb ) ;
+      for ( size_t ia = 0 ; ia < sa.size() ; ++ia )
+        for ( size_t ib = 0 ; ib < sb.size() ; ++ib )
+          addPair( A, B, sa[ia], sb[ib], s1, s2 ) ;
+    }
+  }
+
+  //! \cond NODOC
+
+  // below this number of triangle pairs the nested loop is faster
+  static indexType const BROAD_PHASE_MIN_PAIRS = 400 ;
+
+  typedef IntersectWorkspace::Box SweepBox ;
+
+  //! \endcond
+
+  void
+  IntersectWorkspace::Box::setup( Triangle2D const & t, indexType _id, indexType _set ) {
+    xmin = min( t.x1(), min( t.x2(), t.x3() ) ) ;
+    ymin = min( t.y1(), min( t.y2(), t.y3() ) ) ;
+    xmax = max( t.x1(), max( t.x2(), t.x3() ) ) ;
+    ymax = max( t.y1(), max( t.y2(), t.y3() ) ) ;
+    id   = _id ;
+    set  = _set ;
+  }
+
+  //! \cond NODOC
+
+  /*
+   * Pairs (i,j) such that t0[i] overlaps t1[j], sorted lexicographically
+   * (i.e. in the order of the nested loop).
+   * For large problems the boxes of the triangles are swept along x
+   * (sort and sweep), only boxes overlapping in x and y are tested.
+   * `B`, `idx`, `boxes` and `active` are work buffers.
+   */
+  static
+  void
+  overlappingPairs( vector<Triangle2D> const         & t0,
+                    vector<Triangle2D> const         & t1,
+                    Triangle2DBatch                    & B,
+                    vector<indexType>                  & idx,
+                    vector<SweepBox>                   & boxes,
+                    vector<SweepBox>                     active[2],
+                    vector<pair<indexType,indexType> > & pairs ) {
+    indexType n0 = indexType(t0.size()) ;
+    indexType n1 = indexType(t1.size()) ;
+    pairs.clear() ;
+    if ( n0*n1 < BROAD_PHASE_MIN_PAIRS ) {
+      // one triangle against all the others, the buffers are reused
+      B.setup( t1 ) ;
+      idx.resize( size_t(n1)+1 ) ;
+      for ( indexType i = 0 ; i < n0 ; ++i ) {
+        indexType n = B.overlap( PreparedTriangle2D( t0[i] ), &idx.front() ) ;
+        for ( indexType k = 0 ; k < n ; ++k )
+          pairs.push_back( pair<indexType,indexType>(i,idx[k]) ) ;
+      }
+      return ;
+    }
+    boxes.resize( size_t(n0+n1) ) ;
+    for ( indexType i = 0 ; i < n0 ; ++i ) boxes[i].setup( t0[i], i, 0 ) ;
+    for ( indexType j = 0 ; j < n1 ; ++j ) boxes[n0+j].setup( t1[j], j, 1 ) ;
+    sort( boxes.begin(), boxes.end() ) ;
+    active[0].clear() ;
+    active[1].clear() ;
+    for ( size_t k = 0 ; k < boxes.size() ; ++k ) {
+      SweepBox const   & b     = boxes[k] ;
+      vector<SweepBox> & other = active[1-b.set] ;
+      // drop the boxes left behind and test the others
+      size_t nk = 0 ;
+      for ( size_t l = 0 ; l < other.size() ; ++l ) {
+        SweepBox const & o = other[l] ;
+        if ( o.xmax < b.xmin ) continue ;
+        other[nk++] = o ;
+        if ( o.ymin > b.ymax || b.ymin > o.ymax ) continue ;
+        indexType i = b.set == 0 ? b.id : o.id ;
+        indexType j = b.set == 0 ? o.id : b.id ;
+        if ( t0[i].overlap(t1[j]) )
+          pairs.push_back( pair<indexType,indexType>(i,j) ) ;
+      }
+      other.resize( nk ) ;
+      active[b.set].push_back( b ) ;
+    }
+    sort( pairs.begin(), pairs.end() ) ;
+  }
+
+  // leaves of the adaptive splitting of ClothoidCurve::intersect
+  static valueType const ADAPTIVE_SPLIT_ANGLE = m_pi/50 ;
+
+  // two nearly parallel leaves are split until they turn less than this
+  static valueType const ADAPTIVE_MIN_ANGLE = 1e-4 ;
+
+  // the headings of the leaves, modulo pi, are closer than the sum of their
+  // turns: the curves may cross twice or at an angle too small for the
+  // Newton steps from the ends of the leaves
+  static
+  bool
+  nearlyParallel( SplitNode const & A, SplitNode const & B ) {
+    valueType wa = std::abs( A.b.theta - A.a.theta ) ;
+    valueType wb = std::abs( B.b.theta - B.a.theta ) ;
+    valueType d  = ( A.a.theta + A.b.theta - B.a.theta - B.b.theta )/2 ;
+    d -= m_pi*floor( d/m_pi + 0.5 ) ;
+    return std::abs(d) <= wa+wb ;
+  }
+
+  // pairs of leaves in the order of the nested loop on the segments of bbSplit
+  class LeafPairLess {
+    vector<SplitNode> const & n0 ;
+    vector<SplitNode> const & n1 ;
+  public:
+    LeafPairLess( vector<SplitNode> const & _n0, vector<SplitNode> const & _n1 )
+    : n0(_n0), n1(_n1) {}
+
+    bool
+    operator () ( pair<indexType,indexType> const & p,
+                  pair<indexType,indexType> const & q ) const {
+      if ( n0[p.first].a.s != n0[q.first].a.s ) return n0[p.first].a.s < n0[q.first].a.s ;
+      return n1[p.second].a.s < n1[q.second].a.s ;
+    }
+  } ;
+
+  // leaves of the tree `nodes` used by `pairs`, stored in `c`, the pairs renumbered
+  static
+  void
+  adaptiveLeaves( ClothoidCurve const              & curve,
+                  vector<SplitNode> const          & nodes,
+                  bool                               second,
+                  vector<pair<indexType,indexType> > & pairs,
+                  vector<indexType>                & id,
+                  vector<ClothoidCurve>            & c ) {
+    id.assign( nodes.size(), -1 ) ;
+    c.clear() ;
+    for ( size_t k = 0 ; k < pairs.size() ; ++k ) {
+      indexType & i = second ? pairs[k].second : pairs[k].first ;
+      if ( id[i] < 0 ) {
+        id[i] = indexType(c.size()) ;
+        c.push_back( curve ) ;
+        c.back().trim( nodes[i].a.s, nodes[i].b.s ) ;
+      }
+      i = id[i] ;
+    }
+  }
+
+  /*
+   * The bisection trees of the two curves are descended together as in
+   * approsimate_collision, the larger node is split where the boxes
+   * overlap, a leaf turns at most ADAPTIVE_SPLIT_ANGLE.
+   * Of two nearly parallel leaves with overlapping triangles the one
+   * turning more is split again, down to ADAPTIVE_MIN_ANGLE: a pair holds
+   * at most one root, in the basin of Newton from the ends of the leaves.
+   * The pairs of leaves with overlapping triangles are returned sorted
+   * by the position of the leaves along the curves.
+   */
+  static
+  void
+  adaptivePairs( ClothoidCurve const              & curve0,
+                 valueType                          offs0,
+                 ClothoidCurve const              & curve1,
+                 valueType                          offs1,
+                 vector<SplitNode>                & n0,
+                 vector<SplitNode>                & n1,
+                 vector<pair<indexType,indexType> > & stack,
+                 vector<indexType>                & id,
+                 vector<ClothoidCurve>            & c0,
+                 vector<ClothoidCurve>            & c1,
+                 vector<pair<indexType,indexType> > & pairs ) {
+    ClothoidEvaluator e0(curve0), e1(curve1) ;
+    indexType n_eval = 0 ;
+    splitRoot( curve0, e0, offs0, ADAPTIVE_SPLIT_ANGLE, HUGE_VAL, n0, n_eval ) ;
+    splitRoot( curve1, e1, offs1, ADAPTIVE_SPLIT_ANGLE, HUGE_VAL, n1, n_eval ) ;
+    pairs.clear() ;
+    stack.clear() ;
+    stack.push_back( pair<indexType,indexType>(0,0) ) ;
+    while ( !stack.empty() ) {
+      indexType i = stack.back().first ;
+      indexType j = stack.back().second ;
+      stack.pop_back() ;
+      SplitNode const & A = n0[i] ;
+      SplitNode const & B = n1[j] ;
+      if ( !A.overlap( B ) ) continue ;
+      bool split_a ;
+      if ( A.leaf && B.leaf ) {
+        if ( !A.t.overlap( B.t ) ) continue ;
+        valueType wa = std::abs( A.b.theta - A.a.theta ) ;
+        valueType wb = std::abs( B.b.theta - B.a.theta ) ;
+        split_a = wa >= wb ;
+        if ( max( wa, wb ) <= ADAPTIVE_MIN_ANGLE || !nearlyParallel( A, B ) ||
+             ( split_a ? A : B ).depth >= SPLIT_MAX_DEPTH ) {
+          pairs.push_back( pair<indexType,indexType>(i,j) ) ;
+          continue ;
+        }
+      } else {
+        split_a = B.leaf || ( !A.leaf && A.size() >= B.size() ) ;
+      }
+      if ( split_a ) {
+        if ( A.child < 0 ) splitOpen( curve0, e0, offs0, ADAPTIVE_SPLIT_ANGLE, HUGE_VAL, n0, i, n_eval ) ;
+        indexType ic = n0[i].child ;
+        stack.push_back( pair<indexType,indexType>(ic+1,j) ) ;
+        stack.push_back( pair<indexType,indexType>(ic,j) ) ;
+      } else {
+        if ( B.child < 0 ) splitOpen( curve1, e1, offs1, ADAPTIVE_SPLIT_ANGLE, HUGE_VAL, n1, j, n_eval ) ;
+        indexType jc = n1[j].child ;
+        stack.push_back( pair<indexType,indexType>(i,jc+1) ) ;
+        stack.push_back( pair<indexType,indexType>(i,jc) ) ;
+      }
+    }
+    sort( pairs.begin(), pairs.end(), LeafPairLess( n0, n1 ) ) ;
+    adaptiveLeaves( curve0, n0, false, pairs, id, c0 ) ;
+    adaptiveLeaves( curve1, n1, true,  pairs, id, c1 ) ;
+  }
+
+  //! \endcond
+
+  size_t
+  IntersectWorkspace::capacity() const {
+    return c0.capacity() + c1.capacity() + t0.capacity() + t1.capacity() +
+           n0.capacity() + n1.capacity() + pairs.capacity() + stack.capacity() +
+           id.capacity() + sa.capacity() + sb.capacity() + tb.capacity() +
+           m0.capacity() + m1.capacity() + boxes.capacity() + active[0].capacity() +
+           active[1].capacity() + r1.capacity() + r2.capacity() + found.capacity() ;
+  }
+
+  void
+  IntersectWorkspace::clear() {
+    // swap with empty vectors to release the memory
+    vector<ClothoidCurve>().swap( c0 ) ;
+    vector<ClothoidCurve>().swap( c1 ) ;
+    vector<Triangle2D>().swap( t0 ) ;
+    vector<Triangle2D>().swap( t1 ) ;
+    vector<Node>().swap( n0 ) ;
+    vector<Node>().swap( n1 ) ;
+    vector<pair<indexType,indexType> >().swap( pairs ) ;
+    vector<pair<indexType,indexType> >().swap( stack ) ;
+    vector<indexType>().swap( id ) ;
+    vector<valueType>().swap( sa ) ;
+    vector<valueType>().swap( sb ) ;
+    tb.clear() ;
+    vector<TaylorModel>().swap( m0 ) ;
+    vector<TaylorModel>().swap( m1 ) ;
+    vector<Box>().swap( boxes ) ;
+    vector<Box>().swap( active[0] ) ;
+    vector<Box>().swap( active[1] ) ;
+    vector<valueType>().swap( r1 ) ;
+    vector<valueType>().swap( r2 ) ;
+    vector<char>().swap( found ) ;
+  }
+
+  void
+  ClothoidCurve::intersect( valueType             offs,
+                            ClothoidCurve const & clot,
+                            valueType             clot_offs,
+                            vector<valueType>   & s1,
+                            vector<valueType>   & s2,
+                            indexType             max_iter,
+                            valueType             tolerance ) const {
+    indexType n_eval ;
+    intersect( offs, clot, clot_offs, s1, s2, max_iter, tolerance, REFINE_NEWTON, n_eval ) ;
+  }
+
+  void
+  ClothoidCurve::intersect( valueType             offs,
+                            ClothoidCurve const & clot,
+                            valueType             clot_offs,
+                            vector<valueType>   & s1,
+                            vector<valueType>   & s2,
+                            indexType             max_iter,
+                            valueType             tolerance,
+                            IntersectWorkspace  & ws ) const {
+    intersect( offs, clot, clot_offs, s1, s2, max_iter, tolerance, SPLIT_ADAPTIVE, ws ) ;
+  }
+
+  void
+  ClothoidCurve::intersect( valueType             offs,
+                            ClothoidCurve const & clot,
+                            valueType             clot_offs,
+                            vector<valueType>   & s1,
+                            vector<valueType>   & s2,
+                            indexType             max_iter,
+                            valueType             tolerance,
+                            SplitPolicy           split ) const {
+    IntersectWorkspace ws ;
+    intersect( offs, clot, clot_offs, s1, s2, max_iter, tolerance, split, ws ) ;
+  }
+
+  void
+  ClothoidCurve::intersect( valueType             offs,
+                            ClothoidCurve const & clot,
+                            valueType             clot_offs,
+                            vector<valueType>   & s1,
+                            vector<valueType>   & s2,
+                            indexType             max_iter,
+                            valueType             tolerance,
+                            SplitPolicy           split,
+                            IntersectWorkspace  & ws ) const {
+    size_t cap = ws.capacity() + s1.capacity() + s2.capacity() ;
+    if ( isLineOrArc() && clot.isLineOrArc() ) {
+      intersect_analytic( offs, clot, clot_offs, s1, s2, ws.sa, ws.sb ) ;
+    } else {
+      indexType n_eval = 0 ;
+      intersect_split( offs, clot, clot_offs, s1, s2, max_iter, tolerance, false, 0,
+                       split, REFINE_NEWTON, n_eval, ws ) ;
+    }
+    ws.count( cap, ws.capacity() + s1.capacity() + s2.capacity() ) ;
+  }
+
+  void
+  ClothoidCurve::intersect( valueType             offs,
+                            ClothoidCurve const & clot,
+                            valueType             clot_offs,
+                            vector<valueType>   & s1,
+                            vector<valueType>   & s2,
+                            indexType             max_iter,
+                            valueType             tolerance,
+                            IntersectRefine       refine,
+                            indexType           & n_eval ) const {
+    IntersectWorkspace ws ;
+    n_eval = 0 ;
+    if ( isLineOrArc() && clot.isLineOrArc() ) {
+      intersect_analytic( offs, clot, clot_offs, s1, s2, ws.sa, ws.sb ) ;
+      return ;
+    }
+    intersect_split( offs, clot, clot_offs, s1, s2, max_iter, tolerance, false, 0,
+                     SPLIT_ADAPTIVE, refine, n_eval, ws ) ;
+  }
+
+  void
+  ClothoidCurve::intersect_parallel( valueType             offs,
+                                     ClothoidCurve const & clot,
+                                     valueType             clot_offs,
+                                     vector<valueType>   & s1,
+                                     vector<valueType>   & s2,
+                                     indexType             max_iter,
+                                     valueType             tolerance,
+                                     indexType             min_pairs ) const {
+    IntersectWorkspace ws ;
+    intersect_parallel( offs, clot, clot_offs, s1, s2, max_iter, tolerance, min_pairs, ws ) ;
+  }
+
+  void
+  ClothoidCurve::intersect_parallel( valueType             offs,
+                                     ClothoidCurve const & clot,
+                                     valueType             clot_offs,
+                                     vector<valueType>   & s1,
+                                     vector<valueType>   & s2,
+                                     indexType             max_iter,
+                                     valueType             tolerance,
+                                     indexType             min_pairs,
+                                     IntersectWorkspace  & ws ) const {
+    size_t cap = ws.capacity() + s1.capacity() + s2.capacity() ;
+    if ( isLineOrArc() && clot.isLineOrArc() ) {
+      intersect_analytic( offs, clot, clot_offs, s1, s2, ws.sa, ws.sb ) ;
+    } else {
+      indexType n_eval = 0 ;
+      intersect_split( offs, clot, clot_offs, s1, s2, max_iter, tolerance, true, min_pairs,
+                       SPLIT_ADAPTIVE, REFINE_NEWTON, n_eval, ws ) ;
+    }
+    ws.count( cap, ws.capacity() + s1.capacity() + s2.capacity() ) ;
+  }
+
+  void
+  ClothoidCurve::intersect_split( valueType             offs,
+                                  ClothoidCurve const & clot,
+                                  valueType             clot_offs,
+                                  vector<valueType>   & s1,
+                                  vector<valueType>   & s2,
+                                  indexType             max_iter,
+                                  valueType             tolerance,
+                                  bool                  parallel,
+                                  indexType             min_pairs,
+                                  SplitPolicy           split,
+                                  IntersectRefine       refine,
+                                  indexType           & n_eval,
+                                  IntersectWorkspace  & ws ) const {
+    vector<ClothoidCurve>              & c0    = ws.c0 ;
+    vector<ClothoidCurve>              & c1    = ws.c1 ;
+    vector<pair<indexType,indexType> > & pairs = ws.pairs ;
+    if ( split == SPLIT_FIXED ) {
+      bbSplit( m_pi/50, (s_max-s_min)/3, offs, c0, ws.t0 ) ;
+      clot.bbSplit( m_pi/50, (clot.s_max-clot.s_min)/3, clot_offs, c1, ws.t1 ) ;
+      overlappingPairs( ws.t0, ws.t1, ws.tb, ws.id, ws.boxes, ws.active, pairs ) ;
+    } else {
+      adaptivePairs( *this, offs, clot, clot_offs,
+                     ws.n0, ws.n1, ws.stack, ws.id, c0, c1, pairs ) ;
+    }
+    s1.clear() ;
+    s2.clear() ;
+    indexType np = indexType(pairs.size()) ;
+    // the models of the leaves in a pair, once for each leaf
+    TaylorModel const * m0 = 0, * m1 = 0 ;
+    if ( refine == REFINE_TAYLOR && np > 0 ) {
+      ws.m0.assign( c0.size(), TaylorModel() ) ;
+      ws.m1.assign( c1.size(), TaylorModel() ) ;
+      for ( indexType k = 0 ; k < np ; ++k ) {
+        TaylorModel & a = ws.m0[pairs[k].first] ;
+        TaylorModel & b = ws.m1[pairs[k].second] ;
+        if ( a.h < 0 ) { a.setup( c0[pairs[k].first], offs ) ;       if ( a.use ) ++n_eval ; }
+        if ( b.h < 0 ) { b.setup( c1[pairs[k].second], clot_offs ) ; if ( b.use ) ++n_eval ; }
+      }
+      m0 = &ws.m0.front() ;
+      m1 = &ws.m1.front() ;
+    }
+    if ( !parallel || np < min_pairs ) {
+      for ( indexType k = 0 ; k < np ; ++k ) {
+        indexType i = pairs[k].first ;
+        indexType j = pairs[k].second ;
+        // uso newton per cercare intersezione
+        valueType tmp_s1, tmp_s2 ;
+        indexType ne ;
+        bool ok = intersect_internal( c0[i], offs,      tmp_s1, c0[i].s_max >= s_max,
+                                      c1[j], clot_offs, tmp_s2, c1[j].s_max >= clot.s_max,
+                                      max_iter, tolerance,
+                                      m0 ? m0+i : 0, m1 ? m1+j : 0, ne ) ;
+        n_eval += ne ;
+        if ( ok ) pushRoot( tmp_s1, tmp_s2, tolerance, s1, s2 ) ;
+      }
+      return ;
+    }
+    // results stored by pair and merged in order
+    vector<valueType> & tmp_s1 = ws.r1 ;
+    vector<valueType> & tmp_s2 = ws.r2 ;
+    vector<char>      & ok     = ws.found ;
+    tmp_s1.resize( size_t(np) ) ;
+    tmp_s2.resize( size_t(np) ) ;
+    ok.assign( size_t(np), 0 ) ;
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic,4) reduction(+:n_eval)
+    #endif
+    for ( indexType k = 0 ; k < np ; ++k ) {
+      indexType     i = pairs[k].first ;
+      indexType     j = pairs[k].second ;
+      ClothoidCurve cc0( c0[i] ), cc1( c1[j] ) ;
+      indexType     ne ;
+      ok[k] = intersect_internal( cc0, offs,      tmp_s1[k], cc0.s_max >= s_max,
+                                  cc1, clot_offs, tmp_s2[k], cc1.s_max >= clot.s_max,
+                                  max_iter, tolerance,
+                                  m0 ? m0+i : 0, m1 ? m1+j : 0, ne ) ;
+      n_eval += ne ;
+    }
+    for ( indexType k = 0 ; k < np ; ++k )
+      if ( ok[k] ) pushRoot( tmp_s1[k], tmp_s2[k], tolerance, s1, s2 ) ;
+  }
+  
+  // collision detection
+  bool
+  ClothoidCurve::approsimate_collision( valueType             offs,
+                                        ClothoidCurve const & clot,
+                                        valueType             clot_offs,
+                                        valueType             max_angle,
+                                        valueType             max_size ) const {
+    indexType n_eval ;
+    return approsimate_collision( offs, clot, clot_offs, max_angle, max_size, n_eval ) ;
+  }
+
+  /*
+   * The bisection trees of the two curves are descended together and
+   * a node is split only when its box overlaps the box of the other node.
+   * The leaves are the segments of bbSplit, so the answer is the one of
+   * the test of all the pairs of triangles.
+   */
+  bool
+  ClothoidCurve::approsimate_collision( valueType             offs,
+                                        ClothoidCurve const & clot,
+                                        valueType             clot_offs,
+                                        valueType             max_angle,
+                                        valueType             max_size,
+                                        indexType           & n_eval ) const {
+    IntersectWorkspace ws ;
+    return collision_internal( offs, clot, clot_offs, max_angle, max_size, n_eval, ws ) ;
+  }
+
+  bool
+  ClothoidCurve::approsimate_collision( valueType             offs,
+                                        ClothoidCurve const & clot,
+                                        valueType             clot_offs,
+                                        valueType             max_angle,
+                                        valueType             max_size,
+                                        IntersectWorkspace  & ws ) const {
+    size_t    cap = ws.capacity() ;
+    indexType n_eval ;
+    bool      ok  = collision_internal( offs, clot, clot_offs, max_angle, max_size, n_eval, ws ) ;
+    ws.count( cap, ws.capacity() ) ;
+    return ok ;
+  }
+
+  bool
+  ClothoidCurve::collision_internal( valueType             offs,
+                                     ClothoidCurve const & clot,
+                                     valueType             clot_offs,
+                                     valueType             max_angle,
+                                     valueType             max_size,
+                                     indexType           & n_eval,
+                                     IntersectWorkspace  & ws ) const {
+    ClothoidEvaluator e0(*this), e1(clot) ;
+    vector<SplitNode>                  & n0    = ws.n0 ;
+    vector<SplitNode>                  & n1    = ws.n1 ;
+    vector<pair<indexType,indexType> > & stack = ws.stack ;
+    n_eval = 0 ;
+    splitRoot( *this, e0, offs,      max_angle, max_size, n0, n_eval ) ;
+    splitRoot( clot,  e1, clot_offs, max_angle, max_size, n1, n_eval ) ;
+    stack.clear() ;
+    stack.push_back( pair<indexType,indexType>(0,0) ) ;
+    while ( !stack.empty() ) {
+      indexType i = stack.back().first ;
+      indexType j = stack.back().second ;
+      stack.pop_back() ;
+      SplitNode const & A = n0[i] ;
+      SplitNode const & B = n1[j] ;
+      if ( !A.overlap( B ) ) continue ;
+      if ( A.leaf && B.leaf ) {
+        if ( A.t.overlap( B.t ) ) return true ;
+      } else if ( B.leaf || ( !A.leaf && A.size() >= B.size() ) ) {
+        if ( A.child < 0 ) splitOpen( *this, e0, offs, max_angle, max_size, n0, i, n_eval ) ;
+        indexType ic = n0[i].child ;
+        stack.push_back( pair<indexType,indexType>(ic+1,j) ) ;
+        stack.push_back( pair<indexType,indexType>(ic,j) ) ;
+      } else {
+        if ( B.child < 0 ) splitOpen( clot, e1, clot_offs, max_angle, max_size, n1, j, n_eval ) ;
+        indexType jc = n1[j].child ;
+        stack.push_back( pair<indexType,indexType>(i,jc+1) ) ;
+        stack.push_back( pair<indexType,indexType>(i,jc) ) ;
+      }
+    }
+    return false ;
+  }
+
+  /*
+   * Best first descent of the bisection trees of the two curves:
+   * the pair of nodes with the smallest distance of the boxes is split
+   * first, the end points of the nodes give upper bounds and the pairs
+   * of leaves are refined with Newton.
+   * A pair is discarded when its lower bound is not below the best
+   * distance found minus `tolerance`.
+   */
+  valueType
+  ClothoidCurve::distance( valueType             offs,
+                           ClothoidCurve const & clot,
+                           valueType             clot_offs,
+                           valueType           & s1,
+                           valueType           & s2,
+                           valueType             tolerance,
+                           valueType             threshold ) const {
+    ClothoidEvaluator e0(*this), e1(clot) ;
+    vector<SplitNode> n0, n1 ;
+    indexType n_eval = 0 ;
+    splitRoot( *this, e0, offs,      DISTANCE_SPLIT_ANGLE, HUGE_VAL, n0, n_eval ) ;
+    splitRoot( clot,  e1, clot_offs, DISTANCE_SPLIT_ANGLE, HUGE_VAL, n1, n_eval ) ;
+
+    valueType best = HUGE_VAL ;
+    s1 = s_min ;
+    s2 = clot.s_min ;
+
+    vector<DistancePair> heap ;
+    DistancePairGreater  cmp ;
+    heap.push_back( DistancePair( splitBoxDistance( n0[0], n1[0] ), 0, 0 ) ) ;
+    while ( !heap.empty() && best > threshold ) {
+      std::pop_heap( heap.begin(), heap.end(), cmp ) ;
+      DistancePair P = heap.back() ;
+      heap.pop_back() ;
+      if ( P.lower >= best - tolerance ) break ; // all the others are farther
+
+      // upper bound from the end points
+      SplitPoint const * pa[2] = { &n0[P.i].a, &n0[P.i].b } ;
+      SplitPoint const * pb[2] = { &n1[P.j].a, &n1[P.j].b } ;
+      for ( indexType ia = 0 ; ia < 2 ; ++ia ) {
+        valueType xa, ya ;
+        splitOffset( *pa[ia], offs, xa, ya ) ;
+        for ( indexType ib = 0 ; ib < 2 ; ++ib ) {
+          valueType xb, yb ;
+          splitOffset( *pb[ib], clot_offs, xb, yb ) ;
+          valueType d = hypot( xa-xb, ya-yb ) ;
+          if ( d < best ) { best = d ; s1 = pa[ia]->s ; s2 = pb[ib]->s ; }
+        }
+      }
+
+      SplitNode const & A = n0[P.i] ;
+      SplitNode const & B = n1[P.j] ;
+      if ( A.leaf && B.leaf ) {
+        valueType ss1 = A.s_mid, ss2 = B.s_mid ;
+        valueType d = distanceNewton( e0, offs,      A.a.s, A.b.s,
+                                      e1, clot_offs, B.a.s, B.b.s,
+                                      ss1, ss2, tolerance ) ;
+        if ( d < best ) { best = d ; s1 = ss1 ; s2 = ss2 ; }
+      } else if ( B.leaf || ( !A.leaf && A.size() >= B.size() ) ) {
+        if ( A.child < 0 ) splitOpen( *this, e0, offs, DISTANCE_SPLIT_ANGLE, HUGE_VAL, n0, P.i, n_eval ) ;
+        for ( indexType k = 0 ; k < 2 ; ++k ) {
+          indexType ic = n0[P.i].child+k ;
+          valueType lb = splitBoxDistance( n0[ic], n1[P.j] ) ;
+          if ( lb < best - tolerance ) {
+            heap.push_back( DistancePair( lb, ic, P.j ) ) ;
+            std::push_heap( heap.begin(), heap.end(), cmp ) ;
+          }
+        }
+      } else {
+        if ( B.child < 0 ) splitOpen( clot, e1, clot_offs, DISTANCE_SPLIT_ANGLE, HUGE_VAL, n1, P.j, n_eval ) ;
+        for ( indexType k = 0 ; k < 2 ; ++k ) {
+          indexType jc = n1[P.j].child+k ;
+          valueType lb = splitBoxDistance( n0[P.i], n1[jc] ) ;
+          if ( lb < best - tolerance ) {
+            heap.push_back( DistancePair( lb, P.i, jc ) ) ;
+            std::push_heap( heap.begin(), heap.end(), cmp ) ;
+          }
+        }
+      }
+    }
+    return best ;
   }
 
   void
@@ -24,12 +24,16 @@
 #ifndef CLOTHOID_HH
 #define CLOTHOID_HH
 
+#include <cmath>
 #include <vector>
+#include <utility>
+#include <iostream>
 
 //! Clothoid computations routine
 namespace Clothoid {
 
   using std::vector ;
+  using std::pair ;
 
   typedef double valueType ;
   typedef int    indexType ;
@@ -105,6 +109,23 @@ namespace Clothoid {
                         valueType   c,
                         valueType & intC,
                         valueType & intS ) ;
+
+  /*! \brief Same as `GeneralizedFresnelCS(a,b,c,intC,intS)` with
+   *         \f$ \cos c \f$ and \f$ \sin c \f$ computed by the caller
+   * \param a      parameter \f$ a \f$
+   * \param b      parameter \f$ b \f$
+   * \param cosc   \f$ \cos c \f$
+   * \param sinc   \f$ \sin c \f$
+   * \param intC   cosine integrals,
+   * \param intS   sine integrals
+   */
+  void
+  GeneralizedFresnelCS( valueType   a,
+                        valueType   b,
+                        valueType   cosc,
+                        valueType   sinc,
+                        valueType & intC,
+                        valueType & intS ) ;
   
   /*\
    |    ____ _       _   _           _     _
@@ -157,7 +178,29 @@ namespace Clothoid {
   valueType
   LommelReduced( valueType mu, valueType nu, valueType z ) ;
   
+  //! Orientation of `a`, `b`, `c`: positive if counterclockwise, negative if clockwise, zero if aligned
+  /*!
+   * Adaptive predicate, the sign is exact: floating point evaluation with
+   * a static error bound, exact arithmetic only for the ambiguous cases.
+   */
+  valueType
+  orient2d( valueType const a[2], valueType const b[2], valueType const c[2] ) ;
+
+  //! Number of `orient2d` evaluations and of those that needed exact arithmetic
+  /*!
+   * Counted only when the library is compiled with `CLOTHOID_PREDICATE_STATS`,
+   * otherwise both are zero.
+   */
+  void
+  orient2dStats( unsigned long & n_calls, unsigned long & n_exact ) ;
+
+  //! Reset the counters of `orient2dStats`
+  void
+  orient2dStatsReset() ;
+
   class ClothoidCurve ; // forward declaration
+  class IntersectWorkspace ;
+  class TaylorModel ;
 
   /*\
    |   _____     _                   _      ____  ____
@@ -209,9 +252,123 @@ namespace Clothoid {
     bool overlap( Triangle2D const & t2 ) const ;
     
     friend class ClothoidCurve ;
+    friend class ClothoidEvaluator ;
+    friend class PreparedTriangle2D ;
 
   };
-  
+
+  //! \brief Triangle2D with counterclockwise vertices and edge normals
+  /*!
+   * Prepared once for the repeated test of a triangle against many
+   * triangles with `Triangle2DBatch::overlap`.
+   */
+  class PreparedTriangle2D {
+
+    Triangle2D tri ;                  //!< original triangle
+    valueType  x[3], y[3] ;           //!< counterclockwise vertices
+    valueType  nx[3], ny[3], d[3] ;   //!< edge `i` outward unit normal, inside is `nx*x+ny*y <= d`
+    valueType  tol ;                  //!< margin of the separation test
+    valueType  acc ;                  //!< `-tol`, `-infinity` for a degenerate triangle (never accepted without the exact test)
+    valueType  xmin, ymin, xmax, ymax ;
+
+    friend class Triangle2DBatch ;
+
+  public:
+
+    PreparedTriangle2D() {}
+
+    explicit
+    PreparedTriangle2D( Triangle2D const & t )
+    { setup( t ) ; }
+
+    void setup( Triangle2D const & t ) ;
+
+    Triangle2D const & triangle() const { return tri ; }
+
+  } ;
+
+  /*\
+   |   _____     _                   _      ____  ____  ____        _       _
+   |  |_   _| __(_) __ _ _ __   __ _| | ___|___ \|  _ \| __ )  __ _| |_ ___| |__
+   |    | || '__| |/ _` | '_ \ / _` | |/ _ \ __) | | | |  _ \ / _` | __/ __| '_ \
+   |    | || |  | | (_| | | | | (_| | |  __// __/| |_| | |_) | (_| | || (__| | | |
+   |    |_||_|  |_|\__,_|_| |_|\__, |_|\___|_____|____/|____/ \__,_|\__\___|_| |_|
+   |                           |___/
+  \*/
+  //! \brief Set of prepared triangles stored as structure of arrays
+  /*!
+   * One triangle is tested against the whole set, 8 or 4 triangles at
+   * once with AVX-512 or AVX2 (when the library is compiled for them,
+   * scalar loop otherwise).
+   * The triangles with disjoint boxes are rejected, then the separating
+   * axis test on the edge normals rejects the triangles far apart by more
+   * than a small margin and accepts the non degenerate triangles
+   * overlapping by more than the margin on all the axes; only the
+   * remaining ones are checked with `Triangle2D::overlap`.
+   * The result is the same of `Triangle2D::overlap` on every pair.
+   */
+  class Triangle2DBatch {
+
+    vector<Triangle2D> tri ;  //!< original triangles
+    vector<valueType>  data ; //!< columns x[3], y[3], nx[3], ny[3], d[3], tol, acc, xmin, ymin, xmax, ymax
+    indexType          n ;
+
+    valueType const * col( indexType k ) const { return &data[size_t(k*n)] ; }
+
+  public:
+
+    Triangle2DBatch() : n(0) {}
+
+    explicit
+    Triangle2DBatch( vector<Triangle2D> const & t ) : n(0)
+    { setup( t ) ; }
+
+    void setup( vector<Triangle2D> const & t ) ;
+
+    indexType size() const { return n ; }
+
+    //! total capacity of the buffers, reused by the next `setup`
+    size_t capacity() const { return tri.capacity() + data.capacity() ; }
+
+    //! release the memory
+    void clear() ;
+
+    /*! \brief triangles of the batch overlapping `t`
+     *
+     * Store in `idx` (of size at least `size()`), in increasing order,
+     * the indices `j` such that `t.triangle().overlap(tri[j])`,
+     * return their number.
+     */
+    indexType overlap( PreparedTriangle2D const & t, indexType idx[] ) const ;
+
+  } ;
+
+  /*\
+   |   ____   ____                ____  ____
+   |  | __ ) | __ )   ___  __  __|___ \|  _ \
+   |  |  _ \ |  _ \  / _ \ \ \/ /  __) | | | |
+   |  | |_) || |_) || (_) | >  <  / __/| |_| |
+   |  |____/ |____/  \___/ /_/\_\|_____|____/
+  \*/
+  //! \brief Axis aligned bounding box
+  class BBox2D {
+  public:
+    valueType xmin, ymin, xmax, ymax ;
+
+    BBox2D() : xmin(0), ymin(0), xmax(0), ymax(0) {}
+
+    BBox2D( valueType _xmin, valueType _ymin, valueType _xmax, valueType _ymax )
+    : xmin(_xmin), ymin(_ymin), xmax(_xmax), ymax(_ymax)
+    {}
+
+    bool
+    overlap( BBox2D const & b ) const {
+      return xmin <= b.xmax && b.xmin <= xmax &&
+             ymin <= b.ymax && b.ymin <= ymax ;
+    }
+
+  } ;
+
   /*\
    |    ____ _       _   _           _     _  ____
    |   / ___| | ___ | |_| |__   ___ (_) __| |/ ___|   _ _ ____   _____
@@ -222,6 +379,32 @@ namespace Clothoid {
   //! \brief Class to manage Clothoid Curve
   class ClothoidCurve {
 
+  public:
+
+    /*! \brief refinement of the intersection of two leaf segments
+     *
+     * `REFINE_NEWTON` iterates Newton on the curves, `REFINE_TAYLOR`
+     * iterates on the cubic Taylor expansions of the two segments at
+     * their middle points and ends with exact Newton steps.
+     */
+    enum IntersectRefine { REFINE_NEWTON, REFINE_TAYLOR } ;
+
+    /*! \brief splitting of the two curves in `intersect`
+     *
+     * `SPLIT_FIXED` splits both curves with
+     * `bbSplit(m_pi/50,(s_max-s_min)/3,...)` and refines all the pairs
+     * of overlapping triangles. `SPLIT_ADAPTIVE` descends the bisection
+     * trees of the two curves together: a node is split only where its
+     * box overlaps the box of the other node, until it turns at most
+     * `m_pi/50`, as in `SPLIT_FIXED`, with no limit on its length.
+     * Two nearly parallel leaves are split further, so that each pair
+     * holds at most one intersection.
+     */
+    enum SplitPolicy { SPLIT_FIXED, SPLIT_ADAPTIVE } ;
+
+  private:
+
+    // ClothoidBatch::view relies on these 7 values, in this order and with no padding
     valueType x0,       //!< initial x coordinate of the clothoid
               y0,       //!< initial y coordinate of the clothoid
               theta0 ;  //!< initial angle of the clothoid
@@ -231,19 +414,80 @@ namespace Clothoid {
               s_min,    //!< initial curvilinear coordinate of the clothoid segment
               s_max ;   //!< final curvilinear coordinate of the clothoid segment
 
+    /*! \brief Use newton to intersect two small clothoid segment
+     *
+     * A root is accepted in `[s_min,s_max)` of a segment, and in
+     * `[s_min,s_max]` when `c1_last` (`c2_last`) tells that the segment is
+     * the last one of its curve (the same root accepted on two segments
+     * within the tolerance is dropped by `pushRoot`). `n_eval` is the
+     * number of evaluations of the curves.
+     * With the models `m1`, `m2` of the segments (`REFINE_TAYLOR`) Newton
+     * starts from the intersection of the models, without them (NULL,
+     * `REFINE_NEWTON`) from the end points.
+     */
+    bool
+    intersect_internal( ClothoidCurve     & c1, valueType c1_offs, valueType & s1, bool c1_last,
+                        ClothoidCurve     & c2, valueType c2_offs, valueType & s2, bool c2_last,
+                        indexType           max_iter,
+                        valueType           tolerance,
+                        TaylorModel const * m1,
+                        TaylorModel const * m2,
+                        indexType         & n_eval ) const ;
+
+    //! append the root `(a,b)` unless already found on the common end of two segments (within `100*tolerance` in both abscissae)
+    static
+    void
+    pushRoot( valueType           a,
+              valueType           b,
+              valueType           tolerance,
+              vector<valueType> & s1,
+              vector<valueType> & s2 ) ;
+
+    //! segment or circle arc intersected in closed form (not an arc turning less than 1e-4 radians)
+    bool isLineOrArc() const ;
+
+    //! closed form intersection when both curves are segments or circle arcs, `sa` and `sb` are work vectors
+    void
+    intersect_analytic( valueType             offs,
+                        ClothoidCurve const & c,
+                        valueType             c_offs,
+                        vector<valueType>   & s1,
+                        vector<valueType>   & s2,
+                        vector<valueType>   & sa,
+                        vector<valueType>   & sb ) const ;
+
+    //! sorted abscissas of the end points and of the points where the heading is `phi+m*period` or the offset curve has a cusp
     void
-    bbSplit_internal( valueType               split_angle,
-                      valueType               split_size,
-                      valueType               split_offs,
-                      vector<ClothoidCurve> & c,
-                      vector<Triangle2D>    & t ) const ;
+    headingBreaks( valueType           offs,
+                   valueType           phi,
+                   valueType           period,
+                   vector<valueType> & s ) const ;
 
-    //! Use newton and bisection to intersect two small clothoid segment
+    //! split and refine the overlapping triangles, in parallel if they are at least `min_pairs`
+    void
+    intersect_split( valueType             offs,
+                     ClothoidCurve const & c,
+                     valueType             c_offs,
+                     vector<valueType>   & s1,
+                     vector<valueType>   & s2,
+                     indexType             max_iter,
+                     valueType             tolerance,
+                     bool                  parallel,
+                     indexType             min_pairs,
+                     SplitPolicy           split,
+                     IntersectRefine       refine,
+                     indexType           & n_eval,
+                     IntersectWorkspace  & ws ) const ;
+
+    //! lazy collision detection on the trees stored in `ws`
     bool
-    intersect_internal( ClothoidCurve & c1, valueType c1_offs, valueType & s1,
-                        ClothoidCurve & c2, valueType c2_offs, valueType & s2,
-                        indexType max_iter,
-                        valueType tolerance ) const ;
+    collision_internal( valueType             offs,
+                        ClothoidCurve const & c,
+                        valueType             c_offs,
+                        valueType             max_angle,
+                        valueType             max_size,
+                        indexType           & n_eval,
+                        IntersectWorkspace  & ws ) const ;
 
   public:
   
@@ -396,6 +640,12 @@ namespace Clothoid {
     valueType
     theta_DDD( valueType ) const { return 0 ; }
 
+    //! true if the curve is a straight segment (\f$ \kappa=\kappa'=0 \f$)
+    bool isLine() const { return k == 0 && dk == 0 ; }
+
+    //! true if the curve is a circle arc (\f$ \kappa\neq 0, \kappa'=0 \f$)
+    bool isCircle() const { return k != 0 && dk == 0 ; }
+
     void
     eval( valueType   s,
           valueType & theta,
@@ -414,6 +664,104 @@ namespace Clothoid {
     void eval_DD( valueType s, valueType offs, valueType & x_DD, valueType & y_DD ) const ;
     void eval_DDD( valueType s, valueType offs, valueType & x_DDD, valueType & y_DDD ) const ;
 
+    /*! \brief evaluate a family of offset curves at the same abscissa
+     *
+     * The reference point, angle and normal are computed once and
+     * reused for all the offsets.
+     * \param s      curvilinear abscissa
+     * \param n_offs number of offsets
+     * \param offs   offsets, `offs[j]` for `j=0..n_offs-1`
+     * \param x      `x[j]` x coordinate of the point on the `j`-th offset curve
+     * \param y      `y[j]` y coordinate of the point on the `j`-th offset curve
+     */
+    void
+    eval( valueType       s,
+          indexType       n_offs,
+          valueType const offs[],
+          valueType       x[],
+          valueType       y[] ) const ;
+
+    //! first derivative of a family of offset curves at the same abscissa
+    void
+    eval_D( valueType       s,
+            indexType       n_offs,
+            valueType const offs[],
+            valueType       x_D[],
+            valueType       y_D[] ) const ;
+
+    //! points and first derivatives of a family of offset curves at the same abscissa
+    void
+    eval( valueType       s,
+          indexType       n_offs,
+          valueType const offs[],
+          valueType       x[],
+          valueType       y[],
+          valueType       x_D[],
+          valueType       y_D[] ) const ;
+
+    /*! \brief evaluate a family of offset curves at `ns` abscissae
+     *
+     * Results are stored by abscissa, i.e. `x[i*n_offs+j]` is the
+     * x coordinate at `s[i]` of the offset curve `offs[j]`.
+     */
+    void
+    eval( indexType       ns,
+          valueType const s[],
+          indexType       n_offs,
+          valueType const offs[],
+          valueType       x[],
+          valueType       y[] ) const ;
+
+    //! as the previous one, also computes the first derivatives
+    void
+    eval( indexType       ns,
+          valueType const s[],
+          indexType       n_offs,
+          valueType const offs[],
+          valueType       x[],
+          valueType       y[],
+          valueType       x_D[],
+          valueType       y_D[] ) const ;
+
+    /*! \brief point of the curve and its gradient with respect to the parameters
+     *
+     * `x_grad` and `y_grad` are the derivatives of \f$ x(s) \f$ and
+     * \f$ y(s) \f$ with respect to
+     * \f$ (x_0, y_0, \theta_0, \kappa, \kappa', s) \f$, in this order.
+     * The last one is also the derivative with respect to the length
+     * \f$ L \f$ of the end point \f$ s=L \f$.
+     * A single call of GeneralizedFresnelCS with 3 momenta is used.
+     */
+    void
+    eval_grad( valueType   s,
+               valueType & x,
+               valueType & y,
+               valueType   x_grad[6],
+               valueType   y_grad[6] ) const ;
+
+    //! point of the offset curve and its gradient with respect to the parameters
+    void
+    eval_grad( valueType   s,
+               valueType   offs,
+               valueType & x,
+               valueType & y,
+               valueType   x_grad[6],
+               valueType   y_grad[6] ) const ;
+
+    /*! \brief points and gradients at `ns` abscissae
+     *
+     * The gradient at `s[i]` is stored in `x_grad[6*i..6*i+5]`
+     * and `y_grad[6*i..6*i+5]`.
+     */
+    void
+    eval_grad( indexType       ns,
+               valueType const s[],
+               valueType       offs,
+               valueType       x[],
+               valueType       y[],
+               valueType       x_grad[],
+               valueType       y_grad[] ) const ;
+
     void
     trim( valueType s_begin, valueType s_end ) {
       s_min = s_begin ;
@@ -434,6 +782,16 @@ namespace Clothoid {
     bbTriangle( valueType offs, Triangle2D & t ) const
     { return bbTriangle( offs, t.p1, t.p2, t.p3 ) ; }
 
+    /*! \brief bounding triangles for a family of offset curves
+     *
+     * The end points of the reference curve are evaluated once
+     * and `t[j]` is filled with the triangle of the offset `offs[j]`.
+     */
+    bool
+    bbTriangle( indexType       n_offs,
+                valueType const offs[],
+                Triangle2D      t[] ) const ;
+
     void
     bbSplit( valueType               split_angle, //!< maximum angle variation
              valueType               split_size,  //!< maximum height of the triangle
@@ -441,6 +799,50 @@ namespace Clothoid {
              vector<ClothoidCurve> & c,           //!< clothoid segments
              vector<Triangle2D>    & t ) const ;  //!< clothoid bounding box
 
+    /*! \brief split the curve once for a family of offsets
+     *
+     * The segments `c` are the same of the single offset version,
+     * the triangle of segment `i` for offset `offs[j]` is `t[i*n_offs+j]`.
+     */
+    void
+    bbSplit( valueType               split_angle, //!< maximum angle variation
+             valueType               split_size,  //!< maximum height of the triangle
+             indexType               n_offs,      //!< number of offsets
+             valueType const         split_offs[],//!< curve offsets
+             vector<ClothoidCurve> & c,           //!< clothoid segments
+             vector<Triangle2D>    & t ) const ;  //!< clothoid bounding boxes
+
+    /*! \brief split the curve without heap allocation
+     *
+     * Same segments and triangles of `bbSplit`, stored in the caller
+     * owned arrays `c` and `t` of size `capacity`.
+     * The bisection uses a fixed size stack and each end point
+     * is evaluated once.
+     * Return the number of segments of the splitting: if it is greater
+     * than `capacity` only the first `capacity` segments are stored and
+     * the call must be repeated with larger arrays
+     * (`capacity` can be 0 to query the size).
+     */
+    indexType
+    bbSplit( valueType     split_angle, //!< maximum angle variation
+             valueType     split_size,  //!< maximum height of the triangle
+             valueType     split_offs,  //!< curve offset
+             ClothoidCurve c[],         //!< clothoid segments
+             Triangle2D    t[],         //!< clothoid bounding boxes
+             indexType     capacity ) const ;
+
+    /*! \brief split the curve in the buffers of `ws`
+     *
+     * Same segments and triangles of `bbSplit`, available with
+     * `ws.getSegment(i)` and `ws.getTriangle(i)` until the next call using
+     * `ws`. Return the number of segments.
+     */
+    indexType
+    bbSplit( valueType            split_angle, //!< maximum angle variation
+             valueType            split_size,  //!< maximum height of the triangle
+             valueType            split_offs,  //!< curve offset
+             IntersectWorkspace & ws ) const ;
+
     // intersect computation
     void
     intersect( ClothoidCurve const & c,
@@ -460,6 +862,94 @@ namespace Clothoid {
                indexType             max_iter,
                valueType             tolerance ) const ;
 
+    /*! \brief intersection with the choice of the splitting
+     *
+     * The default of `intersect` is `SPLIT_ADAPTIVE`, `SPLIT_FIXED`
+     * gives the intersections of `ClothoidBVH` and `ClothoidSetIntersect`.
+     */
+    void
+    intersect( valueType             offs,
+               ClothoidCurve const & c,
+               valueType             c_offs,
+               vector<valueType>   & s1,
+               vector<valueType>   & s2,
+               indexType             max_iter,
+               valueType             tolerance,
+               SplitPolicy           split ) const ;
+
+    /*! \brief intersection using the buffers of `ws`
+     *
+     * Same result of `intersect`, without memory allocation once the
+     * buffers of `ws` and the vectors `s1`, `s2` are large enough.
+     */
+    void
+    intersect( valueType             offs,
+               ClothoidCurve const & c,
+               valueType             c_offs,
+               vector<valueType>   & s1,
+               vector<valueType>   & s2,
+               indexType             max_iter,
+               valueType             tolerance,
+               IntersectWorkspace  & ws ) const ;
+
+    //! intersection with the choice of the splitting, using the buffers of `ws`
+    void
+    intersect( valueType             offs,
+               ClothoidCurve const & c,
+               valueType             c_offs,
+               vector<valueType>   & s1,
+               vector<valueType>   & s2,
+               indexType             max_iter,
+               valueType             tolerance,
+               SplitPolicy           split,
+               IntersectWorkspace  & ws ) const ;
+
+    /*! \brief intersection with the choice of the refinement of the segments
+     *
+     * `n_eval` is the number of evaluations of the curves (Fresnel
+     * integrals) spent in the refinement, the splitting is not counted.
+     * The default of `intersect` is `REFINE_NEWTON`.
+     */
+    void
+    intersect( valueType             offs,
+               ClothoidCurve const & c,
+               valueType             c_offs,
+               vector<valueType>   & s1,
+               vector<valueType>   & s2,
+               indexType             max_iter,
+               valueType             tolerance,
+               IntersectRefine       refine,
+               indexType           & n_eval ) const ;
+
+    /*! \brief intersection with parallel refinement
+     *
+     * Same result of `intersect` (bitwise): the pairs of overlapping
+     * triangles are collected first and, if they are at least `min_pairs`,
+     * refined with Newton in parallel (when compiled with OpenMP);
+     * the results are merged in the order of the serial loop.
+     */
+    void
+    intersect_parallel( valueType             offs,
+                        ClothoidCurve const & c,
+                        valueType             c_offs,
+                        vector<valueType>   & s1,
+                        vector<valueType>   & s2,
+                        indexType             max_iter,
+                        valueType             tolerance,
+                        indexType             min_pairs = 64 ) const ;
+
+    //! intersection with parallel refinement, using the buffers of `ws`
+    void
+    intersect_parallel( valueType             offs,
+                        ClothoidCurve const & c,
+                        valueType             c_offs,
+                        vector<valueType>   & s1,
+                        vector<valueType>   & s2,
+                        indexType             max_iter,
+                        valueType             tolerance,
+                        indexType             min_pairs,
+                        IntersectWorkspace  & ws ) const ;
+
     // collision detection
     bool
     approsimate_collision( valueType             offs,
@@ -468,6 +958,121 @@ namespace Clothoid {
                            valueType             max_angle,         //!< maximum angle variation
                            valueType             max_size ) const ; //!< curve offset
 
+    /*! \brief split the offset curve in x and y monotone pieces
+     *
+     * The curve is split where the heading crosses a multiple of
+     * \f$ \pi/2 \f$ (the roots of the quadratic \f$ \theta(s) \f$) and,
+     * for the offset curve, at the cusp where \f$ 1-\textrm{offs}\,\kappa(s) \f$
+     * vanishes. The box `box[i]` of the piece `c[i]` is the box of its end
+     * points, exact up to the rounding of the evaluation.
+     */
+    void
+    monotoneSplit( valueType               offs,
+                   vector<ClothoidCurve> & c,
+                   vector<BBox2D>        & box ) const ;
+
+    /*! \brief closest point of the offset curve to `(x,y)`
+     *
+     * Return the distance, `s` is the curvilinear abscissa of the closest
+     * point, see `ClothoidBVH::project` for the guarantees.
+     * The curve is split in a coarse tree for each call, to project many
+     * points use the batch version or keep a `ClothoidBVH`.
+     */
+    valueType
+    project( valueType   x,
+             valueType   y,
+             valueType   offs,
+             valueType & s,
+             valueType   tolerance = 1e-10 ) const ;
+
+    //! closest points of the offset curve to `(x[i],y[i])`, the tree is built once
+    void
+    project( indexType       n,
+             valueType const x[],
+             valueType const y[],
+             valueType       offs,
+             valueType       s[],
+             valueType       dist[],
+             valueType       tolerance = 1e-10 ) const ;
+
+    /*! \brief intersections of the offset curve with the segment from `(x0,y0)` to `(x1,y1)`
+     *
+     * The curve is split where the heading is parallel to the segment,
+     * on each piece the signed distance from the line of the segment is
+     * monotone and its root is found with safeguarded Newton.
+     * `s[i]` is the curvilinear abscissa of the intersection, `t[i]` in
+     * `[0,1]` its position along the segment, tangent contacts are
+     * reported when the distance is below `tolerance`.
+     */
+    void
+    intersect_segment( valueType           offs,
+                       valueType           x0,
+                       valueType           y0,
+                       valueType           x1,
+                       valueType           y1,
+                       vector<valueType> & s,
+                       vector<valueType> & t,
+                       valueType           tolerance ) const ;
+
+    /*! \brief intersections of the offset curve with the circle of center `(cx,cy)` and radius `r`
+     *
+     * The monotone pieces of `monotoneSplit` are bisected, a piece is
+     * discarded when its box does not reach the circle and refined with
+     * safeguarded Newton when the distance from the center is monotone on it.
+     * `s[i]` is the curvilinear abscissa of the intersection, `a[i]`
+     * the angle of the point on the circle, tangent contacts are reported
+     * when the distance is below `tolerance`.
+     */
+    void
+    intersect_circle( valueType           offs,
+                      valueType           cx,
+                      valueType           cy,
+                      valueType           r,
+                      vector<valueType> & s,
+                      vector<valueType> & a,
+                      valueType           tolerance ) const ;
+
+    /*! \brief collision detection with lazy splitting
+     *
+     * Same result of `approsimate_collision`, `n_eval` is the number of
+     * evaluations of the curves, the full splitting of the two curves
+     * needs `c0.size()+c1.size()+2` evaluations
+     * (`c0` and `c1` the segments of `bbSplit`).
+     */
+    bool
+    approsimate_collision( valueType             offs,
+                           ClothoidCurve const & c,
+                           valueType             c_offs,
+                           valueType             max_angle,
+                           valueType             max_size,
+                           indexType           & n_eval ) const ;
+
+    //! same result of `approsimate_collision`, the trees are stored in the buffers of `ws`
+    bool
+    approsimate_collision( valueType             offs,
+                           ClothoidCurve const & c,
+                           valueType             c_offs,
+                           valueType             max_angle,
+                           valueType             max_size,
+                           IntersectWorkspace  & ws ) const ;
+
+    /*! \brief minimum distance of the two offset curves
+     *
+     * Branch and bound on the bisection trees of the curves with
+     * Newton refinement, the result is within `tolerance` of the minimum.
+     * `s1` and `s2` are the curvilinear abscissas of the closest points.
+     * The search stops as soon as a distance below `threshold` is found,
+     * the returned value is then an upper bound (below `threshold`).
+     */
+    valueType
+    distance( valueType             offs,
+              ClothoidCurve const & c,
+              valueType             c_offs,
+              valueType           & s1,
+              valueType           & s2,
+              valueType             tolerance = 1e-8,
+              valueType             threshold = 0 ) const ;
+
     friend
     std::ostream &
     operator << ( std::ostream & stream, ClothoidCurve const & c ) ;
@@ -489,8 +1094,1072 @@ namespace Clothoid {
     void
     reverse() ;
 
+    friend class ClothoidBatch ;
+    friend class ClothoidEvaluator ;
+    friend class ClothoidBVH ;
+    friend class ClothoidSetIntersect ;
+
+  } ;
+
+  /*\
+   |    ____ _       _   _           _     _ _____            _             _
+   |   / ___| | ___ | |_| |__   ___ (_) __| | ____|_   ____ _| |_   _  __ _| |_ ___  _ __
+   |  | |   | |/ _ \| __| '_ \ / _ \| |/ _` |  _| \ \ / / _` | | | | |/ _` | __/ _ \| '__|
+   |  | |___| | (_) | |_| | | | (_) | | (_| | |___ \ V / (_| | | |_| | (_| | || (_) | |
+   |   \____|_|\___/ \__|_| |_|\___/|_|\__,_|_____| \_/ \__,_|_|\__,_|\__,_|\__\___/|_|
+  \*/
+  //! \brief Evaluation of a clothoid curve with precomputed constants
+  /*!
+   * The object is a snapshot of a `ClothoidCurve` which stores
+   * \f$ \cos\theta_0 \f$ and \f$ \sin\theta_0 \f$, so that the evaluation
+   * of the points do not recompute them (the curve itself is not
+   * changed, call `setup` again after `rotate`, `reverse`,
+   * `change_origin`, ...).
+   * The results are the same of the `ClothoidCurve` methods.
+   */
+  class ClothoidEvaluator {
+
+    valueType x0, y0, theta0, k, dk, s_min, s_max ;
+    valueType cos_theta0, //!< \f$ \cos\theta_0 \f$
+              sin_theta0 ; //!< \f$ \sin\theta_0 \f$
+
+    //! point of the offset curve and unit tangent, a single `cos`/`sin` pair
+    void
+    evalTangent( valueType   s,
+                 valueType   offs,
+                 valueType & x,
+                 valueType & y,
+                 valueType & tx,
+                 valueType & ty ) const ;
+
+  public:
+
+    ClothoidEvaluator()
+    : x0(0), y0(0), theta0(0), k(0), dk(0), s_min(0), s_max(0)
+    , cos_theta0(1), sin_theta0(0)
+    {}
+
+    explicit
+    ClothoidEvaluator( ClothoidCurve const & c )
+    { setup( c ) ; }
+
+    //! precompute the constants of the curve `c`
+    void setup( ClothoidCurve const & c ) ;
+
+    valueType getSmin() const { return s_min ; }
+    valueType getSmax() const { return s_max ; }
+
+    valueType
+    theta( valueType s ) const { return theta0 + s*(k + 0.5*s*dk) ; }
+
+    valueType
+    theta_D( valueType s ) const { return k + s*dk ; }
+
+    void
+    eval( valueType   s,
+          valueType & theta,
+          valueType & kappa,
+          valueType & x,
+          valueType & y ) const ;
+
+    void eval( valueType s, valueType & x, valueType & y ) const ;
+    void eval_D( valueType s, valueType & x_D, valueType & y_D ) const ;
+    void eval_DD( valueType s, valueType & x_DD, valueType & y_DD ) const ;
+    void eval_DDD( valueType s, valueType & x_DDD, valueType & y_DDD ) const ;
+
+    // offset curve
+    void eval( valueType s, valueType offs, valueType & x, valueType & y ) const ;
+    void eval_D( valueType s, valueType offs, valueType & x_D, valueType & y_D ) const ;
+    void eval_DD( valueType s, valueType offs, valueType & x_DD, valueType & y_DD ) const ;
+    void eval_DDD( valueType s, valueType offs, valueType & x_DDD, valueType & y_DDD ) const ;
+
+    //! point and first derivative of the offset curve sharing \f$ \theta(s) \f$
+    void
+    eval( valueType   s,
+          valueType   offs,
+          valueType & x,
+          valueType & y,
+          valueType & x_D,
+          valueType & y_D ) const ;
+
+    //! same as `ClothoidCurve::bbTriangle` on the range `[s_begin,s_end]`
+    bool
+    bbTriangle( valueType    s_begin,
+                valueType    s_end,
+                valueType    offs,
+                Triangle2D & t ) const ;
+
+  } ;
+
+  //! \brief Cubic Taylor expansion of an offset clothoid segment at its middle point
+  /*!
+   * Built once for each leaf of the splitting in `ClothoidCurve::intersect`
+   * with `REFINE_TAYLOR`, the Newton iteration on the models of two leaves
+   * gives the start point of the exact Newton steps.
+   */
+  class TaylorModel {
+  public:
+    valueType sm ;  //!< middle of the segment
+    valueType h ;   //!< half length, negative until `setup`
+    valueType p[2], d1[2], d2[2], d3[2] ; //!< point and derivatives at `sm`
+    bool      use ; //!< the segment turns little enough for the model
+
+    TaylorModel() : h(-1), use(false) {}
+
+    //! expansion of `c` with offset `offs`, evaluated only if it is used
+    void setup( ClothoidCurve const & c, valueType offs ) ;
+
+    //! point and derivative at `sm+u`
+    void
+    eval( valueType u, valueType q[2], valueType t[2] ) const {
+      for ( indexType i = 0 ; i < 2 ; ++i ) {
+        q[i] = p[i] + u*(d1[i] + (u/2)*(d2[i] + (u/3)*d3[i])) ;
+        t[i] = d1[i] + u*(d2[i] + (u/2)*d3[i]) ;
+      }
+    }
+  } ;
+
+  /*\
+   |   ___       _                          _ __        __         _
+   |  |_ _|_ __ | |_ ___ _ __ ___  ___  ___| |\ \      / /__  _ __| | _____ _ __   __ _  ___ ___
+   |   | || '_ \| __/ _ \ '__/ __|/ _ \/ __| __\ \ /\ / / _ \| '__| |/ / __| '_ \ / _` |/ __/ _ \
+   |   | || | | | ||  __/ |  \__ \  __/ (__| |_ \ V  V / (_) | |  |   <\__ \ |_) | (_| | (_|  __/
+   |  |___|_| |_|\__\___|_|  |___/\___|\___|\__| \_/\_/ \___/|_|  |_|\_\___/ .__/ \__,_|\___\___|
+   |                                                                       |_|
+  \*/
+  //! \brief Buffers of the intersection of two curves, reused across calls
+  /*!
+   * The overloads of `ClothoidCurve::intersect`, `bbSplit` and
+   * `approsimate_collision` (and the queries of `ClothoidBVH`) taking a
+   * workspace keep the segments, the bisection trees, the pairs of leaves
+   * and the stacks of the descents in its vectors, which retain
+   * their capacity between the calls: once they are large enough for the
+   * queries no memory is allocated.
+   * The overloads without a workspace build a temporary one at each call
+   * and allocate its buffers every time: repeated queries should pass a
+   * workspace.
+   * `numGrowths` counts the calls that enlarged the capacity of a buffer
+   * (or of the output vectors of `intersect`).
+   * A workspace must not be shared among threads.
+   */
+  class IntersectWorkspace {
+  public:
+
+    //! end point of a segment of the bisection, evaluated once
+    class Point {
+    public:
+      valueType s, theta, x, y, tx, ty ;
+      indexType depth ;
+
+      void setup( ClothoidEvaluator const & e, valueType _s, indexType _depth ) ;
+    } ;
+
+    //! node of the bisection tree of `bbSplit` built on demand
+    class Node {
+    public:
+      Point      a, b ;
+      valueType  s_mid ;
+      indexType  depth ;
+      indexType  child ;      //!< first child (second is `child+1`), -1 if not open
+      bool       leaf ;
+      bool       zero_split ; //!< split at zero curvature
+      valueType  xmin, ymin, xmax, ymax ;
+      Triangle2D t ;          //!< leaf only
+
+      valueType size() const { return (xmax-xmin) + (ymax-ymin) ; }
+
+      bool
+      overlap( Node const & n ) const {
+        return xmin <= n.xmax && n.xmin <= xmax &&
+               ymin <= n.ymax && n.ymin <= ymax ;
+      }
+
+      void
+      setup( ClothoidCurve     const & curve,
+             ClothoidEvaluator const & e,
+             valueType                 offs,
+             valueType                 split_angle,
+             valueType                 split_size,
+             bool                      convex ) ;
+    } ;
+
+    //! box of a triangle in the sweep of `SPLIT_FIXED`, `id` is the index in its set
+    class Box {
+    public:
+      valueType xmin, ymin, xmax, ymax ;
+      indexType id, set ;
+
+      void setup( Triangle2D const & t, indexType _id, indexType _set ) ;
+
+      bool operator < ( Box const & b ) const { return xmin < b.xmin ; }
+    } ;
+
+  private:
+
+    vector<ClothoidCurve>              c0, c1 ; //!< segments of the two curves
+    vector<Triangle2D>                 t0, t1 ; //!< triangles of the segments
+    vector<Node>                       n0, n1 ; //!< bisection trees
+    vector<pair<indexType,indexType> > pairs ;  //!< pairs of overlapping leaves
+    vector<pair<indexType,indexType> > stack ;  //!< pairs of nodes to visit
+    vector<indexType>                  id ;     //!< segments of the leaves, triangles of `tb` overlapping a triangle or nodes of a `ClothoidBVH` to visit
+    vector<valueType>                  sa, sb ; //!< work vectors of the closed form intersection
+    Triangle2DBatch                    tb ;     //!< triangles of the second curve (`SPLIT_FIXED`)
+    vector<TaylorModel>                m0, m1 ; //!< models of the leaves (`REFINE_TAYLOR`)
+    vector<Box>                        boxes ;  //!< boxes of the triangles sorted by `xmin` (`SPLIT_FIXED`)
+    vector<Box>                        active[2] ; //!< boxes of the two curves crossing the sweep line
+    vector<valueType>                  r1, r2 ; //!< roots of the pairs refined in parallel
+    vector<char>                       found ;  //!< pairs refined in parallel with a root
+    unsigned long                      n_calls, n_grow ;
+
+    //! total capacity of the buffers
+    size_t capacity() const ;
+
+    void
+    count( size_t cap_before, size_t cap_after ) {
+      ++n_calls ;
+      if ( cap_after != cap_before ) ++n_grow ;
+    }
+
+    friend class ClothoidCurve ;
+    friend class ClothoidBVH ;
+
+  public:
+
+    IntersectWorkspace() : n_calls(0), n_grow(0) {}
+
+    ~IntersectWorkspace() {}
+
+    //! segments of the last `ClothoidCurve::bbSplit` using the workspace
+    indexType numSegments() const { return indexType(c0.size()) ; }
+
+    ClothoidCurve const & getSegment( indexType i )  const { return c0[i] ; }
+    Triangle2D    const & getTriangle( indexType i ) const { return t0[i] ; }
+
+    //! number of calls using the workspace
+    unsigned long numCalls() const { return n_calls ; }
+
+    //! number of calls which enlarged the capacity of a buffer
+    unsigned long numGrowths() const { return n_grow ; }
+
+    void resetCounters() { n_calls = n_grow = 0 ; }
+
+    //! release the memory of the buffers
+    void clear() ;
+
+  } ;
+
+  /*\
+   |    ____ _       _   _           _     _ ____        _       _
+   |   / ___| | ___ | |_| |__   ___ (_) __| | __ )  __ _| |_ ___| |__
+   |  | |   | |/ _ \| __| '_ \ / _ \| |/ _` |  _ \ / _` | __/ __| '_ \
+   |  | |___| | (_) | |_| | | | (_) | | (_| | |_) | (_| | || (__| | | |
+   |   \____|_|\___/ \__|_| |_|\___/|_|\__,_|____/ \__,_|\__\___|_| |_|
+  \*/
+  //! \brief Set of clothoid curves stored as structure of arrays
+  /*!
+   * The parameters of the curves are stored in separate arrays
+   * `x0`, `y0`, `theta0`, `k`, `dk`, `s_min` and `s_max`, so that bulk
+   * transformations run as vectorizable loops.
+   * The batch can own its storage or be a view (no copy) of an array
+   * of `ClothoidCurve`, in this case the arrays are accessed with
+   * stride `sizeof(ClothoidCurve)/sizeof(valueType)` and any
+   * transformation is applied directly to the viewed curves
+   * (the layout of `ClothoidCurve` is checked at compile time).
+   *
+   * The evaluation is not vectorized: the Fresnel integrals of each curve
+   * are computed by the scalar code of `ClothoidCurve::eval`, with the
+   * same results.  The batch saves only the \f$ \cos\theta_0 \f$ and
+   * \f$ \sin\theta_0 \f$ of the curves, computed by the first evaluation
+   * after a change and reused by the next ones, and the offset evaluation
+   * uses a single `cos`/`sin` pair per curve.  The Fresnel integrals
+   * dominate the cost, so the evaluation is only a few percent faster
+   * than a loop on `ClothoidCurve`.  The first evaluation after a change updates the
+   * saved values, so it must not run concurrently with other evaluations
+   * of the same batch; call `view` again after changing the viewed curves
+   * directly.
+   */
+  class ClothoidBatch {
+
+    vector<valueType> data ; //!< owned storage (empty for a view)
+
+    mutable vector<valueType> trig ; //!< \f$ \cos\theta_0 \f$, \f$ \sin\theta_0 \f$ of each curve
+    mutable bool              trig_ok ; //!< true if `trig` matches `theta0`
+
+    void updateTrig() const ;
+
+    valueType * x0,     //!< initial x coordinates
+              * y0,     //!< initial y coordinates
+              * theta0, //!< initial angles
+              * k,      //!< initial curvatures
+              * dk,     //!< curvature derivatives
+              * s_min,  //!< initial curvilinear coordinates
+              * s_max ; //!< final curvilinear coordinates
+
+    indexType n ;      //!< number of curves
+    indexType stride ; //!< distance between two consecutive values
+
+    // no copy
+    ClothoidBatch( ClothoidBatch const & ) ;
+    ClothoidBatch const & operator = ( ClothoidBatch const & ) ;
+
+  public:
+
+    ClothoidBatch()
+    : trig_ok(false)
+    , x0(0), y0(0), theta0(0), k(0), dk(0), s_min(0), s_max(0)
+    , n(0), stride(1)
+    {}
+
+    //! copy the curves `c` in the owned storage
+    explicit
+    ClothoidBatch( vector<ClothoidCurve> const & c )
+    : trig_ok(false)
+    , x0(0), y0(0), theta0(0), k(0), dk(0), s_min(0), s_max(0)
+    , n(0), stride(1)
+    { load( c ) ; }
+
+    ~ClothoidBatch() {}
+
+    //! allocate owned storage for `nc` curves (previous content is lost)
+    void resize( indexType nc ) ;
+
+    //! copy `nc` curves in the owned storage
+    void load( ClothoidCurve const c[], indexType nc ) ;
+
+    void
+    load( vector<ClothoidCurve> const & c )
+    { load( c.empty() ? 0 : &c.front(), indexType(c.size()) ) ; }
+
+    //! make the batch a view of the array `c`, no data is copied
+    void view( ClothoidCurve c[], indexType nc ) ;
+
+    void
+    view( vector<ClothoidCurve> & c )
+    { view( c.empty() ? 0 : &c.front(), indexType(c.size()) ) ; }
+
+    //! copy the curves of the batch in `c[0..size()-1]`
+    void store( ClothoidCurve c[] ) const ;
+
+    void
+    store( vector<ClothoidCurve> & c ) const
+    { c.resize(size_t(n)) ; if ( n > 0 ) store( &c.front() ) ; }
+
+    //! true if the batch is a view of an array of `ClothoidCurve`
+    bool isView() const { return stride != 1 ; }
+
+    indexType size() const { return n ; }
+
+    void get( indexType i, ClothoidCurve & c ) const ;
+    void set( indexType i, ClothoidCurve const & c ) ;
+
+    valueType getX0( indexType i )      const { return x0[i*stride] ; }
+    valueType getY0( indexType i )      const { return y0[i*stride] ; }
+    valueType getTheta0( indexType i )  const { return theta0[i*stride] ; }
+    valueType getKappa( indexType i )   const { return k[i*stride] ; }
+    valueType getKappa_D( indexType i ) const { return dk[i*stride] ; }
+    valueType getSmin( indexType i )    const { return s_min[i*stride] ; }
+    valueType getSmax( indexType i )    const { return s_max[i*stride] ; }
+
+    //! same as `ClothoidCurve::rotate` applied to all the curves
+    void rotate( valueType angle, valueType cx, valueType cy ) ;
+
+    //! same as `ClothoidCurve::translate` applied to all the curves
+    void translate( valueType tx, valueType ty ) ;
+
+    //! same as `ClothoidCurve::scale` applied to all the curves
+    void scale( valueType s ) ;
+
+    //! same as `ClothoidCurve::reverse` applied to all the curves
+    void reverse() ;
+
+    //! evaluate curve `i` at `s[i]`, for all the curves
+    void
+    eval( valueType const s[],
+          valueType       x[],
+          valueType       y[] ) const ;
+
+    //! evaluate offset curve `i` at `s[i]`, for all the curves
+    void
+    eval( valueType const s[],
+          valueType       offs,
+          valueType       x[],
+          valueType       y[] ) const ;
+
+    //! angle, curvature and position of curve `i` at `s[i]`, for all the curves
+    void
+    eval( valueType const s[],
+          valueType       theta[],
+          valueType       kappa[],
+          valueType       x[],
+          valueType       y[] ) const ;
+
+  } ;
+
+  /*\
+   |    ____ _       _   _           _     _ ______     ___   _
+   |   / ___| | ___ | |_| |__   ___ (_) __| | __ ) \   / / | | |
+   |  | |   | |/ _ \| __| '_ \ / _ \| |/ _` |  _ \\ \ / /| |_| |
+   |  | |___| | (_) | |_| | | | (_) | | (_| | |_) |\ V / |  _  |
+   |   \____|_|\___/ \__|_| |_|\___/|_|\__,_|____/  \_/  |_| |_|
+  \*/
+  //! \brief Bounding volume hierarchy of a clothoid curve
+  /*!
+   * The curve is split once with `bbSplit` and the bounding triangles of
+   * the segments are the leaves of a binary tree of axis aligned boxes.
+   * The tree is built once (e.g. for a static element of a map) and
+   * reused for any number of queries: intersection and collision descend
+   * the two trees at the same time and test only the triangles whose
+   * boxes overlap.
+   * The curve is copied, build again the tree if the curve is changed.
+   */
+  class ClothoidBVH {
+
+  public:
+
+    //! node of the tree, the box of the triangles `i_begin..i_end-1`
+    class Node {
+    public:
+      valueType xmin, ymin, xmax, ymax ;
+      indexType i_begin, i_end ;
+      indexType child ; //!< first child (the second is `child+1`), -1 for a leaf
+    } ;
+
+  private:
+
+    ClothoidCurve         curve ;
+    valueType             offs ;
+    vector<ClothoidCurve> segments ;
+    vector<Triangle2D>    triangles ;
+    vector<Node>          nodes ;      //!< the root is `nodes[0]`
+    valueType             build_time ; //!< seconds
+
+    void buildTree( indexType inode, indexType i_begin, indexType i_end ) ;
+
+    // true if the box `b` overlaps the box of a leaf, `stack` is a work vector
+    bool boxHit( Node const & b, vector<indexType> & stack ) const ;
+
+    // dual tree descent, if `pairs` is NULL stop at the first overlap
+    bool
+    descend( ClothoidBVH const & B,
+             vector<pair<indexType,indexType> > * pairs,
+             vector<pair<indexType,indexType> > & stack ) const ;
+
+  public:
+
+    ClothoidBVH() : offs(0), build_time(0) {}
+
+    //! tree with the fixed splitting of `ClothoidCurve::intersect` (`SPLIT_FIXED`)
+    ClothoidBVH( ClothoidCurve const & c, valueType _offs )
+    : offs(0), build_time(0)
+    { build( c, _offs ) ; }
+
+    ClothoidBVH( ClothoidCurve const & c,
+                 valueType             _offs,
+                 valueType             split_angle,
+                 valueType             split_size )
+    : offs(0), build_time(0)
+    { build( c, _offs, split_angle, split_size ) ; }
+
+    ~ClothoidBVH() {}
+
+    //! build the tree with the fixed splitting of `ClothoidCurve::intersect` (`SPLIT_FIXED`)
+    void build( ClothoidCurve const & c, valueType _offs ) ;
+
+    //! build the tree of `c.bbSplit( split_angle, split_size, _offs, ... )`
+    void
+    build( ClothoidCurve const & c,
+           valueType             _offs,
+           valueType             split_angle,
+           valueType             split_size ) ;
+
+    ClothoidCurve const & getCurve()  const { return curve ; }
+    valueType             getOffset() const { return offs ; }
+
+    indexType numSegments() const { return indexType(segments.size()) ; }
+    indexType numNodes()    const { return indexType(nodes.size()) ; }
+
+    ClothoidCurve const & getSegment( indexType i )  const { return segments[i] ; }
+    Triangle2D    const & getTriangle( indexType i ) const { return triangles[i] ; }
+    Node          const & getNode( indexType i )     const { return nodes[i] ; }
+
+    //! time spent in the last `build` in seconds
+    valueType buildTime() const { return build_time ; }
+
+    //! memory used by the tree in bytes
+    size_t memoryFootprint() const ;
+
+    /*! \brief pairs of segments with overlapping triangles
+     *
+     * The pairs `(i[k],j[k])` of segment of this tree and of `B`
+     * are sorted lexicographically.
+     */
+    void
+    overlap( ClothoidBVH const & B,
+             vector<indexType> & i,
+             vector<indexType> & j ) const ;
+
+    //! as `overlap` with the buffers of the descent in `ws`
+    void
+    overlap( ClothoidBVH const  & B,
+             vector<indexType>  & i,
+             vector<indexType>  & j,
+             IntersectWorkspace & ws ) const ;
+
+    /*! \brief intersection of the two offset curves
+     *
+     * Same result of `ClothoidCurve::intersect` with `SPLIT_FIXED` when
+     * both trees are built with that splitting.
+     * When both curves are segments or circle arcs the intersections
+     * are computed in closed form, as `ClothoidCurve::intersect` does,
+     * and the trees are not visited.
+     */
+    void
+    intersect( ClothoidBVH const & B,
+               vector<valueType> & s1,
+               vector<valueType> & s2,
+               indexType           max_iter,
+               valueType           tolerance ) const ;
+
+    //! as `intersect` with the buffers of the descent in `ws`, no allocation once they are large enough
+    void
+    intersect( ClothoidBVH const  & B,
+               vector<valueType>  & s1,
+               vector<valueType>  & s2,
+               indexType            max_iter,
+               valueType            tolerance,
+               IntersectWorkspace & ws ) const ;
+
+    /*! \brief intersections of the curve of the tree with many curves
+     *
+     * The curve of the tree is split once, a curve `c[k]` (with offset
+     * `c_offs`) whose bounding box does not overlap the leaves of the tree
+     * is discarded without splitting it.
+     * The intersections with `c[k]` are `(s1[i],s2[i])` for
+     * `begin[k] <= i < begin[k+1]`, the same of
+     * `getCurve().intersect( getOffset(), c[k], c_offs, ..., SPLIT_FIXED )`
+     * when the tree is built with that splitting.
+     * The buffers of the descents are allocated once for all the curves.
+     * Return the number of curves not discarded.
+     */
+    indexType
+    intersect( vector<ClothoidCurve> const & c,
+               valueType                     c_offs,
+               vector<indexType>           & begin,
+               vector<valueType>           & s1,
+               vector<valueType>           & s2,
+               indexType                     max_iter,
+               valueType                     tolerance ) const ;
+
+    //! same result of `ClothoidCurve::approsimate_collision` with the splitting of the trees
+    bool collision( ClothoidBVH const & B ) const ;
+
+    //! as `collision` with the stack of the descent in `ws`
+    bool collision( ClothoidBVH const & B, IntersectWorkspace & ws ) const ;
+
+    /*! \brief closest point of the offset curve of the tree to `(x,y)`
+     *
+     * Return the distance, `s` is the curvilinear abscissa of the
+     * closest point. The leaves are visited in order of distance of
+     * their box and are bisected until interval bounds on the piece
+     * show that the orthogonality condition
+     * \f$ g(s) = (P(s)-Q)\cdot P'(s) = 0 \f$ has no root
+     * (constant sign of \f$ g \f$ or \f$ g' < 0 \f$) or exactly one
+     * (\f$ g' > 0 \f$, a local minimum); pieces farther than the best
+     * distance found are pruned.
+     * The root is refined with safeguarded Newton to `tolerance` in `s`.
+     * The distance is the global minimum up to the rounding of the
+     * evaluations; when the minimum is attained at more than one point
+     * (e.g. the center of a circle arc) one of them is returned.
+     * Only the points closer than `max_dist` are searched (the leaves
+     * farther are pruned at once), `HUGE_VAL` is returned if there are none.
+     */
+    valueType
+    project( valueType   x,
+             valueType   y,
+             valueType & s,
+             valueType   tolerance = 1e-10,
+             valueType   max_dist  = HUGE_VAL ) const ;
+
+    //! `project` of `n` points, `s[i]` and `dist[i]` for the point `(x[i],y[i])`
+    void
+    project( indexType       n,
+             valueType const x[],
+             valueType const y[],
+             valueType       s[],
+             valueType       dist[],
+             valueType       tolerance = 1e-10 ) const ;
+
+  } ;
+
+  /*\
+   |    ____ _       _   _           _     _ ____       _   ___       _                          _
+   |   / ___| | ___ | |_| |__   ___ (_) __| / ___|  ___| |_|_ _|_ __ | |_ ___ _ __ ___  ___  ___| |_
+   |  | |   | |/ _ \| __| '_ \ / _ \| |/ _` \___ \ / _ \ __|| || '_ \| __/ _ \ '__/ __|/ _ \/ __| __|
+   |  | |___| | (_) | |_| | | | (_) | | (_| |___) |  __/ |_ | || | | | ||  __/ |  \__ \  __/ (__| |_
+   |   \____|_|\___/ \__|_| |_|\___/|_|\__,_|____/ \___|\__|___|_| |_|\__\___|_|  |___/\___|\___|\__|
+  \*/
+  //! \brief Intersections among all the curves of a set
+  /*!
+   * The curves are split as in `ClothoidCurve::intersect` with
+   * `SPLIT_FIXED` and the triangles of all the curves are stored in a
+   * single spatial index (a uniform grid when the triangles have similar
+   * size, a bounding volume hierarchy otherwise).
+   * The candidate pairs of triangles of different curves are refined
+   * with Newton, in parallel when compiled with OpenMP.
+   * The intersections of curves `i` and `j` (`i < j`) are the ones
+   * computed by `c[i].intersect( offs[i], c[j], offs[j], ..., SPLIT_FIXED )`,
+   * the result is sorted by `(i,j)` and does not depend on the number
+   * of threads.
+   */
+  class ClothoidSetIntersect {
+
+  public:
+
+    //! curve `i` at `s_i` intersects curve `j` at `s_j`
+    class Point {
+    public:
+      indexType i, j ;
+      valueType s_i, s_j ;
+    } ;
+
+    enum SpatialIndex { INDEX_AUTO, INDEX_GRID, INDEX_BVH } ;
+
+  private:
+
+    SpatialIndex index ;
+    bool         grid_used ;
+    indexType    n_leaves ;
+    indexType    n_candidates ;
+
+  public:
+
+    ClothoidSetIntersect()
+    : index(INDEX_AUTO), grid_used(false), n_leaves(0), n_candidates(0)
+    {}
+
+    ~ClothoidSetIntersect() {}
+
+    //! choose the spatial index, by default depending on the triangles
+    void setSpatialIndex( SpatialIndex idx ) { index = idx ; }
+
+    /*! \brief all the intersections of the curves `c`
+     *
+     * `offs[i]` is the offset of curve `i`, `offs` may be empty
+     * (no offset).
+     */
+    void
+    intersect( vector<ClothoidCurve> const & c,
+               vector<valueType>     const & offs,
+               vector<Point>               & res,
+               indexType                     max_iter,
+               valueType                     tolerance ) ;
+
+    //! true if the last `intersect` used the uniform grid
+    bool usedGrid() const { return grid_used ; }
+
+    //! number of triangles of the last `intersect`
+    indexType numLeaves() const { return n_leaves ; }
+
+    //! number of pairs of overlapping triangles of the last `intersect`
+    indexType numCandidates() const { return n_candidates ; }
+
+  } ;
+
+  /*\
+   |    ____ _       _   _           _     _ _____                     _
+   |   / ___| | ___ | |_| |__   ___ (_) __| |  ___| __ ___ _ __   ___| |_
+   |  | |   | |/ _ \| __| '_ \ / _ \| |/ _` | |_ | '__/ _ \ '_ \ / _ \ __|
+   |  | |___| | (_) | |_| | | | (_) | | (_| |  _|| | |  __/ | | |  __/ |_
+   |   \____|_|\___/ \__|_| |_|\___/|_|\__,_|_|  |_|  \___|_| |_|\___|\__|
+  \*/
+  //! \brief Conversion between cartesian and Frenet coordinates along a chain of clothoids
+  /*!
+   * The reference path is a chain of consecutive curves, `s` is the
+   * arclength from the beginning of the chain and `d` the signed lateral
+   * distance (positive on the left, the `offs` of `ClothoidCurve::eval`).
+   * Beyond the ends the path is extended along the tangent.
+   *
+   * `toFrenet` is stateful: the projection of a point starts with Newton
+   * from the `s` of the previous point, moving to the next or previous
+   * curve of the chain when the iterate leaves the current one.
+   * The distance from the path changes at most as the point moves, so a
+   * local solution farther than `dist_prev + |Q-Q_prev|` is not the
+   * closest point: only in this case, when Newton fails or after `reset`,
+   * the point is projected with a global search on the trees of the curves.
+   * Consecutive points stay on the same branch of the path, a closer
+   * branch that appears within this bound (e.g. on a loop) is not taken.
+   */
+  class ClothoidFrenet {
+
+    vector<ClothoidCurve>     curves ;
+    vector<ClothoidEvaluator> evals ;
+    vector<ClothoidBVH>       trees ;  //!< for the global search, built on demand
+    vector<valueType>         s0 ;     //!< chain abscissa of the beginning of the curves, `s0.back()` is the length
+
+    valueType tolerance ;
+    indexType max_iter ;
+
+    // state of the last toFrenet
+    bool      warm ;
+    indexType i_last ;
+    valueType s_last, x_last, y_last, dist_last ;
+
+    indexType n_local, n_global ;
+
+    // Newton from `(i,s)`, false if it does not converge to a minimum
+    bool
+    localProject( valueType   x,
+                  valueType   y,
+                  indexType & i,
+                  valueType & s ) const ;
+
+    void
+    globalProject( valueType   x,
+                   valueType   y,
+                   indexType & i,
+                   valueType & s ) ;
+
+    // Frenet coordinates of `(x,y)` with closest point at `s` of curve `i`
+    void
+    frenet( indexType   i,
+            valueType   s,
+            valueType   x,
+            valueType   y,
+            valueType & sc,
+            valueType & d,
+            valueType & dist ) const ;
+
+  public:
+
+    ClothoidFrenet()
+    : tolerance(1e-10), max_iter(20), warm(false), i_last(0)
+    , s_last(0), x_last(0), y_last(0), dist_last(0)
+    , n_local(0), n_global(0)
+    { s0.push_back(0) ; }
+
+    explicit
+    ClothoidFrenet( ClothoidCurve const & c )
+    : tolerance(1e-10), max_iter(20)
+    { setup( c ) ; }
+
+    explicit
+    ClothoidFrenet( vector<ClothoidCurve> const & c )
+    : tolerance(1e-10), max_iter(20)
+    { setup( c ) ; }
+
+    ~ClothoidFrenet() {}
+
+    //! reference path made of the single curve `c`
+    void setup( ClothoidCurve const & c ) ;
+
+    //! reference path made of the consecutive curves `c`
+    void setup( vector<ClothoidCurve> const & c ) ;
+
+    //! forget the previous point, the next projection is global
+    void reset() { warm = false ; }
+
+    //! tolerance on `s` and maximum number of Newton iterations of the local projection
+    void
+    setTolerance( valueType tol, indexType maxIter )
+    { tolerance = tol ; max_iter = maxIter ; }
+
+    valueType length()    const { return s0.back() ; }
+    indexType numCurves() const { return indexType(curves.size()) ; }
+
+    //! number of `toFrenet` solved by the warm started Newton and by the global search
+    void
+    stats( indexType & nLocal, indexType & nGlobal ) const
+    { nLocal = n_local ; nGlobal = n_global ; }
+
+    void statsReset() { n_local = n_global = 0 ; }
+
+    //! Frenet coordinates of `(x,y)`, warm started from the previous call
+    void
+    toFrenet( valueType   x,
+              valueType   y,
+              valueType & s,
+              valueType & d ) ;
+
+    //! `toFrenet` of the consecutive points of a trajectory
+    void
+    toFrenet( indexType       n,
+              valueType const x[],
+              valueType const y[],
+              valueType       s[],
+              valueType       d[] ) ;
+
+    //! cartesian coordinates of `(s,d)`
+    void
+    toCartesian( valueType   s,
+                 valueType   d,
+                 valueType & x,
+                 valueType & y ) const ;
+
+    //! `toCartesian` of `n` points, in parallel when compiled with OpenMP
+    void
+    toCartesian( indexType       n,
+                 valueType const s[],
+                 valueType const d[],
+                 valueType       x[],
+                 valueType       y[] ) const ;
+
   } ;
   
+  /*\
+   |    ____ _       _   _           _     _  ____
+   |   / ___| | ___ | |_| |__   ___ (_) __| |/ ___|_      _____  ___ _ __
+   |  | |   | |/ _ \| __| '_ \ / _ \| |/ _` |\___ \ \ /\ / / _ \/ _ \ '_ \
+   |  | |___| | (_) | |_| | | | (_) | | (_| | ___) \ V  V /  __/  __/ |_) |
+   |   \____|_|\___/ \__|_| |_|\___/|_|\__,_||____/ \_/\_/ \___|\___| .__/
+   |                                                                |_|
+  \*/
+  //! \brief Band swept along a clothoid against a set of convex polygons
+  /*!
+   * The polygons (e.g. the obstacles of a map) are stored once in a
+   * bounding volume hierarchy of their boxes.
+   * A query is a curve with a band of offsets `[offs_min,offs_max]`,
+   * the union of the cross sections from \f$ P(s)+o_{min}N(s) \f$ to
+   * \f$ P(s)+o_{max}N(s) \f$ (a vehicle of width `w` is the band `[-w/2,w/2]`).
+   *
+   * The band is split in pieces of monotone heading, each one contained
+   * in the convex hull of the `bbTriangle` of the two border curves, and
+   * the pieces are the leaves of a hierarchy visited in order of `s`.
+   * A piece whose hull overlaps a polygon (separating axis test) is
+   * bisected until its first cross section touches the polygon or it is
+   * shorter than `tolerance`.
+   * The first contact returned is not later than the exact one and
+   * differs by at most `tolerance` from it.
+   * The border curves must not have cusps (\f$ 1-o\kappa > 0 \f$),
+   * otherwise the pieces are bounded by a square, still conservative.
+   */
+  class ClothoidSweep {
+
+  public:
+
+    //! node of the tree, the boxes of the polygons `p_index[i_begin..i_end-1]`
+    class Node {
+    public:
+      BBox2D    box ;
+      indexType i_begin, i_end ;
+      indexType child ; //!< first child (the second is `child+1`), -1 for a leaf
+    } ;
+
+  private:
+
+    vector<valueType> px, py ;    //!< vertices of the polygons
+    vector<indexType> p_begin ;   //!< polygon `i` has the vertices `p_begin[i]..p_begin[i+1]-1`
+    vector<BBox2D>    p_box ;
+    vector<indexType> p_index ;   //!< polygons in the order of the leaves
+    vector<Node>      nodes ;     //!< the root is `nodes[0]`
+    bool              built ;
+    valueType         split_angle ;
+    valueType         split_size ;
+
+    void buildTree( indexType inode, indexType i_begin, indexType i_end ) ;
+
+    // true if the box `b` overlaps the box of a polygon
+    bool boxHit( BBox2D const & b ) const ;
+
+    // polygons with box overlapping `b`
+    void candidates( BBox2D const & b, vector<indexType> & idx ) const ;
+
+  public:
+
+    ClothoidSweep() ;
+    ~ClothoidSweep() {}
+
+    //! remove all the polygons
+    void clear() ;
+
+    //! add the convex polygon with vertices `(x[i],y[i])`, `i=0..n-1` (segment if `n==2`)
+    void
+    addPolygon( indexType       n,
+                valueType const x[],
+                valueType const y[] ) ;
+
+    //! build the tree of the polygons, call after the last `addPolygon`
+    void build() ;
+
+    indexType numPolygons() const { return indexType(p_box.size()) ; }
+
+    //! maximum heading variation and length of the pieces of the band
+    void
+    setSplit( valueType angle, valueType size )
+    { split_angle = angle ; split_size = size ; }
+
+    //! true if the band `[offs_min,offs_max]` of `c` touches a polygon
+    bool
+    collision( ClothoidCurve const & c,
+               valueType             offs_min,
+               valueType             offs_max,
+               valueType             tolerance = 1e-8 ) const ;
+
+    /*! \brief first contact of the band `[offs_min,offs_max]` of `c` with the polygons
+     *
+     * Return false if there is no contact, otherwise `s` is the first
+     * contact and `ipoly` the polygon touched (in the order of `addPolygon`).
+     */
+    bool
+    firstContact( ClothoidCurve const & c,
+                  valueType             offs_min,
+                  valueType             offs_max,
+                  valueType           & s,
+                  indexType           & ipoly,
+                  valueType             tolerance = 1e-8 ) const ;
+
+  } ;
+
+  /*\
+   |    ____ _       _   _           _     _  ____           _
+   |   / ___| | ___ | |_| |__   ___ (_) __| ||  _ \ __ _ ___| |_ ___ _ __
+   |  | |   | |/ _ \| __| '_ \ / _ \| |/ _` || |_) / _` / __| __/ _ \ '__|
+   |  | |___| | (_) | |_| | | | (_) | | (_| ||  _ < (_| \__ \ ||  __/ |
+   |   \____|_|\___/ \__|_| |_|\___/|_|\__,_||_| \_\__,_|___/\__\___|_|
+  \*/
+  //! \brief Rasterization of clothoid bands on an occupancy grid
+  /*!
+   * The grid has `nx` by `ny` square cells of side `h`, the cell `(i,j)`
+   * is \f$ [x_0+ih,x_0+(i+1)h]\times[y_0+jh,y_0+(j+1)h] \f$ and is the
+   * element `grid[i+j*nx]` of the buffer of the caller.
+   *
+   * The band `[offs_min,offs_max]` of the curve (see `ClothoidSweep`) is
+   * covered by the convex hulls of the `bbTriangle` of its border curves
+   * on pieces whose length is adapted to the curvature and to `h`
+   * (the hull exceeds the band by less than about `h/4`), and the hulls
+   * are filled row by row with the cells they touch.
+   * Every cell touched by the band is set: the rasterization is
+   * conservative, up to a margin of `1e-9*h` for the rounding.
+   */
+  class ClothoidRaster {
+
+    valueType x0, y0, h ;
+    indexType nx, ny ;
+
+  public:
+
+    ClothoidRaster( valueType _x0, valueType _y0, valueType _h,
+                    indexType _nx, indexType _ny )
+    : x0(_x0), y0(_y0), h(_h), nx(_nx), ny(_ny)
+    {}
+
+    ~ClothoidRaster() {}
+
+    indexType numX() const { return nx ; }
+    indexType numY() const { return ny ; }
+    valueType cellSize() const { return h ; }
+
+    //! set to `value` the cells of `grid` touched by the band `[offs_min,offs_max]` of `c`
+    void
+    rasterize( ClothoidCurve const & c,
+               valueType             offs_min,
+               valueType             offs_max,
+               unsigned char         grid[],
+               unsigned char         value = 1 ) const ;
+
+    /*! \brief `rasterize` of many curves
+     *
+     * The hulls of the curves are computed in parallel, then the grid is
+     * divided in stripes of rows filled in parallel, each one by a single
+     * thread (no concurrent writes, the result does not depend on the
+     * number of threads).
+     */
+    void
+    rasterize( vector<ClothoidCurve> const & c,
+               valueType                     offs_min,
+               valueType                     offs_max,
+               unsigned char                 grid[],
+               unsigned char                 value = 1 ) const ;
+
+  } ;
+
+  /*\
+   |    ____ _       _   _           _     _  ____  _     _                       _____ _      _     _
+   |   / ___| | ___ | |_| |__   ___ (_) __| ||  _ \(_)___| |_ __ _ _ __   ___ ___|  ___(_) ___| | __| |
+   |  | |   | |/ _ \| __| '_ \ / _ \| |/ _` || | | | / __| __/ _` | '_ \ / __/ _ \ |_  | |/ _ \ |/ _` |
+   |  | |___| | (_) | |_| | | | (_) | | (_| || |_| | \__ \ || (_| | | | | (_|  __/  _| | |  __/ | (_| |
+   |   \____|_|\___/ \__|_| |_|\___/|_|\__,_||____/|_|___/\__\__,_|_| |_|\___\___|_|   |_|\___|_|\__,_|
+  \*/
+  //! \brief Distance field of a set of offset clothoids on a grid
+  /*!
+   * The grid is the one of `ClothoidRaster`, the distance is computed at
+   * the centers of the cells and written in a `float` buffer of the
+   * caller, `dist[i+j*nx]`.
+   *
+   * The cells whose center is closer than `near*h` to a curve are found
+   * rasterizing the band `[offs-near*h,offs+near*h]` of the curve and
+   * their distance is computed exactly with `ClothoidBVH::project`, in
+   * parallel over tiles of cells.
+   * These cells are the sites of a linear time Euclidean distance
+   * transform (Felzenszwalb and Huttenlocher) which gives for any other
+   * cell the closest site, the distance is the one from the closest point
+   * of the curve found for that site: an upper bound of the exact distance,
+   * larger by a fraction of `h`.
+   * The sites are cells of the grid, so the parts of the curves outside
+   * the grid are not seen.
+   *
+   * `update` replaces some of the curves and recomputes only the tiles
+   * near the old and the new curves, then the transform of the whole
+   * grid: the result is the same of `build` with the new curves.
+   */
+  class ClothoidDistanceField {
+
+    valueType x0, y0, h ;
+    indexType nx, ny ;
+    valueType near ;        //!< radius of the exact band in cells
+
+    vector<ClothoidCurve> curves ;
+    vector<valueType>     offs ;
+    vector<ClothoidBVH>   trees ;
+    vector<BBox2D>        boxes ;   //!< boxes of the exact bands of the curves
+
+    // sites of the transform
+    vector<valueType> site_d ;      //!< exact distance, HUGE_VAL if the cell is not a site
+    vector<valueType> foot_x, foot_y ; //!< closest point of the curves to the site
+    vector<indexType> near_row ;    //!< workspace, closest site in the column
+
+    valueType near_time, edt_time ; //!< seconds
+
+    void setupCurve( indexType k ) ;
+    void nearTiles( vector<char> const & tiles ) ;
+    void transform( float dist[] ) ;
+
+  public:
+
+    ClothoidDistanceField( valueType _x0, valueType _y0, valueType _h,
+                           indexType _nx, indexType _ny, valueType _near = 1 )
+    : x0(_x0), y0(_y0), h(_h), nx(_nx), ny(_ny), near(_near)
+    , near_time(0), edt_time(0)
+    {}
+
+    ~ClothoidDistanceField() {}
+
+    indexType numX() const { return nx ; }
+    indexType numY() const { return ny ; }
+    valueType cellSize() const { return h ; }
+
+    //! distance field of the curves `c` with offsets `c_offs` (empty for no offset)
+    void
+    build( vector<ClothoidCurve> const & c,
+           vector<valueType>     const & c_offs,
+           float                         dist[] ) ;
+
+    //! replace the curves `idx[k]` with `c[k]` and offset `c_offs[k]` (empty for no offset)
+    void
+    update( vector<indexType>     const & idx,
+            vector<ClothoidCurve> const & c,
+            vector<valueType>     const & c_offs,
+            float                         dist[] ) ;
+
+    //! number of cells with exact distance
+    indexType numSites() const ;
+
+    //! elapsed time of the exact band and of the transform of the last `build` or `update`
+    void
+    times( valueType & t_near, valueType & t_transform ) const
+    { t_near = near_time ; t_transform = edt_time ; }
+
+  } ;
+
   /*\
    |    ____ ____     _       _
    |   / ___|___ \ __| | __ _| |_ __ _
@@ -0,0 +1,597 @@
+/*--------------------------------------------------------------------------*\
+ |                                                                          |
+ |  Copyright (C) 2016                                                      |
+ |                                                                          |
+ |         , __                 , __                                        |
+ |        /|/  \               /|/  \                                       |
+ |         | __/ _   ,_         | __/ _   ,_                                | 
+ |         |   \|/  /  |  |   | |   \|/  /  |  |   |                        |
+ |         |(__/|__/   |_/ \_/|/|(__/|__/   |_/ \_/|/                       |
+ |                           /|                   /|                        |
+ |                           \|                   \|                        |
+ |                                                                          |
+ |      Enrico Bertolazzi                                                   |
+ |      Dipartimento di Ingegneria Industriale                              |
+ |      Universita` degli Studi di Trento                                   |
+ |      email: enrico.bertolazzi@unitn.it                                   |
+ |                                                                          |
+\*--------------------------------------------------------------------------*/
+
+#include "Clothoid.hh"
+
+#include <cmath>
+#include <ctime>
+#include <algorithm>
+
+namespace Clothoid {
+
+  using namespace std ;
+
+  static const valueType m_pi = 3.14159265358979323846264338328 ; // pi
+
+  // coarse splitting of the trees of ClothoidCurve::project
+  static const valueType PROJECT_SPLIT_ANGLE = m_pi/8 ;
+  static const indexType PROJECT_MAX_DEPTH   = 64 ;
+
+  // ---------------------------------------------------------------------------
+
+  static
+  inline
+  bool
+  boxOverlap( ClothoidBVH::Node const & a, ClothoidBVH::Node const & b ) {
+    return a.xmin <= b.xmax && b.xmin <= a.xmax &&
+           a.ymin <= b.ymax && b.ymin <= a.ymax ;
+  }
+
+  // half perimeter of the box, used to choose the node to open
+  static
+  inline
+  valueType
+  boxSize( ClothoidBVH::Node const & a ) {
+    return (a.xmax-a.xmin) + (a.ymax-a.ymin) ;
+  }
+
+  // ---------------------------------------------------------------------------
+
+  void
+  ClothoidBVH::build( ClothoidCurve const & c, valueType _offs ) {
+    // same splitting of ClothoidCurve::intersect
+    build( c, _offs, m_pi/50, (c.getSmax()-c.getSmin())/3 ) ;
+  }
+
+  void
+  ClothoidBVH::build( ClothoidCurve const & c,
+                      valueType             _offs,
+                      valueType             split_angle,
+                      valueType             split_size ) {
+    clock_t t0 = clock() ;
+    curve = c ;
+    offs  = _offs ;
+    c.bbSplit( split_angle, split_size, offs, segments, triangles ) ;
+    indexType n = indexType(segments.size()) ;
+    nodes.clear() ;
+    if ( n > 0 ) {
+      // a binary tree with n leaves has 2*n-1 nodes, no reallocation
+      nodes.reserve( size_t(2*n-1) ) ;
+      nodes.resize(1) ;
+      buildTree( 0, 0, n ) ;
+    }
+    build_time = valueType(clock()-t0)/CLOCKS_PER_SEC ;
+  }
+
+  /*
+   * The segments are ordered along the curve so that contiguous ranges
+   * are spatially coherent: each node is split at the middle of its range.
+   */
+  void
+  ClothoidBVH::buildTree( indexType inode, indexType i_begin, indexType i_end ) {
+    Node & node = nodes[inode] ;
+    node.i_begin = i_begin ;
+    node.i_end   = i_end ;
+    if ( i_end - i_begin == 1 ) {
+      Triangle2D const & t = triangles[i_begin] ;
+      node.child = -1 ;
+      node.xmin  = min( t.x1(), min( t.x2(), t.x3() ) ) ;
+      node.ymin  = min( t.y1(), min( t.y2(), t.y3() ) ) ;
+      node.xmax  = max( t.x1(), max( t.x2(), t.x3() ) ) ;
+      node.ymax  = max( t.y1(), max( t.y2(), t.y3() ) ) ;
+    } else {
+      indexType ic  = indexType(nodes.size()) ;
+      indexType mid = (i_begin+i_end)/2 ;
+      node.child = ic ;
+      nodes.resize( nodes.size()+2 ) ; // capacity is reserved, `node` is valid
+      buildTree( ic,   i_begin, mid ) ;
+      buildTree( ic+1, mid,     i_end ) ;
+      Node const & L = nodes[ic] ;
+      Node const & R = nodes[ic+1] ;
+      node.xmin = min( L.xmin, R.xmin ) ;
+      node.ymin = min( L.ymin, R.ymin ) ;
+      node.xmax = max( L.xmax, R.xmax ) ;
+      node.ymax = max( L.ymax, R.ymax ) ;
+    }
+  }
+
+  size_t
+  ClothoidBVH::memoryFootprint() const {
+    return sizeof(ClothoidBVH) +
+           segments.capacity()  * sizeof(ClothoidCurve) +
+           triangles.capacity() * sizeof(Triangle2D) +
+           nodes.capacity()     * sizeof(Node) ;
+  }
+
+  // ---------------------------------------------------------------------------
+
+  bool
+  ClothoidBVH::descend( ClothoidBVH const & B,
+                        vector<pair<indexType,indexType> > * pairs,
+                        vector<pair<indexType,indexType> > & stack ) const {
+    if ( nodes.empty() || B.nodes.empty() ) return false ;
+    bool found = false ;
+    stack.clear() ;
+    stack.push_back( pair<indexType,indexType>(0,0) ) ;
+    while ( !stack.empty() ) {
+      indexType ia = stack.back().first ;
+      indexType ib = stack.back().second ;
+      stack.pop_back() ;
+      Node const & na = nodes[ia] ;
+      Node const & nb = B.nodes[ib] ;
+      if ( !boxOverlap( na, nb ) ) continue ;
+      if ( na.child < 0 && nb.child < 0 ) {
+        if ( triangles[na.i_begin].overlap( B.triangles[nb.i_begin] ) ) {
+          if ( pairs == 0 ) return true ;
+          pairs->push_back( pair<indexType,indexType>(na.i_begin,nb.i_begin) ) ;
+          found = true ;
+        }
+      } else if ( nb.child < 0 || ( na.child >= 0 && boxSize(na) >= boxSize(nb) ) ) {
+        // open the larger node
+        stack.push_back( pair<indexType,indexType>(na.child+1,ib) ) ;
+        stack.push_back( pair<indexType,indexType>(na.child,ib) ) ;
+      } else {
+        stack.push_back( pair<indexType,indexType>(ia,nb.child+1) ) ;
+        stack.push_back( pair<indexType,indexType>(ia,nb.child) ) ;
+      }
+    }
+    return found ;
+  }
+
+  void
+  ClothoidBVH::overlap( ClothoidBVH const & B,
+                        vector<indexType> & i,
+                        vector<indexType> & j ) const {
+    IntersectWorkspace ws ;
+    overlap( B, i, j, ws ) ;
+  }
+
+  void
+  ClothoidBVH::overlap( ClothoidBVH const  & B,
+                        vector<indexType>  & i,
+                        vector<indexType>  & j,
+                        IntersectWorkspace & ws ) const {
+    size_t cap = ws.capacity() ;
+    ws.pairs.clear() ;
+    descend( B, &ws.pairs, ws.stack ) ;
+    sort( ws.pairs.begin(), ws.pairs.end() ) ;
+    i.resize( ws.pairs.size() ) ;
+    j.resize( ws.pairs.size() ) ;
+    for ( size_t k = 0 ; k < ws.pairs.size() ; ++k ) {
+      i[k] = ws.pairs[k].first ;
+      j[k] = ws.pairs[k].second ;
+    }
+    ws.count( cap, ws.capacity() ) ;
+  }
+
+  void
+  ClothoidBVH::intersect( ClothoidBVH const & B,
+                          vector<valueType> & s1,
+                          vector<valueType> & s2,
+                          indexType           max_iter,
+                          valueType           tolerance ) const {
+    IntersectWorkspace ws ;
+    intersect( B, s1, s2, max_iter, tolerance, ws ) ;
+  }
+
+  void
+  ClothoidBVH::intersect( ClothoidBVH const  & B,
+                          vector<valueType>  & s1,
+                          vector<valueType>  & s2,
+                          indexType            max_iter,
+                          valueType            tolerance,
+                          IntersectWorkspace & ws ) const {
+    size_t cap = ws.capacity() + s1.capacity() + s2.capacity() ;
+    // segments and circle arcs are intersected in closed form, the
+    // nearly straight arcs are not and go through the trees
+    if ( curve.isLineOrArc() && B.curve.isLineOrArc() ) {
+      curve.intersect_analytic( offs, B.curve, B.offs, s1, s2, ws.sa, ws.sb ) ;
+    } else {
+      ws.pairs.clear() ;
+      descend( B, &ws.pairs, ws.stack ) ;
+      // same order of the nested loop of ClothoidCurve::intersect
+      sort( ws.pairs.begin(), ws.pairs.end() ) ;
+      s1.clear() ;
+      s2.clear() ;
+      for ( size_t k = 0 ; k < ws.pairs.size() ; ++k ) {
+        ClothoidCurve c0 = segments[ws.pairs[k].first] ;
+        ClothoidCurve c1 = B.segments[ws.pairs[k].second] ;
+        valueType tmp_s1, tmp_s2 ;
+        indexType n_eval ;
+        bool ok = curve.intersect_internal( c0, offs,   tmp_s1, c0.s_max >= curve.s_max,
+                                            c1, B.offs, tmp_s2, c1.s_max >= B.curve.s_max,
+                                            max_iter, tolerance,
+                                            0, 0, n_eval ) ;
+        if ( ok ) ClothoidCurve::pushRoot( tmp_s1, tmp_s2, tolerance, s1, s2 ) ;
+      }
+    }
+    ws.count( cap, ws.capacity() + s1.capacity() + s2.capacity() ) ;
+  }
+
+  /*
+   * A point at distance u along a curve of length L from P0 is at distance
+   * at most u from P0 and L-u from P1: the curve lies in the ellipse with
+   * foci P0, P1 and major axis L, the offset curve in the ellipse enlarged
+   * by |offs|.
+   */
+  static
+  void
+  curveBox( ClothoidCurve const & c, valueType offs, ClothoidBVH::Node & b ) {
+    valueType x0, y0, x1, y1 ;
+    c.eval( c.getSmin(), x0, y0 ) ;
+    c.eval( c.getSmax(), x1, y1 ) ;
+    valueType a  = (c.getSmax()-c.getSmin())/2 ;
+    valueType dx = (x1-x0)/2, dy = (y1-y0)/2 ;
+    valueType f  = hypot( dx, dy ) ;
+    valueType b2 = max( valueType(0), (a-f)*(a+f) ) ;
+    valueType hx = a, hy = a ;
+    if ( f > 0 ) {
+      valueType ux = dx/f, uy = dy/f ;
+      hx = sqrt( a*a*ux*ux + b2*uy*uy ) ;
+      hy = sqrt( a*a*uy*uy + b2*ux*ux ) ;
+    }
+    valueType xm = (x0+x1)/2, ym = (y0+y1)/2 ;
+    valueType eps = 1e-10*( a + max( max( std::abs(x0), std::abs(y0) ),
+                                     max( std::abs(x1), std::abs(y1) ) ) ) ;
+    hx += std::abs(offs) + eps ;
+    hy += std::abs(offs) + eps ;
+    b.xmin = xm-hx ; b.xmax = xm+hx ;
+    b.ymin = ym-hy ; b.ymax = ym+hy ;
+  }
+
+  bool
+  ClothoidBVH::boxHit( Node const & b, vector<indexType> & stack ) const {
+    if ( nodes.empty() ) return false ;
+    stack.clear() ;
+    stack.push_back(0) ;
+    while ( !stack.empty() ) {
+      Node const & n = nodes[stack.back()] ;
+      stack.pop_back() ;
+      if ( !boxOverlap( n, b ) ) continue ;
+      if ( n.child < 0 ) return true ;
+      stack.push_back( n.child+1 ) ;
+      stack.push_back( n.child ) ;
+    }
+    return false ;
+  }
+
+  indexType
+  ClothoidBVH::intersect( vector<ClothoidCurve> const & c,
+                          valueType                     c_offs,
+                          vector<indexType>           & begin,
+                          vector<valueType>           & s1,
+                          vector<valueType>           & s2,
+                          indexType                     max_iter,
+                          valueType                     tolerance ) const {
+    begin.resize( c.size()+1 ) ;
+    s1.clear() ;
+    s2.clear() ;
+    ClothoidBVH        B ;  // reused, no reallocation once large enough
+    IntersectWorkspace ws ;
+    vector<valueType>  r1, r2 ;
+    indexType          n_kept = 0 ;
+    for ( size_t k = 0 ; k < c.size() ; ++k ) {
+      begin[k] = indexType(s1.size()) ;
+      Node box ;
+      curveBox( c[k], c_offs, box ) ;
+      if ( !boxHit( box, ws.id ) ) continue ;
+      ++n_kept ;
+      if ( curve.isLineOrArc() && c[k].isLineOrArc() ) {
+        curve.intersect_analytic( offs, c[k], c_offs, r1, r2, ws.sa, ws.sb ) ;
+      } else {
+        B.build( c[k], c_offs ) ;
+        intersect( B, r1, r2, max_iter, tolerance, ws ) ;
+      }
+      s1.insert( s1.end(), r1.begin(), r1.end() ) ;
+      s2.insert( s2.end(), r2.begin(), r2.end() ) ;
+    }
+    begin[c.size()] = indexType(s1.size()) ;
+    return n_kept ;
+  }
+
+  bool
+  ClothoidBVH::collision( ClothoidBVH const & B ) const {
+    IntersectWorkspace ws ;
+    return collision( B, ws ) ;
+  }
+
+  bool
+  ClothoidBVH::collision( ClothoidBVH const & B, IntersectWorkspace & ws ) const {
+    size_t cap = ws.capacity() ;
+    bool   ok  = descend( B, 0, ws.stack ) ;
+    ws.count( cap, ws.capacity() ) ;
+    return ok ;
+  }
+
+  // ---------------------------------------------------------------------------
+
+  // piece of a leaf in ClothoidBVH::project with its end points
+  class ProjectPiece {
+  public:
+    valueType a, xa, ya, da, ga ; // abscissa, point, distance, orthogonality condition
+    valueType b, xb, yb, db, gb ;
+    indexType depth ;
+  } ;
+
+  // point, distance and g = (P-Q).P' of the offset curve at s
+  static
+  inline
+  void
+  projectEval( ClothoidEvaluator const & e, valueType offs,
+               valueType x, valueType y, valueType s,
+               valueType & px, valueType & py,
+               valueType & d, valueType & g ) {
+    valueType px_D, py_D ;
+    e.eval( s, offs, px, py, px_D, py_D ) ;
+    d = hypot( px-x, py-y ) ;
+    g = (px-x)*px_D + (py-y)*py_D ;
+  }
+
+  // root of g in (a,b) with g(a) < 0 < g(b), g increasing
+  static
+  valueType
+  projectNewton( ClothoidEvaluator const & e, valueType offs,
+                 valueType x, valueType y,
+                 valueType a, valueType b, valueType ga, valueType gb,
+                 valueType tolerance ) {
+    valueType s = a - ga*(b-a)/(gb-ga) ;
+    for ( indexType iter = 0 ; iter < 2*PROJECT_MAX_DEPTH ; ++iter ) {
+      if ( !(s > a && s < b) ) s = (a+b)/2 ;
+      valueType px, py, px_D, py_D, px_DD, py_DD ;
+      e.eval( s, offs, px, py, px_D, py_D ) ;
+      e.eval_DD( s, offs, px_DD, py_DD ) ;
+      valueType g   = (px-x)*px_D + (py-y)*py_D ;
+      valueType g_D = px_D*px_D + py_D*py_D + (px-x)*px_DD + (py-y)*py_DD ;
+      if ( g == 0 ) break ;
+      if ( g < 0 ) a = s ; else b = s ;
+      valueType sn = g_D > 0 ? s - g/g_D : (a+b)/2 ;
+      if ( !(sn > a && sn < b) ) sn = (a+b)/2 ;
+      bool converged = std::abs(sn-s) <= tolerance || b-a <= tolerance ;
+      s = sn ;
+      if ( converged ) break ;
+    }
+    return s ;
+  }
+
+  // range of sin on [lo,hi]
+  static
+  void
+  sinRange( valueType lo, valueType hi, valueType & smin, valueType & smax ) {
+    smin = min( sin(lo), sin(hi) ) ;
+    smax = max( sin(lo), sin(hi) ) ;
+    if ( ceil( (lo-m_pi/2)/(2*m_pi) ) <= floor( (hi-m_pi/2)/(2*m_pi) ) ) smax = 1 ;
+    if ( ceil( (lo+m_pi/2)/(2*m_pi) ) <= floor( (hi+m_pi/2)/(2*m_pi) ) ) smin = -1 ;
+  }
+
+  // range of the product of two ranges
+  static
+  void
+  mulRange( valueType a0, valueType a1, valueType b0, valueType b1,
+            valueType & lo, valueType & hi ) {
+    valueType p0 = a0*b0, p1 = a0*b1, p2 = a1*b0, p3 = a1*b1 ;
+    lo = min( min( p0, p1 ), min( p2, p3 ) ) ;
+    hi = max( max( p0, p1 ), max( p2, p3 ) ) ;
+  }
+
+  /*
+   * Closest point on the piece [a,b] of the offset curve, with
+   * g = (P-Q).P' = (1-o*kappa) d cos(delta) and
+   * g' = (1-o*kappa)^2 + kappa (1-o*kappa) d sin(delta) - o*kappa' d cos(delta)
+   * where d = |P-Q| and delta is the angle from the tangent to P-Q.
+   * The offset curve is shorter than Lo = (b-a)*max|1-o*kappa|, so it lies
+   * in the disk of radius Lo/2 centered at the middle of its end points:
+   * this gives the ranges of d and of the direction of P-Q and, with the
+   * range of theta, of delta.
+   * The piece is discarded when g has constant sign or g' < 0 (minimum at
+   * an end point), is refined with Newton when g' > 0, otherwise bisected.
+   */
+  static
+  void
+  projectLeaf( ClothoidCurve     const & c,
+               ClothoidEvaluator const & e,
+               valueType                 offs,
+               valueType                 x,
+               valueType                 y,
+               valueType                 a,
+               valueType                 b,
+               valueType                 tolerance,
+               vector<ProjectPiece>    & stack,
+               valueType               & best,
+               valueType               & s_best ) {
+    ProjectPiece P ;
+    P.a = a ; P.b = b ; P.depth = 0 ;
+    projectEval( e, offs, x, y, a, P.xa, P.ya, P.da, P.ga ) ;
+    projectEval( e, offs, x, y, b, P.xb, P.yb, P.db, P.gb ) ;
+    if ( P.da < best ) { best = P.da ; s_best = a ; }
+    if ( P.db < best ) { best = P.db ; s_best = b ; }
+    valueType dk = c.getKappa_D() ;
+    stack.clear() ;
+    stack.push_back( P ) ;
+    while ( !stack.empty() ) {
+      P = stack.back() ;
+      stack.pop_back() ;
+      valueType ka = c.theta_D( P.a ), kb = c.theta_D( P.b ) ;
+      valueType oa = 1-offs*ka,        ob = 1-offs*kb ;
+      valueType Lo = (P.b-P.a)*max( std::abs(oa), std::abs(ob) ) ;
+      valueType mx = (P.xa+P.xb)/2-x, my = (P.ya+P.yb)/2-y ;
+      valueType dm = hypot( mx, my ) ;
+      valueType rho = Lo/2 ;
+      if ( dm-rho >= best ) continue ;
+
+      // ranges of |1-o*kappa| and kappa*|1-o*kappa|
+      valueType o_lo = min( std::abs(oa), std::abs(ob) ) ;
+      valueType o_hi = max( std::abs(oa), std::abs(ob) ) ;
+      if ( oa*ob <= 0 ) o_lo = 0 ;
+      valueType q0 = ka*std::abs(oa), q1 = kb*std::abs(ob) ;
+      valueType q_lo = min( q0, q1 ), q_hi = max( q0, q1 ) ;
+      if ( offs != 0 && oa*ob <= 0 ) { q_lo = min( q_lo, valueType(0) ) ; q_hi = max( q_hi, valueType(0) ) ; }
+      if ( offs != 0 ) { // extremum of kappa*(1-o*kappa) at kappa = 1/(2*o)
+        valueType ks = 1/(2*offs) ;
+        if ( (ks-ka)*(ks-kb) < 0 ) {
+          valueType qs = ks*std::abs(1-offs*ks) ;
+          q_lo = min( q_lo, qs ) ; q_hi = max( q_hi, qs ) ;
+        }
+      }
+
+      bool increasing = false, solved = false ;
+      if ( o_lo*o_lo > ( max( -q_lo, q_hi ) + std::abs(offs*dk) )*(dm+rho) ) {
+        // point close to the piece: g' > 0 for any direction of P-Q
+        increasing = solved = true ;
+      } else if ( dm > rho ) {
+        // ranges of d and delta
+        valueType d_lo = dm-rho, d_hi = dm+rho ;
+        valueType beta = atan2( my, mx ), dbeta = asin( rho/dm ) ;
+        valueType th_lo = min( c.theta(P.a), c.theta(P.b) ) ;
+        valueType th_hi = max( c.theta(P.a), c.theta(P.b) ) ;
+        if ( dk != 0 ) {
+          valueType s_ext = -c.getKappa()/dk ;
+          if ( s_ext > P.a && s_ext < P.b ) {
+            th_lo = min( th_lo, c.theta(s_ext) ) ;
+            th_hi = max( th_hi, c.theta(s_ext) ) ;
+          }
+        }
+        valueType dl_lo = beta-dbeta-th_hi, dl_hi = beta+dbeta-th_lo ;
+        // P' = T (1-o*kappa), a cusp turns T
+        if ( oa < 0 && ob < 0 ) { dl_lo += m_pi ; dl_hi += m_pi ; }
+        valueType s_lo, s_hi, c_lo, c_hi ;
+        sinRange( dl_lo, dl_hi, s_lo, s_hi ) ;
+        sinRange( dl_lo+m_pi/2, dl_hi+m_pi/2, c_lo, c_hi ) ;
+        if ( oa*ob > 0 && ( c_lo > 0 || c_hi < 0 ) ) {
+          solved = true ; // g has constant sign
+        } else {
+          valueType t2_lo, t2_hi, t3_lo, t3_hi, w_lo, w_hi ;
+          mulRange( q_lo, q_hi, d_lo, d_hi, w_lo, w_hi ) ;
+          mulRange( w_lo, w_hi, s_lo, s_hi, t2_lo, t2_hi ) ;
+          mulRange( -offs*dk*d_lo, -offs*dk*d_hi, c_lo, c_hi, t3_lo, t3_hi ) ;
+          valueType gD_lo = o_lo*o_lo + t2_lo + t3_lo ;
+          valueType gD_hi = o_hi*o_hi + t2_hi + t3_hi ;
+          increasing = gD_lo > 0 ;
+          solved     = increasing || gD_hi < 0 ;
+        }
+      }
+      if ( solved || P.b-P.a <= tolerance || P.depth >= PROJECT_MAX_DEPTH ) {
+        if ( increasing && P.ga < 0 && P.gb > 0 ) {
+          valueType s = projectNewton( e, offs, x, y, P.a, P.b, P.ga, P.gb, tolerance ) ;
+          valueType px, py, d, g ;
+          projectEval( e, offs, x, y, s, px, py, d, g ) ;
+          if ( d < best ) { best = d ; s_best = s ; }
+        }
+        continue ;
+      }
+      ProjectPiece L = P, R = P ;
+      L.b = R.a = (P.a+P.b)/2 ;
+      projectEval( e, offs, x, y, L.b, L.xb, L.yb, L.db, L.gb ) ;
+      R.xa = L.xb ; R.ya = L.yb ; R.da = L.db ; R.ga = L.gb ;
+      L.depth = R.depth = P.depth+1 ;
+      if ( L.db < best ) { best = L.db ; s_best = L.b ; }
+      stack.push_back( R ) ;
+      stack.push_back( L ) ;
+    }
+  }
+
+  // node and distance of its box from the point, smallest on top of the heap
+  class ProjectNode {
+  public:
+    valueType lower ;
+    indexType node ;
+    ProjectNode( valueType _lower, indexType _node ) : lower(_lower), node(_node) {}
+    bool operator < ( ProjectNode const & n ) const { return lower > n.lower ; }
+  } ;
+
+  static
+  inline
+  valueType
+  boxDistance( ClothoidBVH::Node const & n, valueType x, valueType y ) {
+    valueType dx = max( valueType(0), max( n.xmin-x, x-n.xmax ) ) ;
+    valueType dy = max( valueType(0), max( n.ymin-y, y-n.ymax ) ) ;
+    return hypot( dx, dy ) ;
+  }
+
+  valueType
+  ClothoidBVH::project( valueType   x,
+                        valueType   y,
+                        valueType & s,
+                        valueType   tolerance,
+                        valueType   max_dist ) const {
+    s = curve.getSmin() ;
+    if ( nodes.empty() ) return HUGE_VAL ;
+    ClothoidEvaluator    e( curve ) ;
+    vector<ProjectNode>  heap ;
+    vector<ProjectPiece> stack ;
+    valueType            best = max_dist ;
+    heap.push_back( ProjectNode( boxDistance( nodes[0], x, y ), 0 ) ) ;
+    while ( !heap.empty() ) {
+      std::pop_heap( heap.begin(), heap.end() ) ;
+      ProjectNode P = heap.back() ;
+      heap.pop_back() ;
+      if ( P.lower >= best ) break ; // all the others are farther
+      Node const & n = nodes[P.node] ;
+      if ( n.child < 0 ) {
+        ClothoidCurve const & seg = segments[n.i_begin] ;
+        projectLeaf( curve, e, offs, x, y, seg.getSmin(), seg.getSmax(),
+                     tolerance, stack, best, s ) ;
+      } else {
+        for ( indexType k = 0 ; k < 2 ; ++k ) {
+          valueType lb = boxDistance( nodes[n.child+k], x, y ) ;
+          if ( lb < best ) {
+            heap.push_back( ProjectNode( lb, n.child+k ) ) ;
+            std::push_heap( heap.begin(), heap.end() ) ;
+          }
+        }
+      }
+    }
+    return best < max_dist ? best : HUGE_VAL ;
+  }
+
+  void
+  ClothoidBVH::project( indexType       n,
+                        valueType const x[],
+                        valueType const y[],
+                        valueType       s[],
+                        valueType       dist[],
+                        valueType       tolerance ) const {
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic,64)
+    #endif
+    for ( indexType i = 0 ; i < n ; ++i )
+      dist[i] = project( x[i], y[i], s[i], tolerance ) ;
+  }
+
+  valueType
+  ClothoidCurve::project( valueType   x,
+                          valueType   y,
+                          valueType   offs,
+                          valueType & s,
+                          valueType   tolerance ) const {
+    ClothoidBVH B( *this, offs, PROJECT_SPLIT_ANGLE, s_max-s_min ) ;
+    return B.project( x, y, s, tolerance ) ;
+  }
+
+  void
+  ClothoidCurve::project( indexType       n,
+                          valueType const x[],
+                          valueType const y[],
+                          valueType       offs,
+                          valueType       s[],
+                          valueType       dist[],
+                          valueType       tolerance ) const {
+    ClothoidBVH B( *this, offs, PROJECT_SPLIT_ANGLE, s_max-s_min ) ;
+    B.project( n, x, y, s, dist, tolerance ) ;
+  }
+}
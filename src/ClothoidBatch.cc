@@ -0,0 +1,366 @@
+/*--------------------------------------------------------------------------*\
+ |                                                                          |
+ |  Copyright (C) 2016                                                      |
+ |                                                                          |
+ |         , __                 , __                                        |
+ |        /|/  \               /|/  \                                       |
+ |         | __/ _   ,_         | __/ _   ,_                                | 
+ |         |   \|/  /  |  |   | |   \|/  /  |  |   |                        |
+ |         |(__/|__/   |_/ \_/|/|(__/|__/   |_/ \_/|/                       |
+ |                           /|                   /|                        |
+ |                           \|                   \|                        |
+ |                                                                          |
+ |      Enrico Bertolazzi                                                   |
+ |      Dipartimento di Ingegneria Industriale                              |
+ |      Universita` degli Studi di Trento                                   |
+ |      email: enrico.bertolazzi@unitn.it                                   |
+ |                                                                          |
+\*--------------------------------------------------------------------------*/
+
+#include "Clothoid.hh"
+
+#include <cmath>
+#include <cstddef>
+#include <sstream>
+#include <stdexcept>
+
+#ifndef CLOTHOID_ASSERT
+  #define CLOTHOID_ASSERT(COND,MSG)         \
+    if ( !(COND) ) {                        \
+      std::ostringstream ost ;              \
+      ost << "On line: " << __LINE__        \
+          << " file: " << __FILE__          \
+          << '\n' << MSG << '\n' ;          \
+      throw std::runtime_error(ost.str()) ; \
+    }
+#endif
+
+namespace Clothoid {
+
+  using namespace std ;
+
+  //! \cond NODOC
+
+  static const valueType m_pi = 3.14159265358979323846264338328 ; // pi
+
+  // index of the i-th value, unit stride is the structure of arrays case
+  class UnitStride {
+  public:
+    UnitStride( indexType ) {}
+    indexType operator () ( indexType i ) const { return i ; }
+  } ;
+
+  // stride of a view of an array of ClothoidCurve
+  class AnyStride {
+    indexType const st ;
+  public:
+    AnyStride( indexType _st ) : st(_st) {}
+    indexType operator () ( indexType i ) const { return i*st ; }
+  } ;
+
+  template <typename IDX>
+  static
+  void
+  batchRotate( IDX       idx,
+               indexType n,
+               valueType angle,
+               valueType cx,
+               valueType cy,
+               valueType x0[],
+               valueType y0[],
+               valueType theta0[] ) {
+    valueType C = cos(angle) ;
+    valueType S = sin(angle) ;
+    for ( indexType i = 0 ; i < n ; ++i ) {
+      indexType ii = idx(i) ;
+      valueType dx = x0[ii] - cx ;
+      valueType dy = y0[ii] - cy ;
+      x0[ii]      = cx + (C*dx - S*dy) ;
+      y0[ii]      = cy + (C*dy + S*dx) ;
+      theta0[ii] += angle ;
+    }
+  }
+
+  template <typename IDX>
+  static
+  void
+  batchTranslate( IDX       idx,
+                  indexType n,
+                  valueType tx,
+                  valueType ty,
+                  valueType x0[],
+                  valueType y0[] ) {
+    for ( indexType i = 0 ; i < n ; ++i ) {
+      indexType ii = idx(i) ;
+      x0[ii] += tx ;
+      y0[ii] += ty ;
+    }
+  }
+
+  template <typename IDX>
+  static
+  void
+  batchScale( IDX       idx,
+              indexType n,
+              valueType s,
+              valueType k[],
+              valueType dk[],
+              valueType s_min[],
+              valueType s_max[] ) {
+    valueType s2 = s*s ;
+    for ( indexType i = 0 ; i < n ; ++i ) {
+      indexType ii = idx(i) ;
+      k[ii]     /= s ;
+      dk[ii]    /= s2 ;
+      s_min[ii] *= s ;
+      s_max[ii] *= s ;
+    }
+  }
+
+  template <typename IDX>
+  static
+  void
+  batchReverse( IDX       idx,
+                indexType n,
+                valueType theta0[],
+                valueType k[],
+                valueType s_min[],
+                valueType s_max[] ) {
+    for ( indexType i = 0 ; i < n ; ++i ) {
+      indexType ii = idx(i) ;
+      valueType a  = s_min[ii] ;
+      valueType b  = s_max[ii] ;
+      // same operations of ClothoidCurve::reverse, the select is branch free
+      valueType th = theta0[ii] + m_pi ;
+      theta0[ii]   = th > m_pi ? th - 2*m_pi : th ;
+      k[ii]       = -k[ii] ;
+      s_min[ii]   = -b ;
+      s_max[ii]   = -a ;
+    }
+  }
+
+  // the same operations of ClothoidCurve::eval, cos and sin of theta0 in trig
+  template <typename IDX>
+  static
+  void
+  batchEval( IDX             idx,
+             indexType       n,
+             valueType const x0[],
+             valueType const y0[],
+             valueType const k[],
+             valueType const dk[],
+             valueType const trig[],
+             valueType const s[],
+             valueType       x[],
+             valueType       y[] ) {
+    for ( indexType i = 0 ; i < n ; ++i ) {
+      indexType ii = idx(i) ;
+      valueType si = s[i] ;
+      valueType C, S ;
+      GeneralizedFresnelCS( dk[ii]*si*si, k[ii]*si, trig[2*i], trig[2*i+1], C, S ) ;
+      x[i] = x0[ii] + si*C ;
+      y[i] = y0[ii] + si*S ;
+    }
+  }
+
+  template <typename IDX>
+  static
+  void
+  batchEvalOffset( IDX             idx,
+                   indexType       n,
+                   valueType const x0[],
+                   valueType const y0[],
+                   valueType const theta0[],
+                   valueType const k[],
+                   valueType const dk[],
+                   valueType const trig[],
+                   valueType const s[],
+                   valueType       offs,
+                   valueType       x[],
+                   valueType       y[] ) {
+    for ( indexType i = 0 ; i < n ; ++i ) {
+      indexType ii = idx(i) ;
+      valueType si = s[i] ;
+      valueType C, S ;
+      GeneralizedFresnelCS( dk[ii]*si*si, k[ii]*si, trig[2*i], trig[2*i+1], C, S ) ;
+      valueType theta = theta0[ii] + si*(k[ii]+si*(dk[ii]/2)) ;
+      x[i] = x0[ii] + si*C - offs * sin(theta) ;
+      y[i] = y0[ii] + si*S + offs * cos(theta) ;
+    }
+  }
+
+  template <typename IDX>
+  static
+  void
+  batchAngle( IDX             idx,
+              indexType       n,
+              valueType const theta0[],
+              valueType const k[],
+              valueType const dk[],
+              valueType const s[],
+              valueType       theta[],
+              valueType       kappa[] ) {
+    for ( indexType i = 0 ; i < n ; ++i ) {
+      indexType ii = idx(i) ;
+      valueType si = s[i] ;
+      theta[i] = theta0[ii] + si*(k[ii]+si*(dk[ii]/2)) ;
+      kappa[i] = k[ii] + si*dk[ii] ;
+    }
+  }
+
+  //! \endcond
+
+  void
+  ClothoidBatch::resize( indexType nc ) {
+    CLOTHOID_ASSERT( nc >= 0, "ClothoidBatch::resize, nc = " << nc << " must be >= 0" ) ;
+    data.resize( size_t(7*nc) ) ;
+    trig_ok = false ;
+    n      = nc ;
+    stride = 1 ;
+    valueType * p = data.empty() ? 0 : &data.front() ;
+    x0     = p ;
+    y0     = p + n ;
+    theta0 = p + 2*n ;
+    k      = p + 3*n ;
+    dk     = p + 4*n ;
+    s_min  = p + 5*n ;
+    s_max  = p + 6*n ;
+  }
+
+  void
+  ClothoidBatch::load( ClothoidCurve const c[], indexType nc ) {
+    resize( nc ) ;
+    for ( indexType i = 0 ; i < n ; ++i ) set( i, c[i] ) ;
+  }
+
+  void
+  ClothoidBatch::view( ClothoidCurve c[], indexType nc ) {
+    // the view relies on ClothoidCurve being a plain sequence of 7 valueType,
+    // checked at compile time (the array has negative size otherwise)
+    typedef char layout_check[ sizeof(ClothoidCurve) == 7*sizeof(valueType) &&
+                               offsetof(ClothoidCurve,x0)     == 0*sizeof(valueType) &&
+                               offsetof(ClothoidCurve,y0)     == 1*sizeof(valueType) &&
+                               offsetof(ClothoidCurve,theta0) == 2*sizeof(valueType) &&
+                               offsetof(ClothoidCurve,k)      == 3*sizeof(valueType) &&
+                               offsetof(ClothoidCurve,dk)     == 4*sizeof(valueType) &&
+                               offsetof(ClothoidCurve,s_min)  == 5*sizeof(valueType) &&
+                               offsetof(ClothoidCurve,s_max)  == 6*sizeof(valueType) ? 1 : -1 ] ;
+    (void) sizeof(layout_check) ;
+    data.clear() ;
+    trig_ok = false ;
+    n      = nc ;
+    stride = 7 ;
+    if ( nc > 0 ) {
+      x0     = &c[0].x0 ;
+      y0     = &c[0].y0 ;
+      theta0 = &c[0].theta0 ;
+      k      = &c[0].k ;
+      dk     = &c[0].dk ;
+      s_min  = &c[0].s_min ;
+      s_max  = &c[0].s_max ;
+    } else {
+      x0 = y0 = theta0 = k = dk = s_min = s_max = 0 ;
+    }
+  }
+
+  void
+  ClothoidBatch::store( ClothoidCurve c[] ) const {
+    for ( indexType i = 0 ; i < n ; ++i ) get( i, c[i] ) ;
+  }
+
+  void
+  ClothoidBatch::get( indexType i, ClothoidCurve & c ) const {
+    indexType ii = i*stride ;
+    c.setup( x0[ii], y0[ii], theta0[ii], k[ii], dk[ii], s_min[ii], s_max[ii] ) ;
+  }
+
+  void
+  ClothoidBatch::set( indexType i, ClothoidCurve const & c ) {
+    indexType ii = i*stride ;
+    x0[ii]     = c.x0 ;
+    y0[ii]     = c.y0 ;
+    theta0[ii] = c.theta0 ;
+    k[ii]      = c.k ;
+    dk[ii]     = c.dk ;
+    s_min[ii]  = c.s_min ;
+    s_max[ii]  = c.s_max ;
+    trig_ok    = false ;
+  }
+
+  void
+  ClothoidBatch::rotate( valueType angle, valueType cx, valueType cy ) {
+    trig_ok = false ;
+    if ( stride == 1 ) batchRotate( UnitStride(1),     n, angle, cx, cy, x0, y0, theta0 ) ;
+    else               batchRotate( AnyStride(stride), n, angle, cx, cy, x0, y0, theta0 ) ;
+  }
+
+  void
+  ClothoidBatch::translate( valueType tx, valueType ty ) {
+    if ( stride == 1 ) batchTranslate( UnitStride(1),     n, tx, ty, x0, y0 ) ;
+    else               batchTranslate( AnyStride(stride), n, tx, ty, x0, y0 ) ;
+  }
+
+  void
+  ClothoidBatch::scale( valueType s ) {
+    if ( stride == 1 ) batchScale( UnitStride(1),     n, s, k, dk, s_min, s_max ) ;
+    else               batchScale( AnyStride(stride), n, s, k, dk, s_min, s_max ) ;
+  }
+
+  void
+  ClothoidBatch::reverse() {
+    trig_ok = false ;
+    if ( stride == 1 ) batchReverse( UnitStride(1),     n, theta0, k, s_min, s_max ) ;
+    else               batchReverse( AnyStride(stride), n, theta0, k, s_min, s_max ) ;
+  }
+
+  void
+  ClothoidBatch::updateTrig() const {
+    if ( trig_ok ) return ;
+    trig.resize( size_t(2*n) ) ;
+    for ( indexType i = 0 ; i < n ; ++i ) {
+      valueType th = theta0[i*stride] ;
+      trig[2*i]   = cos(th) ;
+      trig[2*i+1] = sin(th) ;
+    }
+    trig_ok = true ;
+  }
+
+  void
+  ClothoidBatch::eval( valueType const s[],
+                       valueType       x[],
+                       valueType       y[] ) const {
+    if ( n == 0 ) return ;
+    updateTrig() ;
+    if ( stride == 1 ) batchEval( UnitStride(1),     n, x0, y0, k, dk, &trig.front(), s, x, y ) ;
+    else               batchEval( AnyStride(stride), n, x0, y0, k, dk, &trig.front(), s, x, y ) ;
+  }
+
+  void
+  ClothoidBatch::eval( valueType const s[],
+                       valueType       offs,
+                       valueType       x[],
+                       valueType       y[] ) const {
+    if ( n == 0 ) return ;
+    updateTrig() ;
+    if ( stride == 1 ) batchEvalOffset( UnitStride(1),     n, x0, y0, theta0, k, dk, &trig.front(), s, offs, x, y ) ;
+    else               batchEvalOffset( AnyStride(stride), n, x0, y0, theta0, k, dk, &trig.front(), s, offs, x, y ) ;
+  }
+
+  void
+  ClothoidBatch::eval( valueType const s[],
+                       valueType       theta[],
+                       valueType       kappa[],
+                       valueType       x[],
+                       valueType       y[] ) const {
+    if ( n == 0 ) return ;
+    updateTrig() ;
+    if ( stride == 1 ) {
+      batchEval( UnitStride(1), n, x0, y0, k, dk, &trig.front(), s, x, y ) ;
+      batchAngle( UnitStride(1), n, theta0, k, dk, s, theta, kappa ) ;
+    } else {
+      batchEval( AnyStride(stride), n, x0, y0, k, dk, &trig.front(), s, x, y ) ;
+      batchAngle( AnyStride(stride), n, theta0, k, dk, s, theta, kappa ) ;
+    }
+  }
+
+}
@@ -0,0 +1,269 @@
+/*--------------------------------------------------------------------------*\
+ |                                                                          |
+ |  Copyright (C) 2016                                                      |
+ |                                                                          |
+ |         , __                 , __                                        |
+ |        /|/  \               /|/  \                                       |
+ |         | __/ _   ,_         | __/ _   ,_                                | 
+ |         |   \|/  /  |  |   | |   \|/  /  |  |   |                        |
+ |         |(__/|__/   |_/ \_/|/|(__/|__/   |_/ \_/|/                       |
+ |                           /|                   /|                        |
+ |                           \|                   \|                        |
+ |                                                                          |
+ |      Enrico Bertolazzi                                                   |
+ |      Dipartimento di Ingegneria Industriale                              |
+ |      Universita` degli Studi di Trento                                   |
+ |      email: enrico.bertolazzi@unitn.it                                   |
+ |                                                                          |
+\*--------------------------------------------------------------------------*/
+
+#include "Clothoid.hh"
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+
+#ifndef CLOTHOID_ASSERT
+  #define CLOTHOID_ASSERT(COND,MSG)         \
+    if ( !(COND) ) {                        \
+      std::ostringstream ost ;              \
+      ost << "On line: " << __LINE__        \
+          << " file: " << __FILE__          \
+          << '\n' << MSG << '\n' ;          \
+      throw std::runtime_error(ost.str()) ; \
+    }
+#endif
+
+namespace Clothoid {
+
+  using namespace std ;
+
+  static const valueType m_pi = 3.14159265358979323846264338328 ; // pi
+
+  // splitting of the trees of the global search, as ClothoidCurve::project
+  static const valueType FRENET_SPLIT_ANGLE = m_pi/8 ;
+
+  // ---------------------------------------------------------------------------
+
+  void
+  ClothoidFrenet::setup( ClothoidCurve const & c ) {
+    vector<ClothoidCurve> cc ;
+    cc.push_back( c ) ;
+    setup( cc ) ;
+  }
+
+  // ---------------------------------------------------------------------------
+
+  void
+  ClothoidFrenet::setup( vector<ClothoidCurve> const & c ) {
+    CLOTHOID_ASSERT( !c.empty(), "ClothoidFrenet::setup, empty chain of curves" ) ;
+    curves = c ;
+    evals.resize( c.size() ) ;
+    s0.resize( c.size()+1 ) ;
+    s0[0] = 0 ;
+    for ( size_t k = 0 ; k < c.size() ; ++k ) {
+      evals[k].setup( c[k] ) ;
+      s0[k+1] = s0[k] + c[k].getSmax() - c[k].getSmin() ;
+    }
+    trees.clear() ;
+    warm     = false ;
+    i_last   = 0 ;
+    s_last   = x_last = y_last = dist_last = 0 ;
+    n_local  = n_global = 0 ;
+  }
+
+  // ---------------------------------------------------------------------------
+
+  /*
+   * Newton on g(s) = (Q-P(s)).T(s) with g'(s) = -(1-kappa*d), d = (Q-P).N,
+   * a step out of the curve continues on the next (previous) curve of the
+   * chain with the remaining length.
+   * The iterate stops at a junction when the two curves push it back
+   * and forth (corner of a G0 chain) and at the ends of the chain.
+   */
+  bool
+  ClothoidFrenet::localProject( valueType   x,
+                                valueType   y,
+                                indexType & i,
+                                valueType & s ) const {
+    indexType n    = indexType(evals.size()) ;
+    indexType move = 0 ; // last change of curve
+    for ( indexType iter = 0 ; iter < max_iter ; ++iter ) {
+      ClothoidEvaluator const & e = evals[i] ;
+      valueType th, kappa, px, py ;
+      e.eval( s, th, kappa, px, py ) ;
+      valueType tx = cos(th), ty = sin(th) ;
+      valueType dx = x-px, dy = y-py ;
+      valueType g  = dx*tx + dy*ty ;
+      valueType h  = 1 - kappa*(dy*tx-dx*ty) ;
+      if ( !(h > 0) ) return false ; // beyond the center of curvature
+      valueType ds = g/h ;
+      valueType sn = s+ds ;
+      if ( sn > e.getSmax() ) {
+        if ( s == e.getSmax() && ( i+1 == n || move < 0 ) ) return true ;
+        if ( i+1 == n || move < 0 ) { s = e.getSmax() ; continue ; }
+        s = evals[++i].getSmin() + (sn-e.getSmax()) ;
+        move = 1 ;
+      } else if ( sn < e.getSmin() ) {
+        if ( s == e.getSmin() && ( i == 0 || move > 0 ) ) return true ;
+        if ( i == 0 || move > 0 ) { s = e.getSmin() ; continue ; }
+        s = evals[--i].getSmax() - (e.getSmin()-sn) ;
+        move = -1 ;
+      } else {
+        s = sn ;
+        if ( std::abs(ds) <= tolerance ) return true ;
+      }
+    }
+    return false ;
+  }
+
+  // ---------------------------------------------------------------------------
+
+  static
+  inline
+  valueType
+  rootDistance( ClothoidBVH const & B, valueType x, valueType y ) {
+    ClothoidBVH::Node const & n = B.getNode(0) ;
+    valueType dx = max( valueType(0), max( n.xmin-x, x-n.xmax ) ) ;
+    valueType dy = max( valueType(0), max( n.ymin-y, y-n.ymax ) ) ;
+    return hypot( dx, dy ) ;
+  }
+
+  void
+  ClothoidFrenet::globalProject( valueType   x,
+                                 valueType   y,
+                                 indexType & i,
+                                 valueType & s ) {
+    if ( trees.empty() ) {
+      trees.resize( curves.size() ) ;
+      for ( size_t k = 0 ; k < curves.size() ; ++k )
+        trees[k].build( curves[k], 0, FRENET_SPLIT_ANGLE,
+                        curves[k].getSmax()-curves[k].getSmin() ) ;
+    }
+    // visit the curves in order of distance of their box
+    vector<pair<valueType,indexType> > order ;
+    order.reserve( trees.size() ) ;
+    for ( size_t k = 0 ; k < trees.size() ; ++k )
+      if ( trees[k].numNodes() > 0 )
+        order.push_back( pair<valueType,indexType>( rootDistance( trees[k], x, y ), indexType(k) ) ) ;
+    sort( order.begin(), order.end() ) ;
+    valueType best = HUGE_VAL ;
+    i = 0 ;
+    s = curves[0].getSmin() ;
+    for ( size_t k = 0 ; k < order.size() && order[k].first < best ; ++k ) {
+      valueType sk ;
+      valueType dk = trees[order[k].second].project( x, y, sk, tolerance ) ;
+      if ( dk < best ) { best = dk ; i = order[k].second ; s = sk ; }
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+
+  void
+  ClothoidFrenet::frenet( indexType   i,
+                          valueType   s,
+                          valueType   x,
+                          valueType   y,
+                          valueType & sc,
+                          valueType & d,
+                          valueType & dist ) const {
+    ClothoidEvaluator const & e = evals[i] ;
+    valueType th, kappa, px, py ;
+    e.eval( s, th, kappa, px, py ) ;
+    valueType tx = cos(th), ty = sin(th) ;
+    valueType dx = x-px, dy = y-py ;
+    valueType g  = dx*tx + dy*ty ;
+    d    = dy*tx - dx*ty ;
+    dist = hypot( dx, dy ) ;
+    sc   = s0[i] + s - e.getSmin() ;
+    // tangent extension beyond the ends of the chain
+    if ( ( g > 0 && i+1 == indexType(evals.size()) && s >= e.getSmax() ) ||
+         ( g < 0 && i == 0 && s <= e.getSmin() ) ) sc += g ;
+  }
+
+  // ---------------------------------------------------------------------------
+
+  void
+  ClothoidFrenet::toFrenet( valueType   x,
+                            valueType   y,
+                            valueType & s,
+                            valueType & d ) {
+    indexType i    = i_last ;
+    valueType sl   = s_last ;
+    valueType dist = 0 ;
+    bool      ok   = false ;
+    if ( warm && localProject( x, y, i, sl ) ) {
+      frenet( i, sl, x, y, s, d, dist ) ;
+      // the distance from the path is 1-Lipschitz
+      valueType bound = dist_last + hypot( x-x_last, y-y_last ) ;
+      ok = dist <= bound + tolerance*(1+bound) ;
+    }
+    if ( ok ) {
+      ++n_local ;
+    } else {
+      globalProject( x, y, i, sl ) ;
+      frenet( i, sl, x, y, s, d, dist ) ;
+      ++n_global ;
+    }
+    warm      = true ;
+    i_last    = i ;
+    s_last    = sl ;
+    x_last    = x ;
+    y_last    = y ;
+    dist_last = dist ;
+  }
+
+  // ---------------------------------------------------------------------------
+
+  void
+  ClothoidFrenet::toFrenet( indexType       n,
+                            valueType const x[],
+                            valueType const y[],
+                            valueType       s[],
+                            valueType       d[] ) {
+    for ( indexType k = 0 ; k < n ; ++k )
+      toFrenet( x[k], y[k], s[k], d[k] ) ;
+  }
+
+  // ---------------------------------------------------------------------------
+
+  void
+  ClothoidFrenet::toCartesian( valueType   s,
+                               valueType   d,
+                               valueType & x,
+                               valueType & y ) const {
+    indexType n = indexType(evals.size()) ;
+    indexType i = indexType( upper_bound( s0.begin(), s0.end(), s ) - s0.begin() ) - 1 ;
+    if      ( i < 0  ) i = 0 ;
+    else if ( i >= n ) i = n-1 ;
+    ClothoidEvaluator const & e = evals[i] ;
+    valueType sl = e.getSmin() + s - s0[i] ;
+    if ( sl >= e.getSmin() && sl <= e.getSmax() ) {
+      e.eval( sl, d, x, y ) ;
+    } else { // tangent extension beyond the ends of the chain
+      valueType se = sl < e.getSmin() ? e.getSmin() : e.getSmax() ;
+      valueType th, kappa, px, py ;
+      e.eval( se, th, kappa, px, py ) ;
+      valueType tx = cos(th), ty = sin(th) ;
+      x = px + (sl-se)*tx - d*ty ;
+      y = py + (sl-se)*ty + d*tx ;
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+
+  void
+  ClothoidFrenet::toCartesian( indexType       n,
+                               valueType const s[],
+                               valueType const d[],
+                               valueType       x[],
+                               valueType       y[] ) const {
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for ( indexType k = 0 ; k < n ; ++k )
+      toCartesian( s[k], d[k], x[k], y[k] ) ;
+  }
+
+}
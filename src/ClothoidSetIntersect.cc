@@ -0,0 +1,382 @@
+/*--------------------------------------------------------------------------*\
+ |                                                                          |
+ |  Copyright (C) 2016                                                      |
+ |                                                                          |
+ |         , __                 , __                                        |
+ |        /|/  \               /|/  \                                       |
+ |         | __/ _   ,_         | __/ _   ,_                                | 
+ |         |   \|/  /  |  |   | |   \|/  /  |  |   |                        |
+ |         |(__/|__/   |_/ \_/|/|(__/|__/   |_/ \_/|/                       |
+ |                           /|                   /|                        |
+ |                           \|                   \|                        |
+ |                                                                          |
+ |      Enrico Bertolazzi                                                   |
+ |      Dipartimento di Ingegneria Industriale                              |
+ |      Universita` degli Studi di Trento                                   |
+ |      email: enrico.bertolazzi@unitn.it                                   |
+ |                                                                          |
+\*--------------------------------------------------------------------------*/
+
+#include "Clothoid.hh"
+
+#include <cmath>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+
+#ifndef CLOTHOID_ASSERT
+  #define CLOTHOID_ASSERT(COND,MSG)         \
+    if ( !(COND) ) {                        \
+      std::ostringstream ost ;              \
+      ost << "On line: " << __LINE__        \
+          << " file: " << __FILE__          \
+          << '\n' << MSG << '\n' ;          \
+      throw std::runtime_error(ost.str()) ; \
+    }
+#endif
+
+namespace Clothoid {
+
+  using namespace std ;
+
+  static const valueType m_pi = 3.14159265358979323846264338328 ; // pi
+
+  //! \cond NODOC
+
+  // the grid is used if no triangle box is larger than this times the mean
+  static valueType const GRID_MAX_RATIO = 8 ;
+
+  // box of the triangle of a leaf, leaves of the same curve are contiguous
+  class LeafBox {
+  public:
+    valueType xmin, ymin, xmax, ymax ;
+    indexType curve ;
+
+    valueType size() const { return max( xmax-xmin, ymax-ymin ) ; }
+
+    bool
+    overlap( LeafBox const & b ) const {
+      return xmin <= b.xmax && b.xmin <= xmax &&
+             ymin <= b.ymax && b.ymin <= ymax ;
+    }
+  } ;
+
+  // candidate pair: leaf `li` of curve `ci` and leaf `lj` of curve `cj`,
+  // `li` and `lj` are -1 for a pair solved by ClothoidCurve::intersect
+  class LeafPair {
+  public:
+    indexType ci, cj, li, lj ;
+
+    LeafPair( indexType _ci, indexType _cj, indexType _li, indexType _lj )
+    : ci(_ci), cj(_cj), li(_li), lj(_lj)
+    {}
+
+    bool
+    operator < ( LeafPair const & p ) const {
+      if ( ci != p.ci ) return ci < p.ci ;
+      if ( cj != p.cj ) return cj < p.cj ;
+      if ( li != p.li ) return li < p.li ;
+      return lj < p.lj ;
+    }
+  } ;
+
+  // node of the hierarchy of the boxes perm[begin..end-1]
+  class LeafNode {
+  public:
+    LeafBox   box ;
+    indexType begin, end ;
+    indexType child ; // -1 for a leaf
+  } ;
+
+  static
+  void
+  addPair( vector<LeafBox>    const & box,
+           vector<Triangle2D> const & tri,
+           indexType                  la,
+           indexType                  lb,
+           vector<LeafPair>         & pairs ) {
+    if ( la > lb ) swap( la, lb ) ;
+    if ( tri[la].overlap( tri[lb] ) )
+      pairs.push_back( LeafPair( box[la].curve, box[lb].curve, la, lb ) ) ;
+  }
+
+  /*
+   * Uniform grid with cells of size twice the mean box, a pair of boxes
+   * is tested only in the cell containing the lower left corner of the
+   * intersection of the boxes, so that it is found once.
+   */
+  static
+  void
+  gridPairs( vector<LeafBox>    const & box,
+             vector<Triangle2D> const & tri,
+             valueType                  mean_size,
+             vector<LeafPair>         & pairs ) {
+    indexType n  = indexType(box.size()) ;
+    valueType X0 = box[0].xmin, Y0 = box[0].ymin ;
+    valueType X1 = box[0].xmax, Y1 = box[0].ymax ;
+    for ( indexType i = 1 ; i < n ; ++i ) {
+      X0 = min( X0, box[i].xmin ) ; X1 = max( X1, box[i].xmax ) ;
+      Y0 = min( Y0, box[i].ymin ) ; Y1 = max( Y1, box[i].ymax ) ;
+    }
+    valueType h = 2*mean_size ;
+    if ( !(h > 0) ) h = max( max( X1-X0, Y1-Y0 ), valueType(1) ) ;
+    // at most 4 cells per box
+    while ( ((X1-X0)/h+1)*((Y1-Y0)/h+1) > 4.0*n ) h *= 2 ;
+    indexType nx = indexType((X1-X0)/h)+1 ;
+    indexType ny = indexType((Y1-Y0)/h)+1 ;
+
+    // cells of the boxes in compressed row storage
+    vector<indexType> start( size_t(nx*ny+1), 0 ), item ;
+    for ( int pass = 0 ; pass < 2 ; ++pass ) {
+      for ( indexType i = 0 ; i < n ; ++i ) {
+        LeafBox const & b = box[i] ;
+        indexType ix0 = min( nx-1, indexType((b.xmin-X0)/h) ) ;
+        indexType ix1 = min( nx-1, indexType((b.xmax-X0)/h) ) ;
+        indexType iy0 = min( ny-1, indexType((b.ymin-Y0)/h) ) ;
+        indexType iy1 = min( ny-1, indexType((b.ymax-Y0)/h) ) ;
+        for ( indexType iy = iy0 ; iy <= iy1 ; ++iy )
+          for ( indexType ix = ix0 ; ix <= ix1 ; ++ix )
+            if ( pass == 0 ) ++start[iy*nx+ix+1] ;
+            else             item[start[iy*nx+ix]++] = i ;
+      }
+      if ( pass == 0 ) {
+        for ( indexType k = 0 ; k < nx*ny ; ++k ) start[k+1] += start[k] ;
+        item.resize( size_t(start[nx*ny]) ) ;
+      } else {
+        // start[k] is now the end of cell k
+        for ( indexType k = nx*ny ; k > 0 ; --k ) start[k] = start[k-1] ;
+        start[0] = 0 ;
+      }
+    }
+
+    for ( indexType iy = 0 ; iy < ny ; ++iy ) {
+      for ( indexType ix = 0 ; ix < nx ; ++ix ) {
+        indexType cell = iy*nx+ix ;
+        for ( indexType a = start[cell] ; a < start[cell+1] ; ++a ) {
+          LeafBox const & A = box[item[a]] ;
+          for ( indexType b = a+1 ; b < start[cell+1] ; ++b ) {
+            LeafBox const & B = box[item[b]] ;
+            if ( A.curve == B.curve || !A.overlap(B) ) continue ;
+            indexType jx = min( nx-1, indexType((max(A.xmin,B.xmin)-X0)/h) ) ;
+            indexType jy = min( ny-1, indexType((max(A.ymin,B.ymin)-Y0)/h) ) ;
+            if ( jx != ix || jy != iy ) continue ;
+            addPair( box, tri, item[a], item[b], pairs ) ;
+          }
+        }
+      }
+    }
+  }
+
+  // order of the boxes by center along x or y
+  class LeafCenterLess {
+    vector<LeafBox> const & box ;
+    bool                    xsplit ;
+  public:
+    LeafCenterLess( vector<LeafBox> const & _box, bool _xsplit )
+    : box(_box), xsplit(_xsplit)
+    {}
+
+    bool
+    operator () ( indexType a, indexType b ) const {
+      if ( xsplit ) return box[a].xmin+box[a].xmax < box[b].xmin+box[b].xmax ;
+      else          return box[a].ymin+box[a].ymax < box[b].ymin+box[b].ymax ;
+    }
+  } ;
+
+  static
+  void
+  bvhBuild( vector<LeafBox> const & box,
+            vector<indexType>     & perm,
+            vector<LeafNode>      & nodes,
+            indexType               inode,
+            indexType               begin,
+            indexType               end ) {
+    LeafBox bb = box[perm[begin]] ;
+    for ( indexType k = begin+1 ; k < end ; ++k ) {
+      LeafBox const & b = box[perm[k]] ;
+      bb.xmin = min( bb.xmin, b.xmin ) ; bb.xmax = max( bb.xmax, b.xmax ) ;
+      bb.ymin = min( bb.ymin, b.ymin ) ; bb.ymax = max( bb.ymax, b.ymax ) ;
+    }
+    nodes[inode].box   = bb ;
+    nodes[inode].begin = begin ;
+    nodes[inode].end   = end ;
+    nodes[inode].child = -1 ;
+    if ( end - begin == 1 ) return ;
+    // median split along the longest side
+    bool      xsplit = bb.xmax-bb.xmin >= bb.ymax-bb.ymin ;
+    indexType mid    = (begin+end)/2 ;
+    nth_element( perm.begin()+begin, perm.begin()+mid, perm.begin()+end,
+                 LeafCenterLess( box, xsplit ) ) ;
+    indexType ic = indexType(nodes.size()) ;
+    nodes[inode].child = ic ;
+    nodes.resize( nodes.size()+2 ) ;
+    bvhBuild( box, perm, nodes, ic,   begin, mid ) ;
+    bvhBuild( box, perm, nodes, ic+1, mid,   end ) ;
+  }
+
+  // self descent of the hierarchy
+  static
+  void
+  bvhPairs( vector<LeafBox>    const & box,
+            vector<Triangle2D> const & tri,
+            vector<LeafPair>         & pairs ) {
+    indexType n = indexType(box.size()) ;
+    vector<indexType> perm( n ) ;
+    for ( indexType i = 0 ; i < n ; ++i ) perm[i] = i ;
+    vector<LeafNode> nodes ;
+    nodes.reserve( size_t(2*n-1) ) ;
+    nodes.resize(1) ;
+    bvhBuild( box, perm, nodes, 0, 0, n ) ;
+
+    vector<pair<indexType,indexType> > stack ;
+    stack.push_back( pair<indexType,indexType>(0,0) ) ;
+    while ( !stack.empty() ) {
+      indexType ia = stack.back().first ;
+      indexType ib = stack.back().second ;
+      stack.pop_back() ;
+      LeafNode const & na = nodes[ia] ;
+      LeafNode const & nb = nodes[ib] ;
+      if ( ia == ib ) {
+        if ( na.child < 0 ) continue ;
+        stack.push_back( pair<indexType,indexType>(na.child,na.child) ) ;
+        stack.push_back( pair<indexType,indexType>(na.child+1,na.child+1) ) ;
+        stack.push_back( pair<indexType,indexType>(na.child,na.child+1) ) ;
+      } else if ( na.box.overlap( nb.box ) ) {
+        if ( na.child < 0 && nb.child < 0 ) {
+          indexType la = perm[na.begin] ;
+          indexType lb = perm[nb.begin] ;
+          if ( box[la].curve != box[lb].curve ) addPair( box, tri, la, lb, pairs ) ;
+        } else if ( nb.child < 0 || ( na.child >= 0 && na.box.size() >= nb.box.size() ) ) {
+          stack.push_back( pair<indexType,indexType>(na.child,ib) ) ;
+          stack.push_back( pair<indexType,indexType>(na.child+1,ib) ) ;
+        } else {
+          stack.push_back( pair<indexType,indexType>(ia,nb.child) ) ;
+          stack.push_back( pair<indexType,indexType>(ia,nb.child+1) ) ;
+        }
+      }
+    }
+  }
+
+  //! \endcond
+
+  // ---------------------------------------------------------------------------
+
+  void
+  ClothoidSetIntersect::intersect( vector<ClothoidCurve> const & c,
+                                   vector<valueType>     const & offs,
+                                   vector<Point>               & res,
+                                   indexType                     max_iter,
+                                   valueType                     tolerance ) {
+    CLOTHOID_ASSERT( offs.empty() || offs.size() == c.size(),
+                     "ClothoidSetIntersect::intersect, " << offs.size() <<
+                     " offsets for " << c.size() << " curves" ) ;
+    indexType nc = indexType(c.size()) ;
+    res.clear() ;
+    grid_used    = false ;
+    n_leaves     = 0 ;
+    n_candidates = 0 ;
+
+    // split the curves as in ClothoidCurve::intersect
+    vector<ClothoidCurve> leaf, cs ;
+    vector<Triangle2D>    tri, ts ;
+    vector<LeafBox>       box ;
+    valueType mean_size = 0, max_size = 0 ;
+    for ( indexType i = 0 ; i < nc ; ++i ) {
+      ClothoidCurve const & ci = c[i] ;
+      ci.bbSplit( m_pi/50, (ci.s_max-ci.s_min)/3, offs.empty() ? 0 : offs[i], cs, ts ) ;
+      leaf.insert( leaf.end(), cs.begin(), cs.end() ) ;
+      tri.insert( tri.end(), ts.begin(), ts.end() ) ;
+      for ( size_t k = 0 ; k < ts.size() ; ++k ) {
+        Triangle2D const & t = ts[k] ;
+        LeafBox b ;
+        b.xmin  = min( t.x1(), min( t.x2(), t.x3() ) ) ;
+        b.ymin  = min( t.y1(), min( t.y2(), t.y3() ) ) ;
+        b.xmax  = max( t.x1(), max( t.x2(), t.x3() ) ) ;
+        b.ymax  = max( t.y1(), max( t.y2(), t.y3() ) ) ;
+        b.curve = i ;
+        box.push_back( b ) ;
+        mean_size += b.size() ;
+        max_size   = max( max_size, b.size() ) ;
+      }
+    }
+    n_leaves = indexType(box.size()) ;
+    if ( n_leaves == 0 ) return ;
+    mean_size /= n_leaves ;
+
+    // candidate pairs of triangles of different curves
+    vector<LeafPair> pairs ;
+    if ( index == INDEX_GRID || ( index == INDEX_AUTO && max_size <= GRID_MAX_RATIO*mean_size ) ) {
+      grid_used = true ;
+      gridPairs( box, tri, mean_size, pairs ) ;
+    } else {
+      bvhPairs( box, tri, pairs ) ;
+    }
+    sort( pairs.begin(), pairs.end() ) ;
+    n_candidates = indexType(pairs.size()) ;
+
+    // pairs of segments and circle arcs are solved once by ClothoidCurve::intersect
+    vector<LeafPair> tasks ;
+    for ( size_t k = 0 ; k < pairs.size() ; ++k ) {
+      LeafPair const & p = pairs[k] ;
+      if ( c[p.ci].dk == 0 && c[p.cj].dk == 0 ) {
+        if ( tasks.empty() || tasks.back().li >= 0 ||
+             tasks.back().ci != p.ci || tasks.back().cj != p.cj )
+          tasks.push_back( LeafPair( p.ci, p.cj, -1, -1 ) ) ;
+      } else {
+        tasks.push_back( p ) ;
+      }
+    }
+
+    // refinement, the results are stored by task and merged in order
+    indexType                  nt = indexType(tasks.size()) ;
+    vector<valueType>          s1( nt ), s2( nt ) ;
+    vector<char>               ok( nt, 0 ) ;
+    vector<vector<valueType> > ps1( nt ), ps2( nt ) ;
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic,16)
+    #endif
+    for ( indexType k = 0 ; k < nt ; ++k ) {
+      LeafPair const & t  = tasks[k] ;
+      valueType        oi = offs.empty() ? 0 : offs[t.ci] ;
+      valueType        oj = offs.empty() ? 0 : offs[t.cj] ;
+      if ( t.li < 0 ) {
+        c[t.ci].intersect( oi, c[t.cj], oj, ps1[k], ps2[k], max_iter, tolerance,
+                           ClothoidCurve::SPLIT_FIXED ) ;
+      } else {
+        ClothoidCurve c0( leaf[t.li] ), c1( leaf[t.lj] ) ;
+        indexType     n_eval ;
+        ok[k] = c[t.ci].intersect_internal( c0, oi, s1[k], c0.s_max >= c[t.ci].s_max,
+                                            c1, oj, s2[k], c1.s_max >= c[t.cj].s_max,
+                                            max_iter, tolerance,
+                                            0, 0, n_eval ) ;
+      }
+    }
+    // roots of the current pair of curves, a root on the common end of
+    // two leaves is kept once
+    vector<valueType> r1, r2 ;
+    for ( indexType k = 0 ; k < nt ; ++k ) {
+      Point P ;
+      P.i = tasks[k].ci ;
+      P.j = tasks[k].cj ;
+      if ( k == 0 || tasks[k-1].ci != P.i || tasks[k-1].cj != P.j ) {
+        r1.clear() ;
+        r2.clear() ;
+      }
+      if ( tasks[k].li < 0 ) {
+        for ( size_t l = 0 ; l < ps1[k].size() ; ++l ) {
+          P.s_i = ps1[k][l] ;
+          P.s_j = ps2[k][l] ;
+          res.push_back( P ) ;
+        }
+      } else if ( ok[k] ) {
+        size_t nr = r1.size() ;
+        ClothoidCurve::pushRoot( s1[k], s2[k], tolerance, r1, r2 ) ;
+        if ( r1.size() == nr ) continue ;
+        P.s_i = s1[k] ;
+        P.s_j = s2[k] ;
+        res.push_back( P ) ;
+      }
+    }
+  }
+
+}
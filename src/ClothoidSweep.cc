@@ -0,0 +1,918 @@
+/*--------------------------------------------------------------------------*\
+ |                                                                          |
+ |  Copyright (C) 2016                                                      |
+ |                                                                          |
+ |         , __                 , __                                        |
+ |        /|/  \               /|/  \                                       |
+ |         | __/ _   ,_         | __/ _   ,_                                | 
+ |         |   \|/  /  |  |   | |   \|/  /  |  |   |                        |
+ |         |(__/|__/   |_/ \_/|/|(__/|__/   |_/ \_/|/                       |
+ |                           /|                   /|                        |
+ |                           \|                   \|                        |
+ |                                                                          |
+ |      Enrico Bertolazzi                                                   |
+ |      Dipartimento di Ingegneria Industriale                              |
+ |      Universita` degli Studi di Trento                                   |
+ |      email: enrico.bertolazzi@unitn.it                                   |
+ |                                                                          |
+\*--------------------------------------------------------------------------*/
+
+#include "Clothoid.hh"
+
+#include <cmath>
+#include <ctime>
+#include <sstream>
+#include <stdexcept>
+#include <algorithm>
+
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+#ifndef CLOTHOID_ASSERT
+  #define CLOTHOID_ASSERT(COND,MSG)         \
+    if ( !(COND) ) {                        \
+      std::ostringstream ost ;              \
+      ost << "On line: " << __LINE__        \
+          << " file: " << __FILE__          \
+          << '\n' << MSG << '\n' ;          \
+      throw std::runtime_error(ost.str()) ; \
+    }
+#endif
+
+namespace Clothoid {
+
+  using namespace std ;
+
+  static const valueType m_pi = 3.14159265358979323846264338328 ; // pi
+
+  // maximum depth of the bisection of a piece of the band
+  static const indexType SWEEP_MAX_DEPTH = 64 ;
+
+  // maximum heading variation of a piece of ClothoidRaster, margin of the cells
+  static const valueType RASTER_MAX_ANGLE = m_pi/8 ;
+  static const valueType RASTER_MARGIN    = 1e-9 ;
+
+  // rows of the grid filled by a thread at once
+  static const indexType RASTER_STRIPE = 16 ;
+
+  // side of the tiles of ClothoidDistanceField in cells
+  static const indexType FIELD_TILE = 64 ;
+
+  //! \cond NODOC
+
+  // elapsed time in seconds, the cpu time would sum the threads
+  static
+  inline
+  valueType
+  wallTime() {
+    #ifdef _OPENMP
+    return omp_get_wtime() ;
+    #else
+    return valueType(clock())/CLOCKS_PER_SEC ;
+    #endif
+  }
+
+  /*
+   * Separating axis test of convex polygons, a polygon of two vertices
+   * is a segment and is tested also along its direction.
+   */
+
+  static
+  inline
+  bool
+  separatedAlong( valueType nx, valueType ny,
+                  valueType const ax[], valueType const ay[], indexType na,
+                  valueType const bx[], valueType const by[], indexType nb ) {
+    valueType amin = HUGE_VAL, amax = -HUGE_VAL ;
+    valueType bmin = HUGE_VAL, bmax = -HUGE_VAL ;
+    for ( indexType i = 0 ; i < na ; ++i ) {
+      valueType p = nx*ax[i] + ny*ay[i] ;
+      if ( p < amin ) amin = p ;
+      if ( p > amax ) amax = p ;
+    }
+    for ( indexType i = 0 ; i < nb ; ++i ) {
+      valueType p = nx*bx[i] + ny*by[i] ;
+      if ( p < bmin ) bmin = p ;
+      if ( p > bmax ) bmax = p ;
+    }
+    return amax < bmin || bmax < amin ;
+  }
+
+  // true if an edge of `a` separates the two polygons
+  static
+  bool
+  separatedBy( valueType const ax[], valueType const ay[], indexType na,
+               valueType const bx[], valueType const by[], indexType nb ) {
+    for ( indexType i = 0 ; i < na ; ++i ) {
+      indexType j  = i+1 < na ? i+1 : 0 ;
+      valueType ex = ax[j]-ax[i] ;
+      valueType ey = ay[j]-ay[i] ;
+      if ( ex == 0 && ey == 0 ) continue ;
+      if ( separatedAlong( ey, -ex, ax, ay, na, bx, by, nb ) ) return true ;
+      if ( na == 2 && separatedAlong( ex, ey, ax, ay, na, bx, by, nb ) ) return true ;
+    }
+    return false ;
+  }
+
+  static
+  inline
+  bool
+  convexOverlap( valueType const ax[], valueType const ay[], indexType na,
+                 valueType const bx[], valueType const by[], indexType nb ) {
+    return !separatedBy( ax, ay, na, bx, by, nb ) &&
+           !separatedBy( bx, by, nb, ax, ay, na ) ;
+  }
+
+  // convex hull of at most 8 points (monotone chain), counterclockwise
+  static
+  indexType
+  convexHull( valueType x[], valueType y[], indexType n,
+              valueType hx[], valueType hy[] ) {
+    // insertion sort by (x,y)
+    for ( indexType i = 1 ; i < n ; ++i ) {
+      valueType xi = x[i], yi = y[i] ;
+      indexType j = i ;
+      for ( ; j > 0 && ( x[j-1] > xi || ( x[j-1] == xi && y[j-1] > yi ) ) ; --j ) {
+        x[j] = x[j-1] ; y[j] = y[j-1] ;
+      }
+      x[j] = xi ; y[j] = yi ;
+    }
+    if ( n < 3 ) {
+      for ( indexType i = 0 ; i < n ; ++i ) { hx[i] = x[i] ; hy[i] = y[i] ; }
+      return n ;
+    }
+    indexType k = 0 ;
+    for ( indexType i = 0 ; i < n ; ++i ) { // lower hull
+      while ( k >= 2 && (hx[k-1]-hx[k-2])*(y[i]-hy[k-2])-(hy[k-1]-hy[k-2])*(x[i]-hx[k-2]) <= 0 ) --k ;
+      hx[k] = x[i] ; hy[k] = y[i] ; ++k ;
+    }
+    for ( indexType i = n-2, t = k+1 ; i >= 0 ; --i ) { // upper hull
+      while ( k >= t && (hx[k-1]-hx[k-2])*(y[i]-hy[k-2])-(hy[k-1]-hy[k-2])*(x[i]-hx[k-2]) <= 0 ) --k ;
+      hx[k] = x[i] ; hy[k] = y[i] ; ++k ;
+    }
+    return k > 1 ? k-1 : k ; // the last point is the first
+  }
+
+  // point of the reference curve with heading and curvature
+  class SweepPoint {
+  public:
+    valueType s, x, y, theta, tx, ty, kappa ;
+  } ;
+
+  static
+  inline
+  void
+  sweepEval( ClothoidEvaluator const & e, valueType s, SweepPoint & P ) {
+    P.s = s ;
+    e.eval( s, P.theta, P.kappa, P.x, P.y ) ;
+    P.tx = cos(P.theta) ;
+    P.ty = sin(P.theta) ;
+  }
+
+  /*
+   * Convex polygon containing the band between A and B: hull of the
+   * triangles of `ClothoidCurve::bbTriangle` of the two border curves,
+   * a square around the middle of the end points when a border curve has
+   * a cusp or the heading varies too much.
+   */
+  static
+  indexType
+  bandHull( SweepPoint const & A, SweepPoint const & B,
+            valueType omin, valueType omax,
+            valueType hx[], valueType hy[] ) {
+    valueType dtheta = std::abs( B.theta-A.theta ) ;
+    if ( dtheta < m_pi/2 &&
+         1-omin*A.kappa > 0 && 1-omin*B.kappa > 0 &&
+         1-omax*A.kappa > 0 && 1-omax*B.kappa > 0 ) {
+      bool      small = dtheta <= 0.0001 * m_pi/2 ;
+      valueType det   = B.tx*A.ty-A.tx*B.ty ;
+      valueType o[2]  = { omin, omax } ;
+      valueType x[6], y[6] ;
+      for ( indexType j = 0 ; j < 2 ; ++j ) {
+        x[3*j]   = A.x - o[j]*A.ty ; y[3*j]   = A.y + o[j]*A.tx ;
+        x[3*j+1] = B.x - o[j]*B.ty ; y[3*j+1] = B.y + o[j]*B.tx ;
+        valueType alpha = small ? B.s-A.s
+                                : ((y[3*j+1]-y[3*j])*B.tx - (x[3*j+1]-x[3*j])*B.ty)/det ;
+        x[3*j+2] = x[3*j] + alpha*A.tx ;
+        y[3*j+2] = y[3*j] + alpha*A.ty ;
+      }
+      return convexHull( x, y, 6, hx, hy ) ;
+    }
+    // the curve is in the disk of radius (B.s-A.s)/2 centered between A and B
+    valueType xm = (A.x+B.x)/2, ym = (A.y+B.y)/2 ;
+    valueType r  = (B.s-A.s)/2 + max( std::abs(omin), std::abs(omax) ) ;
+    hx[0] = xm-r ; hy[0] = ym-r ;
+    hx[1] = xm+r ; hy[1] = ym-r ;
+    hx[2] = xm+r ; hy[2] = ym+r ;
+    hx[3] = xm-r ; hy[3] = ym+r ;
+    return 4 ;
+  }
+
+  static
+  inline
+  BBox2D
+  hullBox( valueType const hx[], valueType const hy[], indexType n ) {
+    BBox2D b( hx[0], hy[0], hx[0], hy[0] ) ;
+    for ( indexType i = 1 ; i < n ; ++i ) {
+      b.xmin = min( b.xmin, hx[i] ) ; b.xmax = max( b.xmax, hx[i] ) ;
+      b.ymin = min( b.ymin, hy[i] ) ; b.ymax = max( b.ymax, hy[i] ) ;
+    }
+    return b ;
+  }
+
+  // compare the centers of the boxes along an axis
+  class BoxCenterLess {
+    vector<BBox2D> const & box ;
+    bool                   along_x ;
+  public:
+    BoxCenterLess( vector<BBox2D> const & b, bool x ) : box(b), along_x(x) {}
+    bool
+    operator () ( indexType i, indexType j ) const {
+      if ( along_x ) return box[i].xmin+box[i].xmax < box[j].xmin+box[j].xmax ;
+      else           return box[i].ymin+box[i].ymax < box[j].ymin+box[j].ymax ;
+    }
+  } ;
+
+  // piece of the band, node of the hierarchy of the pieces
+  class SweepNode {
+  public:
+    BBox2D     box ;
+    SweepPoint A, B ;
+    indexType  child ; // -1 for a leaf
+  } ;
+
+  static
+  void
+  buildSweepTree( vector<SweepNode> & tree,
+                  vector<SweepNode> const & leaves,
+                  indexType inode, indexType i_begin, indexType i_end ) {
+    if ( i_end - i_begin == 1 ) {
+      tree[inode] = leaves[i_begin] ;
+      return ;
+    }
+    indexType ic  = indexType(tree.size()) ;
+    indexType mid = (i_begin+i_end)/2 ;
+    tree.resize( tree.size()+2 ) ;
+    buildSweepTree( tree, leaves, ic,   i_begin, mid ) ;
+    buildSweepTree( tree, leaves, ic+1, mid,     i_end ) ;
+    SweepNode       & node = tree[inode] ;
+    SweepNode const & L    = tree[ic] ;
+    SweepNode const & R    = tree[ic+1] ;
+    node.A     = L.A ;
+    node.B     = R.B ;
+    node.child = ic ;
+    node.box   = BBox2D( min( L.box.xmin, R.box.xmin ), min( L.box.ymin, R.box.ymin ),
+                         max( L.box.xmax, R.box.xmax ), max( L.box.ymax, R.box.ymax ) ) ;
+  }
+
+  // convex polygon covering a piece of a band and its box
+  class RasterHull {
+  public:
+    valueType x[8], y[8] ;
+    indexType n ;
+    BBox2D    box ;
+  } ;
+
+  /*
+   * Hulls covering the band of `c`: the curve is split at the inflection
+   * and walked with step L such that L^2*kappa_max <= h/2 (|kappa| is
+   * bounded by its values at the ends of the step, kappa is linear) and
+   * the heading varies less than RASTER_MAX_ANGLE.
+   */
+  static
+  void
+  rasterHulls( ClothoidCurve const & c,
+               valueType             omin,
+               valueType             omax,
+               valueType             h,
+               vector<RasterHull>  & hulls ) {
+    ClothoidEvaluator e( c ) ;
+    valueType brk[3] ;
+    indexType nbrk = 0 ;
+    brk[nbrk++] = c.getSmin() ;
+    if ( c.getKappa_D() != 0 ) {
+      valueType s_flex = -c.getKappa()/c.getKappa_D() ;
+      if ( s_flex > c.getSmin() && s_flex < c.getSmax() ) brk[nbrk++] = s_flex ;
+    }
+    brk[nbrk++] = c.getSmax() ;
+    SweepPoint A, B ;
+    sweepEval( e, c.getSmin(), A ) ;
+    for ( indexType k = 0 ; k+1 < nbrk ; ++k ) {
+      valueType v = brk[k+1] ;
+      while ( A.s < v ) {
+        valueType L = v-A.s ;
+        for ( indexType iter = 0 ; iter < 2 ; ++iter ) {
+          valueType kmax = max( std::abs(e.theta_D(A.s)), std::abs(e.theta_D(A.s+L)) ) ;
+          if ( kmax*L*L <= h/2 && kmax*L <= RASTER_MAX_ANGLE ) break ;
+          L = min( sqrt( h/(2*kmax) ), RASTER_MAX_ANGLE/kmax ) ;
+        }
+        sweepEval( e, A.s+L < v ? A.s+L : v, B ) ;
+        RasterHull H ;
+        H.n   = bandHull( A, B, omin, omax, H.x, H.y ) ;
+        H.box = hullBox( H.x, H.y, H.n ) ;
+        hulls.push_back( H ) ;
+        A = B ;
+      }
+    }
+  }
+
+  // cell index of the coordinate t, clamped to [-1,n]
+  static
+  inline
+  indexType
+  cellIndex( valueType t, valueType t0, valueType h, indexType n ) {
+    valueType i = floor( (t-t0)/h ) ;
+    if ( i < 0 ) return -1 ;
+    if ( i > n ) return n ;
+    return indexType(i) ;
+  }
+
+  /*
+   * Set the cells of the window [i_begin,i_end) x [j_begin,j_end) of the
+   * grid touched by the hull, the cell (i,j) is
+   * win[(i-i_begin)+(j-j_begin)*stride].
+   */
+  static
+  void
+  fillHull( RasterHull const & H,
+            valueType x0, valueType y0, valueType h,
+            indexType i_begin, indexType i_end,
+            indexType j_begin, indexType j_end,
+            unsigned char win[], indexType stride,
+            unsigned char value ) {
+    valueType eps = RASTER_MARGIN*h ;
+    indexType j0  = max( j_begin, cellIndex( H.box.ymin-eps, y0, h, j_end ) ) ;
+    indexType j1  = min( j_end-1, cellIndex( H.box.ymax+eps, y0, h, j_end ) ) ;
+    for ( indexType j = j0 ; j <= j1 ; ++j ) {
+      // x range of the hull in the row
+      valueType ylo  = y0 + j*h - eps ;
+      valueType yhi  = y0 + (j+1)*h + eps ;
+      valueType xmin = HUGE_VAL, xmax = -HUGE_VAL ;
+      for ( indexType k = 0 ; k < H.n ; ++k ) {
+        valueType xa = H.x[k], ya = H.y[k] ;
+        if ( ya >= ylo && ya <= yhi ) { xmin = min( xmin, xa ) ; xmax = max( xmax, xa ) ; }
+        indexType k1 = k+1 < H.n ? k+1 : 0 ;
+        valueType xb = H.x[k1], yb = H.y[k1] ;
+        valueType yc[2] = { ylo, yhi } ;
+        for ( indexType l = 0 ; l < 2 ; ++l ) {
+          if ( (ya-yc[l])*(yb-yc[l]) < 0 ) {
+            valueType xc = xa + (yc[l]-ya)*(xb-xa)/(yb-ya) ;
+            xmin = min( xmin, xc ) ;
+            xmax = max( xmax, xc ) ;
+          }
+        }
+      }
+      if ( xmin > xmax ) continue ;
+      indexType i0 = max( i_begin, cellIndex( xmin-eps, x0, h, i_end ) ) ;
+      indexType i1 = min( i_end-1, cellIndex( xmax+eps, x0, h, i_end ) ) ;
+      unsigned char * row = win + (j-j_begin)*stride ;
+      if ( i0 <= i1 ) std::fill( row+(i0-i_begin), row+(i1-i_begin)+1, value ) ;
+    }
+  }
+
+  //! \endcond
+
+  // ---------------------------------------------------------------------------
+
+  ClothoidSweep::ClothoidSweep()
+  : built(false)
+  , split_angle(m_pi/16)
+  , split_size(HUGE_VAL)
+  { p_begin.push_back(0) ; }
+
+  void
+  ClothoidSweep::clear() {
+    px.clear() ;
+    py.clear() ;
+    p_begin.clear() ;
+    p_begin.push_back(0) ;
+    p_box.clear() ;
+    p_index.clear() ;
+    nodes.clear() ;
+    built = false ;
+  }
+
+  void
+  ClothoidSweep::addPolygon( indexType       n,
+                             valueType const x[],
+                             valueType const y[] ) {
+    CLOTHOID_ASSERT( n > 0, "ClothoidSweep::addPolygon, empty polygon" ) ;
+    BBox2D b( x[0], y[0], x[0], y[0] ) ;
+    for ( indexType i = 0 ; i < n ; ++i ) {
+      px.push_back( x[i] ) ;
+      py.push_back( y[i] ) ;
+      b.xmin = min( b.xmin, x[i] ) ; b.xmax = max( b.xmax, x[i] ) ;
+      b.ymin = min( b.ymin, y[i] ) ; b.ymax = max( b.ymax, y[i] ) ;
+    }
+    p_begin.push_back( indexType(px.size()) ) ;
+    p_box.push_back( b ) ;
+    built = false ;
+  }
+
+  // ---------------------------------------------------------------------------
+
+  void
+  ClothoidSweep::buildTree( indexType inode, indexType i_begin, indexType i_end ) {
+    Node & node = nodes[inode] ;
+    node.i_begin = i_begin ;
+    node.i_end   = i_end ;
+    BBox2D b = p_box[p_index[i_begin]] ;
+    for ( indexType i = i_begin+1 ; i < i_end ; ++i ) {
+      BBox2D const & bi = p_box[p_index[i]] ;
+      b.xmin = min( b.xmin, bi.xmin ) ; b.xmax = max( b.xmax, bi.xmax ) ;
+      b.ymin = min( b.ymin, bi.ymin ) ; b.ymax = max( b.ymax, bi.ymax ) ;
+    }
+    node.box = b ;
+    if ( i_end - i_begin == 1 ) {
+      node.child = -1 ;
+    } else {
+      // median split along the longest side
+      indexType ic  = indexType(nodes.size()) ;
+      indexType mid = (i_begin+i_end)/2 ;
+      node.child = ic ;
+      nth_element( p_index.begin()+i_begin, p_index.begin()+mid, p_index.begin()+i_end,
+                   BoxCenterLess( p_box, b.xmax-b.xmin >= b.ymax-b.ymin ) ) ;
+      nodes.resize( nodes.size()+2 ) ; // capacity is reserved, `node` is valid
+      buildTree( ic,   i_begin, mid ) ;
+      buildTree( ic+1, mid,     i_end ) ;
+    }
+  }
+
+  void
+  ClothoidSweep::build() {
+    indexType n = numPolygons() ;
+    p_index.resize( n ) ;
+    for ( indexType i = 0 ; i < n ; ++i ) p_index[i] = i ;
+    nodes.clear() ;
+    if ( n > 0 ) {
+      nodes.reserve( 2*n ) ;
+      nodes.resize( 1 ) ;
+      buildTree( 0, 0, n ) ;
+    }
+    built = true ;
+  }
+
+  // ---------------------------------------------------------------------------
+
+  bool
+  ClothoidSweep::boxHit( BBox2D const & b ) const {
+    if ( nodes.empty() ) return false ;
+    vector<indexType> stack ;
+    stack.push_back(0) ;
+    while ( !stack.empty() ) {
+      Node const & n = nodes[stack.back()] ;
+      stack.pop_back() ;
+      if ( !n.box.overlap( b ) ) continue ;
+      if ( n.child < 0 ) return true ;
+      stack.push_back( n.child+1 ) ;
+      stack.push_back( n.child ) ;
+    }
+    return false ;
+  }
+
+  void
+  ClothoidSweep::candidates( BBox2D const & b, vector<indexType> & idx ) const {
+    idx.clear() ;
+    if ( nodes.empty() ) return ;
+    vector<indexType> stack ;
+    stack.push_back(0) ;
+    while ( !stack.empty() ) {
+      Node const & n = nodes[stack.back()] ;
+      stack.pop_back() ;
+      if ( !n.box.overlap( b ) ) continue ;
+      if ( n.child < 0 ) {
+        idx.push_back( p_index[n.i_begin] ) ;
+      } else {
+        stack.push_back( n.child+1 ) ;
+        stack.push_back( n.child ) ;
+      }
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+
+  bool
+  ClothoidSweep::collision( ClothoidCurve const & c,
+                            valueType             offs_min,
+                            valueType             offs_max,
+                            valueType             tolerance ) const {
+    valueType s ;
+    indexType ipoly ;
+    return firstContact( c, offs_min, offs_max, s, ipoly, tolerance ) ;
+  }
+
+  /*
+   * The pieces of the band are the leaves of a binary tree in order of s,
+   * a subtree whose box does not overlap the boxes of the polygons is
+   * skipped and the leaves are visited left first, so the first leaf with
+   * a contact contains the first contact.
+   * In a leaf each candidate polygon is tested on the interval before the
+   * best contact found so far with a left first bisection.
+   */
+  bool
+  ClothoidSweep::firstContact( ClothoidCurve const & c,
+                               valueType             offs_min,
+                               valueType             offs_max,
+                               valueType           & s,
+                               indexType           & ipoly,
+                               valueType             tolerance ) const {
+    CLOTHOID_ASSERT( built, "ClothoidSweep::firstContact, call build() after addPolygon" ) ;
+    CLOTHOID_ASSERT( offs_min <= offs_max,
+                     "ClothoidSweep::firstContact, offs_min = " << offs_min <<
+                     " > offs_max = " << offs_max ) ;
+    s     = c.getSmax() ;
+    ipoly = -1 ;
+    if ( nodes.empty() ) return false ;
+
+    ClothoidEvaluator e( c ) ;
+    valueType hx[8], hy[8] ;
+
+    // pieces of monotone heading
+    valueType brk[3] ;
+    indexType nbrk = 0 ;
+    brk[nbrk++] = c.getSmin() ;
+    if ( c.getKappa_D() != 0 ) {
+      valueType s_flex = -c.getKappa()/c.getKappa_D() ;
+      if ( s_flex > c.getSmin() && s_flex < c.getSmax() ) brk[nbrk++] = s_flex ;
+    }
+    brk[nbrk++] = c.getSmax() ;
+    vector<SweepNode> leaves ;
+    SweepPoint        P ;
+    sweepEval( e, c.getSmin(), P ) ;
+    for ( indexType k = 0 ; k+1 < nbrk ; ++k ) {
+      valueType u  = brk[k], v = brk[k+1] ;
+      valueType dt = std::abs( e.theta(v)-e.theta(u) ) ;
+      indexType n  = indexType( max( ceil( dt/split_angle ), ceil( (v-u)/split_size ) ) ) ;
+      if ( n < 1 ) n = 1 ;
+      for ( indexType j = 0 ; j < n ; ++j ) {
+        SweepNode L ;
+        L.A     = P ;
+        sweepEval( e, j+1 == n ? v : u + (v-u)*(j+1)/n, L.B ) ;
+        L.child = -1 ;
+        L.box   = hullBox( hx, hy, bandHull( L.A, L.B, offs_min, offs_max, hx, hy ) ) ;
+        leaves.push_back( L ) ;
+        P = L.B ;
+      }
+    }
+    vector<SweepNode> tree ;
+    tree.reserve( 2*leaves.size() ) ;
+    tree.resize( 1 ) ;
+    buildSweepTree( tree, leaves, 0, 0, indexType(leaves.size()) ) ;
+
+    vector<indexType>                    stack, idx ;
+    vector<pair<SweepPoint,SweepPoint> > pieces ;
+    stack.push_back(0) ;
+    while ( !stack.empty() ) {
+      SweepNode const & N = tree[stack.back()] ;
+      stack.pop_back() ;
+      if ( !boxHit( N.box ) ) continue ;
+      if ( N.child >= 0 ) {
+        stack.push_back( N.child+1 ) ;
+        stack.push_back( N.child ) ;
+        continue ;
+      }
+      candidates( N.box, idx ) ;
+      valueType best = HUGE_VAL ;
+      for ( size_t k = 0 ; k < idx.size() ; ++k ) {
+        indexType         ip = idx[k] ;
+        valueType const * qx = &px[p_begin[ip]] ;
+        valueType const * qy = &py[p_begin[ip]] ;
+        indexType         nq = p_begin[ip+1]-p_begin[ip] ;
+        pieces.clear() ;
+        pieces.push_back( pair<SweepPoint,SweepPoint>( N.A, N.B ) ) ;
+        while ( !pieces.empty() ) {
+          SweepPoint A = pieces.back().first ;
+          SweepPoint B = pieces.back().second ;
+          pieces.pop_back() ;
+          if ( A.s >= best ) continue ;
+          indexType nh = bandHull( A, B, offs_min, offs_max, hx, hy ) ;
+          if ( !convexOverlap( hx, hy, nh, qx, qy, nq ) ) continue ;
+          // cross section at A
+          valueType sx[2] = { A.x - offs_min*A.ty, A.x - offs_max*A.ty } ;
+          valueType sy[2] = { A.y + offs_min*A.tx, A.y + offs_max*A.tx } ;
+          if ( convexOverlap( sx, sy, 2, qx, qy, nq ) ||
+               B.s-A.s <= tolerance || pieces.size() >= size_t(SWEEP_MAX_DEPTH) ) {
+            best  = A.s ;
+            ipoly = ip ;
+            break ; // left first, no earlier contact with this polygon
+          }
+          SweepPoint M ;
+          sweepEval( e, (A.s+B.s)/2, M ) ;
+          pieces.push_back( pair<SweepPoint,SweepPoint>( M, B ) ) ;
+          pieces.push_back( pair<SweepPoint,SweepPoint>( A, M ) ) ;
+        }
+      }
+      if ( ipoly >= 0 ) { s = best ; return true ; }
+    }
+    return false ;
+  }
+
+  // ---------------------------------------------------------------------------
+
+  void
+  ClothoidRaster::rasterize( ClothoidCurve const & c,
+                             valueType             offs_min,
+                             valueType             offs_max,
+                             unsigned char         grid[],
+                             unsigned char         value ) const {
+    CLOTHOID_ASSERT( offs_min <= offs_max,
+                     "ClothoidRaster::rasterize, offs_min = " << offs_min <<
+                     " > offs_max = " << offs_max ) ;
+    vector<RasterHull> hulls ;
+    rasterHulls( c, offs_min, offs_max, h, hulls ) ;
+    for ( size_t k = 0 ; k < hulls.size() ; ++k )
+      fillHull( hulls[k], x0, y0, h, 0, nx, 0, ny, grid, nx, value ) ;
+  }
+
+  // ---------------------------------------------------------------------------
+
+  void
+  ClothoidRaster::rasterize( vector<ClothoidCurve> const & c,
+                             valueType                     offs_min,
+                             valueType                     offs_max,
+                             unsigned char                 grid[],
+                             unsigned char                 value ) const {
+    CLOTHOID_ASSERT( offs_min <= offs_max,
+                     "ClothoidRaster::rasterize, offs_min = " << offs_min <<
+                     " > offs_max = " << offs_max ) ;
+    indexType nc = indexType(c.size()) ;
+    vector<vector<RasterHull> > hulls( nc ) ;
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+    #endif
+    for ( indexType k = 0 ; k < nc ; ++k )
+      rasterHulls( c[k], offs_min, offs_max, h, hulls[k] ) ;
+
+    indexType n_stripe = (ny+RASTER_STRIPE-1)/RASTER_STRIPE ;
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+    #endif
+    for ( indexType st = 0 ; st < n_stripe ; ++st ) {
+      indexType j_begin = st*RASTER_STRIPE ;
+      indexType j_end   = min( ny, j_begin+RASTER_STRIPE ) ;
+      valueType ylo     = y0 + j_begin*h - RASTER_MARGIN*h ;
+      valueType yhi     = y0 + j_end*h   + RASTER_MARGIN*h ;
+      for ( indexType k = 0 ; k < nc ; ++k ) {
+        vector<RasterHull> const & H = hulls[k] ;
+        for ( size_t l = 0 ; l < H.size() ; ++l )
+          if ( H[l].box.ymax >= ylo && H[l].box.ymin <= yhi )
+            fillHull( H[l], x0, y0, h, 0, nx, j_begin, j_end,
+                      grid+j_begin*nx, nx, value ) ;
+      }
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+
+  // flag the tiles of FIELD_TILE cells overlapping the box b
+  static
+  void
+  markTiles( BBox2D const & b,
+             valueType x0, valueType y0, valueType h,
+             indexType nx, indexType ny,
+             vector<char> & tiles ) {
+    indexType ntx = (nx+FIELD_TILE-1)/FIELD_TILE ;
+    indexType nty = (ny+FIELD_TILE-1)/FIELD_TILE ;
+    indexType i0  = max( indexType(0), cellIndex( b.xmin, x0, h, nx ) ) / FIELD_TILE ;
+    indexType i1  = min( nx-1,         cellIndex( b.xmax, x0, h, nx ) ) / FIELD_TILE ;
+    indexType j0  = max( indexType(0), cellIndex( b.ymin, y0, h, ny ) ) / FIELD_TILE ;
+    indexType j1  = min( ny-1,         cellIndex( b.ymax, y0, h, ny ) ) / FIELD_TILE ;
+    if ( b.xmax < x0 || b.ymax < y0 ) return ;
+    for ( indexType tj = j0 ; tj <= j1 && tj < nty ; ++tj )
+      for ( indexType ti = i0 ; ti <= i1 && ti < ntx ; ++ti )
+        tiles[ti+tj*ntx] = 1 ;
+  }
+
+  // tree for the projection and box of the exact band of the curve k
+  void
+  ClothoidDistanceField::setupCurve( indexType k ) {
+    trees[k].build( curves[k], offs[k] ) ;
+    vector<RasterHull> H ;
+    rasterHulls( curves[k], offs[k]-near*h, offs[k]+near*h, h, H ) ;
+    if ( H.empty() ) {
+      valueType x, y, r = std::abs(offs[k])+near*h ;
+      curves[k].eval( curves[k].getSmin(), x, y ) ;
+      boxes[k] = BBox2D( x-r, y-r, x+r, y+r ) ;
+      return ;
+    }
+    BBox2D & b = boxes[k] ;
+    b = H[0].box ;
+    for ( size_t l = 1 ; l < H.size() ; ++l ) {
+      b.xmin = min( b.xmin, H[l].box.xmin ) ; b.xmax = max( b.xmax, H[l].box.xmax ) ;
+      b.ymin = min( b.ymin, H[l].box.ymin ) ; b.ymax = max( b.ymax, H[l].box.ymax ) ;
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+
+  /*
+   * Exact distance of the cells of the flagged tiles closer than near*h
+   * to a curve: the candidate cells of a curve are the ones touched by the
+   * hulls of its band [offs-near*h,offs+near*h], the curves are processed
+   * in order and the first one wins a tie, so a tile does not depend on
+   * the other tiles.
+   */
+  void
+  ClothoidDistanceField::nearTiles( vector<char> const & tiles ) {
+    indexType ntx = (nx+FIELD_TILE-1)/FIELD_TILE ;
+    indexType nc  = indexType(curves.size()) ;
+    valueType r   = near*h ;
+
+    // hulls of the curves near the flagged tiles
+    vector<char> used( nc, 0 ) ;
+    vector<char> mark( tiles.size() ) ;
+    for ( indexType k = 0 ; k < nc ; ++k ) {
+      std::fill( mark.begin(), mark.end(), 0 ) ;
+      markTiles( boxes[k], x0, y0, h, nx, ny, mark ) ;
+      for ( size_t t = 0 ; t < tiles.size() && !used[k] ; ++t )
+        used[k] = tiles[t] && mark[t] ;
+    }
+    vector<vector<RasterHull> > hulls( nc ) ;
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+    #endif
+    for ( indexType k = 0 ; k < nc ; ++k )
+      if ( used[k] ) rasterHulls( curves[k], offs[k]-r, offs[k]+r, h, hulls[k] ) ;
+
+    vector<indexType> list ;
+    for ( size_t t = 0 ; t < tiles.size() ; ++t )
+      if ( tiles[t] ) list.push_back( indexType(t) ) ;
+    indexType nt = indexType(list.size()) ;
+
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+    #endif
+    for ( indexType l = 0 ; l < nt ; ++l ) {
+      indexType ti0 = (list[l]%ntx)*FIELD_TILE, ti1 = min( nx, ti0+FIELD_TILE ) ;
+      indexType tj0 = (list[l]/ntx)*FIELD_TILE, tj1 = min( ny, tj0+FIELD_TILE ) ;
+      BBox2D tile( x0+ti0*h, y0+tj0*h, x0+ti1*h, y0+tj1*h ) ;
+      for ( indexType j = tj0 ; j < tj1 ; ++j )
+        std::fill( site_d.begin()+ti0+j*nx, site_d.begin()+ti1+j*nx, HUGE_VAL ) ;
+      vector<unsigned char> mask( FIELD_TILE*FIELD_TILE ) ;
+      for ( indexType k = 0 ; k < nc ; ++k ) {
+        if ( !used[k] || !boxes[k].overlap( tile ) ) continue ;
+        std::fill( mask.begin(), mask.end(), 0 ) ;
+        bool any = false ;
+        for ( size_t q = 0 ; q < hulls[k].size() ; ++q ) {
+          if ( !hulls[k][q].box.overlap( tile ) ) continue ;
+          fillHull( hulls[k][q], x0, y0, h, ti0, ti1, tj0, tj1, &mask.front(), FIELD_TILE, 1 ) ;
+          any = true ;
+        }
+        if ( !any ) continue ;
+        for ( indexType j = tj0 ; j < tj1 ; ++j ) {
+          for ( indexType i = ti0 ; i < ti1 ; ++i ) {
+            if ( !mask[(i-ti0)+(j-tj0)*FIELD_TILE] ) continue ;
+            valueType xc = x0+(i+0.5)*h, yc = y0+(j+0.5)*h, s ;
+            valueType d  = trees[k].project( xc, yc, s, 1e-10, r ) ;
+            indexType c  = i+j*nx ;
+            if ( d <= r && d < site_d[c] ) {
+              site_d[c] = d ;
+              curves[k].eval( s, offs[k], foot_x[c], foot_y[c] ) ;
+            }
+          }
+        }
+      }
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+
+  /*
+   * Closest site by columns, then lower envelope of the parabolas
+   * (i-k)^2 + (j-row_k)^2 along the rows; the distance of a cell is the
+   * one from the closest point of the curves of its closest site.
+   */
+  void
+  ClothoidDistanceField::transform( float dist[] ) {
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(static)
+    #endif
+    for ( indexType i = 0 ; i < nx ; ++i ) {
+      indexType last = -1 ;
+      for ( indexType j = 0 ; j < ny ; ++j ) {
+        if ( site_d[i+j*nx] < HUGE_VAL ) last = j ;
+        near_row[i+j*nx] = last ;
+      }
+      last = -1 ;
+      for ( indexType j = ny-1 ; j >= 0 ; --j ) {
+        indexType & r = near_row[i+j*nx] ;
+        if ( site_d[i+j*nx] < HUGE_VAL ) last = j ;
+        if ( last >= 0 && ( r < 0 || last-j < j-r ) ) r = last ;
+      }
+    }
+    #ifdef _OPENMP
+    #pragma omp parallel
+    #endif
+    {
+      vector<indexType> v( nx ) ;
+      vector<valueType> F( nx ), z( nx ) ;
+      #ifdef _OPENMP
+      #pragma omp for schedule(static)
+      #endif
+      for ( indexType j = 0 ; j < ny ; ++j ) {
+        indexType m = 0 ;
+        for ( indexType k = 0 ; k < nx ; ++k ) {
+          indexType r = near_row[k+j*nx] ;
+          if ( r < 0 ) continue ;
+          valueType fk = valueType(j-r)*(j-r) + valueType(k)*k ;
+          valueType sp = -HUGE_VAL ;
+          while ( m > 0 ) {
+            sp = (fk-F[m-1])/(2*valueType(k-v[m-1])) ;
+            if ( sp > z[m-1] ) break ;
+            --m ;
+            sp = -HUGE_VAL ;
+          }
+          v[m] = k ; F[m] = fk ; z[m] = sp ; ++m ;
+        }
+        float * row = dist + j*nx ;
+        if ( m == 0 ) {
+          std::fill( row, row+nx, float(HUGE_VAL) ) ;
+          continue ;
+        }
+        valueType yc = y0+(j+0.5)*h ;
+        for ( indexType i = 0, p = 0 ; i < nx ; ++i ) {
+          while ( p+1 < m && z[p+1] <= i ) ++p ;
+          indexType c = v[p] + near_row[v[p]+j*nx]*nx ;
+          row[i] = float( hypot( x0+(i+0.5)*h-foot_x[c], yc-foot_y[c] ) ) ;
+        }
+      }
+    }
+  }
+
+  // ---------------------------------------------------------------------------
+
+  void
+  ClothoidDistanceField::build( vector<ClothoidCurve> const & c,
+                                vector<valueType>     const & c_offs,
+                                float                         dist[] ) {
+    CLOTHOID_ASSERT( c_offs.empty() || c_offs.size() == c.size(),
+                     "ClothoidDistanceField::build, " << c.size() <<
+                     " curves and " << c_offs.size() << " offsets" ) ;
+    valueType t0 = wallTime() ;
+    indexType nc = indexType(c.size()) ;
+    curves = c ;
+    offs.assign( nc, 0 ) ;
+    if ( !c_offs.empty() ) offs = c_offs ;
+    trees.resize( nc ) ;
+    boxes.resize( nc ) ;
+    #ifdef _OPENMP
+    #pragma omp parallel for schedule(dynamic)
+    #endif
+    for ( indexType k = 0 ; k < nc ; ++k ) setupCurve( k ) ;
+    site_d.assign( nx*ny, HUGE_VAL ) ;
+    foot_x.resize( nx*ny ) ;
+    foot_y.resize( nx*ny ) ;
+    near_row.resize( nx*ny ) ;
+    indexType ntx = (nx+FIELD_TILE-1)/FIELD_TILE ;
+    indexType nty = (ny+FIELD_TILE-1)/FIELD_TILE ;
+    vector<char> tiles( ntx*nty, 0 ) ;
+    for ( indexType k = 0 ; k < nc ; ++k )
+      markTiles( boxes[k], x0, y0, h, nx, ny, tiles ) ;
+    nearTiles( tiles ) ;
+    valueType t1 = wallTime() ;
+    transform( dist ) ;
+    near_time = t1-t0 ;
+    edt_time  = wallTime()-t1 ;
+  }
+
+  // ---------------------------------------------------------------------------
+
+  void
+  ClothoidDistanceField::update( vector<indexType>     const & idx,
+                                 vector<ClothoidCurve> const & c,
+                                 vector<valueType>     const & c_offs,
+                                 float                         dist[] ) {
+    CLOTHOID_ASSERT( idx.size() == c.size() && ( c_offs.empty() || c_offs.size() == c.size() ),
+                     "ClothoidDistanceField::update, " << idx.size() << " indices, " <<
+                     c.size() << " curves and " << c_offs.size() << " offsets" ) ;
+    valueType t0 = wallTime() ;
+    indexType ntx = (nx+FIELD_TILE-1)/FIELD_TILE ;
+    indexType nty = (ny+FIELD_TILE-1)/FIELD_TILE ;
+    vector<char> tiles( ntx*nty, 0 ) ;
+    for ( size_t l = 0 ; l < idx.size() ; ++l ) {
+      indexType k = idx[l] ;
+      CLOTHOID_ASSERT( k >= 0 && k < indexType(curves.size()),
+                       "ClothoidDistanceField::update, bad curve index " << k ) ;
+      markTiles( boxes[k], x0, y0, h, nx, ny, tiles ) ;
+      curves[k] = c[l] ;
+      offs[k]   = c_offs.empty() ? 0 : c_offs[l] ;
+      setupCurve( k ) ;
+      markTiles( boxes[k], x0, y0, h, nx, ny, tiles ) ;
+    }
+    nearTiles( tiles ) ;
+    valueType t1 = wallTime() ;
+    transform( dist ) ;
+    near_time = t1-t0 ;
+    edt_time  = wallTime()-t1 ;
+  }
+
+  indexType
+  ClothoidDistanceField::numSites() const {
+    indexType n = 0 ;
+    for ( size_t c = 0 ; c < site_d.size() ; ++c )
+      if ( site_d[c] < HUGE_VAL ) ++n ;
+    return n ;
+  }
+
+}
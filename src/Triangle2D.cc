@@ -42,15 +42,142 @@
 
 #include "Clothoid.hh"
 
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+  #include <immintrin.h>
+#endif
+
 namespace Clothoid {
 
+  /*
+   *  Adaptive orientation predicate (J.R. Shewchuk, "Adaptive Precision
+   *  Floating-Point Arithmetic and Fast Robust Geometric Predicates",
+   *  Discrete & Computational Geometry 18, 1997).
+   *
+   *  The determinant is evaluated in floating point and accepted when it is
+   *  larger than the static error bound, otherwise its sign is computed
+   *  exactly as a sum of products of the coordinates with expansions.
+   */
+
+  #ifdef CLOTHOID_PREDICATE_STATS
+  static unsigned long orient2d_calls = 0 ;
+  static unsigned long orient2d_exact = 0 ;
+  #endif
+
+  static valueType const orient2d_eps   = 1.1102230246251565e-16 ; // 2^-53
+  static valueType const orient2d_bound = (3+16*orient2d_eps)*orient2d_eps ;
+
+  // a*b = x + y exactly
+  static
+  inline
+  void
+  two_product( valueType a, valueType b, valueType & x, valueType & y ) {
+    x = a*b ;
+  #ifdef __FMA__
+    y = std::fma( a, b, -x ) ;
+  #else
+    valueType const splitter = 134217729.0 ; // 2^27+1
+    valueType c   = splitter*a ;
+    valueType ahi = c-(c-a) ;
+    valueType alo = a-ahi ;
+    c = splitter*b ;
+    valueType bhi = c-(c-b) ;
+    valueType blo = b-bhi ;
+    y = alo*blo - (((x-ahi*bhi)-alo*bhi)-ahi*blo) ;
+  #endif
+  }
+
+  // a+b = x + y exactly
+  static
+  inline
+  void
+  two_sum( valueType a, valueType b, valueType & x, valueType & y ) {
+    x = a+b ;
+    valueType bv = x-a ;
+    valueType av = x-bv ;
+    y = (a-av)+(b-bv) ;
+  }
+
+  // sign of a[0]*b[1]-a[0]*c[1]-c[0]*b[1]-a[1]*b[0]+a[1]*c[0]+c[1]*b[0]
+  static
+  valueType
+  orient_2d_exact( valueType const a[2],
+                   valueType const b[2],
+                   valueType const c[2] ) {
+    valueType const f1[6] = {  a[0],  a[0], c[0], a[1], a[1], c[1] } ;
+    valueType const f2[6] = {  b[1], -c[1], -b[1], -b[0], c[0], b[0] } ;
+    valueType e[12] ; // nonoverlapping expansion, increasing magnitude
+    int       ne = 0 ;
+    for ( int i = 0 ; i < 6 ; ++i ) {
+      valueType p[2] ;
+      two_product( f1[i], f2[i], p[1], p[0] ) ;
+      for ( int j = 0 ; j < 2 ; ++j ) {
+        // grow expansion with zero elimination
+        valueType q = p[j] ;
+        int       nh = 0 ;
+        for ( int k = 0 ; k < ne ; ++k ) {
+          valueType h ;
+          two_sum( q, e[k], q, h ) ;
+          if ( h != 0 ) e[nh++] = h ;
+        }
+        if ( q != 0 ) e[nh++] = q ;
+        ne = nh ;
+      }
+    }
+    return ne > 0 ? e[ne-1] : 0 ;
+  }
+
   static
   inline
   valueType
   orient_2d( valueType const a[2],
              valueType const b[2],
              valueType const c[2] ) {
-    return (a[0]-c[0]) * (b[1]-c[1]) - (a[1]-c[1]) * (b[0]-c[0]) ;
+  #ifdef CLOTHOID_PREDICATE_STATS
+    #ifdef _OPENMP
+    #pragma omp atomic
+    #endif
+    ++orient2d_calls ;
+  #endif
+    valueType detleft  = (a[0]-c[0]) * (b[1]-c[1]) ;
+    valueType detright = (a[1]-c[1]) * (b[0]-c[0]) ;
+    valueType det      = detleft - detright ;
+    // a zero determinant passes only when both products are zero, i.e. exact
+    if ( std::abs(det) >= orient2d_bound * (std::abs(detleft)+std::abs(detright)) ) return det ;
+  #ifdef CLOTHOID_PREDICATE_STATS
+    #ifdef _OPENMP
+    #pragma omp atomic
+    #endif
+    ++orient2d_exact ;
+  #endif
+    return orient_2d_exact( a, b, c ) ;
+  }
+
+  valueType
+  orient2d( valueType const a[2],
+            valueType const b[2],
+            valueType const c[2] ) {
+    return orient_2d( a, b, c ) ;
+  }
+
+  void
+  orient2dStats( unsigned long & n_calls, unsigned long & n_exact ) {
+  #ifdef CLOTHOID_PREDICATE_STATS
+    n_calls = orient2d_calls ;
+    n_exact = orient2d_exact ;
+  #else
+    n_calls = n_exact = 0 ;
+  #endif
+  }
+
+  void
+  orient2dStatsReset() {
+  #ifdef CLOTHOID_PREDICATE_STATS
+    orient2d_calls = orient2d_exact = 0 ;
+  #endif
   }
 
   static
@@ -143,16 +270,73 @@ namespace Clothoid {
                            valueType const r1[2],
                            valueType const p2[2],
                            valueType const q2[2],
-                           valueType const r2[2] ) {
-    if ( orient_2d(p1,q1,r1) < 0 ) {
-      if ( orient_2d(p2,q2,r2) < 0 ) return tri_tri_intersection_2d(p1,r1,q1,p2,r2,q2) ;
-      else                           return tri_tri_intersection_2d(p1,r1,q1,p2,q2,r2) ;
+                           valueType const r2[2],
+                           valueType const o1, // orient_2d(p1,q1,r1)
+                           valueType const o2 ) { // orient_2d(p2,q2,r2)
+    if ( o1 < 0 ) {
+      if ( o2 < 0 ) return tri_tri_intersection_2d(p1,r1,q1,p2,r2,q2) ;
+      else          return tri_tri_intersection_2d(p1,r1,q1,p2,q2,r2) ;
     } else {
-      if ( orient_2d(p2,q2,r2) < 0 ) return tri_tri_intersection_2d(p1,q1,r1,p2,r2,q2) ;
-      else                           return tri_tri_intersection_2d(p1,q1,r1,p2,q2,r2) ;
+      if ( o2 < 0 ) return tri_tri_intersection_2d(p1,q1,r1,p2,r2,q2) ;
+      else          return tri_tri_intersection_2d(p1,q1,r1,p2,q2,r2) ;
     }
   }
   
+  /*
+   * The decision tree above needs the orientation of the triangles,
+   * with the exact predicate only a degenerate triangle (segment or point,
+   * e.g. the bounding triangle of a straight piece of curve) has none,
+   * it is tested with the separating axes: the normals and the
+   * directions of the edges of both triangles.
+   */
+
+  static
+  inline
+  bool
+  separated_on_axis( valueType const       ax,
+                     valueType const       ay,
+                     valueType const * const P[3],
+                     valueType const * const Q[3] ) {
+    valueType pmin = P[0][0]*ax + P[0][1]*ay, pmax = pmin ;
+    valueType qmin = Q[0][0]*ax + Q[0][1]*ay, qmax = qmin ;
+    for ( int i = 1 ; i < 3 ; ++i ) {
+      valueType p = P[i][0]*ax + P[i][1]*ay ;
+      valueType q = Q[i][0]*ax + Q[i][1]*ay ;
+      if ( p < pmin ) pmin = p ; else if ( p > pmax ) pmax = p ;
+      if ( q < qmin ) qmin = q ; else if ( q > qmax ) qmax = q ;
+    }
+    return pmax < qmin || qmax < pmin ;
+  }
+
+  static
+  bool
+  degenerate_overlap_test_2d( valueType const p1[2],
+                              valueType const q1[2],
+                              valueType const r1[2],
+                              valueType const p2[2],
+                              valueType const q2[2],
+                              valueType const r2[2] ) {
+    valueType const * const P[3] = { p1, q1, r1 } ;
+    valueType const * const Q[3] = { p2, q2, r2 } ;
+    int nedge = 0 ;
+    for ( int k = 0 ; k < 2 ; ++k ) {
+      valueType const * const * T = k == 0 ? P : Q ;
+      for ( int i = 0 ; i < 3 ; ++i ) {
+        valueType const * a = T[i] ;
+        valueType const * b = T[(i+1)%3] ;
+        valueType dx = b[0]-a[0] ;
+        valueType dy = b[1]-a[1] ;
+        if ( dx == 0 && dy == 0 ) continue ;
+        ++nedge ;
+        if ( separated_on_axis( -dy, dx, P, Q ) ) return false ;
+        if ( separated_on_axis(  dx, dy, P, Q ) ) return false ;
+      }
+    }
+    // both triangles are a point
+    if ( nedge == 0 ) return p1[0] == p2[0] && p1[1] == p2[1] ;
+    return true ;
+  }
+
   bool
   Triangle2D::intersect( Triangle2D const & t2 ) const {
     return tri_tri_intersection_2d( p1, p2, p3, t2.p1, t2.p2, t2.p3 ) ;
@@ -160,7 +344,204 @@ namespace Clothoid {
 
   bool
   Triangle2D::overlap( Triangle2D const & t2 ) const {
-    return tri_tri_overlap_test_2d( p1, p2, p3, t2.p1, t2.p2, t2.p3 ) ;
+    // disjoint bounding boxes, exact comparisons, no predicate needed
+    for ( int i = 0 ; i < 2 ; ++i ) {
+      valueType mx1 = std::max( p1[i], std::max( p2[i], p3[i] ) ) ;
+      valueType mn2 = std::min( t2.p1[i], std::min( t2.p2[i], t2.p3[i] ) ) ;
+      if ( mx1 < mn2 ) return false ;
+      valueType mn1 = std::min( p1[i], std::min( p2[i], p3[i] ) ) ;
+      valueType mx2 = std::max( t2.p1[i], std::max( t2.p2[i], t2.p3[i] ) ) ;
+      if ( mx2 < mn1 ) return false ;
+    }
+    valueType o1 = orient_2d( p1, p2, p3 ) ;
+    valueType o2 = orient_2d( t2.p1, t2.p2, t2.p3 ) ;
+    if ( o1 == 0 || o2 == 0 )
+      return degenerate_overlap_test_2d( p1, p2, p3, t2.p1, t2.p2, t2.p3 ) ;
+    return tri_tri_overlap_test_2d( p1, p2, p3, t2.p1, t2.p2, t2.p3, o1, o2 ) ;
+  }
+
+
+  /*
+   *  Prepared triangles and one to many overlap test
+   */
+
+  void
+  PreparedTriangle2D::setup( Triangle2D const & t ) {
+    tri = t ;
+    x[0] = t.x1() ; y[0] = t.y1() ;
+    valueType o = orient_2d( t.p1, t.p2, t.p3 ) ;
+    if ( o >= 0 ) {
+      x[1] = t.x2() ; y[1] = t.y2() ;
+      x[2] = t.x3() ; y[2] = t.y3() ;
+    } else {
+      x[1] = t.x3() ; y[1] = t.y3() ;
+      x[2] = t.x2() ; y[2] = t.y2() ;
+    }
+    valueType scale = 1 ;
+    for ( int i = 0 ; i < 3 ; ++i ) {
+      int       j  = (i+1)%3 ;
+      valueType dx = x[j]-x[i] ;
+      valueType dy = y[j]-y[i] ;
+      valueType l  = hypot( dx, dy ) ;
+      if ( l > 0 ) { nx[i] = dy/l ; ny[i] = -dx/l ; }
+      else         { nx[i] = ny[i] = 0 ; } // never separates
+      d[i]  = nx[i]*x[i] + ny[i]*y[i] ;
+      scale = std::max( scale, std::max( std::abs(x[i]), std::abs(y[i]) ) ) ;
+    }
+    // far above the rounding of the projections
+    tol = 1e-10*scale ;
+    // the separating axis theorem on the edge normals holds for triangles
+    // with nonzero area, a segment or a point is always tested exactly
+    acc = o != 0 ? -tol : -std::numeric_limits<valueType>::infinity() ;
+    xmin = std::min( x[0], std::min( x[1], x[2] ) ) ;
+    ymin = std::min( y[0], std::min( y[1], y[2] ) ) ;
+    xmax = std::max( x[0], std::max( x[1], x[2] ) ) ;
+    ymax = std::max( y[0], std::max( y[1], y[2] ) ) ;
+  }
+
+  void
+  Triangle2DBatch::setup( vector<Triangle2D> const & t ) {
+    n = indexType(t.size()) ;
+    tri.assign( t.begin(), t.end() ) ;
+    data.resize( size_t(21*n) ) ;
+    valueType * D = n > 0 ? &data.front() : 0 ;
+    for ( indexType j = 0 ; j < n ; ++j ) {
+      PreparedTriangle2D p( t[j] ) ;
+      for ( indexType k = 0 ; k < 3 ; ++k ) {
+        D[(k+0)*n+j]  = p.x[k] ;
+        D[(k+3)*n+j]  = p.y[k] ;
+        D[(k+6)*n+j]  = p.nx[k] ;
+        D[(k+9)*n+j]  = p.ny[k] ;
+        D[(k+12)*n+j] = p.d[k] ;
+      }
+      D[15*n+j] = p.tol ;
+      D[16*n+j] = p.acc ;
+      D[17*n+j] = p.xmin ;
+      D[18*n+j] = p.ymin ;
+      D[19*n+j] = p.xmax ;
+      D[20*n+j] = p.ymax ;
+    }
+  }
+
+  void
+  Triangle2DBatch::clear() {
+    // swap with empty vectors to release the memory
+    vector<Triangle2D>().swap( tri ) ;
+    vector<valueType>().swap( data ) ;
+    n = 0 ;
+  }
+
+  /*
+   * For each triangle of the batch the largest, over the 6 edges, of the
+   * smallest projection of the vertices of a triangle on the outward
+   * normal of an edge of the other one, minus the offset of the edge:
+   * `mx > tol` separates the triangles, `mx < acc` (all the axes
+   * overlapping by more than the margin) proves the overlap.
+   * The boxes are compared exactly as in Triangle2D::overlap.
+   */
+  indexType
+  Triangle2DBatch::overlap( PreparedTriangle2D const & A, indexType idx[] ) const {
+    indexType nidx = 0 ;
+    indexType j    = 0 ;
+    valueType const * X[3]  = { col(0),  col(1),  col(2)  } ;
+    valueType const * Y[3]  = { col(3),  col(4),  col(5)  } ;
+    valueType const * NX[3] = { col(6),  col(7),  col(8)  } ;
+    valueType const * NY[3] = { col(9),  col(10), col(11) } ;
+    valueType const * DD[3] = { col(12), col(13), col(14) } ;
+    valueType const * TOL   = col(15) ;
+    valueType const * ACC   = col(16) ;
+    valueType const * XMIN  = col(17) ;
+    valueType const * YMIN  = col(18) ;
+    valueType const * XMAX  = col(19) ;
+    valueType const * YMAX  = col(20) ;
+
+    #if defined(__AVX512F__)
+    // min/max with all the lanes selected, `_mm512_min_pd` of gcc passes an
+    // uninitialized vector for the unselected ones (-Wmaybe-uninitialized)
+    for ( ; j+8 <= n ; j += 8 ) {
+      __mmask8 out = _mm512_cmp_pd_mask( _mm512_loadu_pd(XMAX+j), _mm512_set1_pd(A.xmin), _CMP_LT_OQ ) |
+                     _mm512_cmp_pd_mask( _mm512_set1_pd(A.xmax), _mm512_loadu_pd(XMIN+j), _CMP_LT_OQ ) |
+                     _mm512_cmp_pd_mask( _mm512_loadu_pd(YMAX+j), _mm512_set1_pd(A.ymin), _CMP_LT_OQ ) |
+                     _mm512_cmp_pd_mask( _mm512_set1_pd(A.ymax), _mm512_loadu_pd(YMIN+j), _CMP_LT_OQ ) ;
+      if ( out == 0xFF ) continue ;
+      __m512d mx = _mm512_set1_pd( -std::numeric_limits<valueType>::infinity() ) ;
+      for ( int k = 0 ; k < 3 ; ++k ) {
+        // edges of A, projection of the vertices of the batch
+        __m512d nx = _mm512_set1_pd( A.nx[k] ) ;
+        __m512d ny = _mm512_set1_pd( A.ny[k] ) ;
+        __m512d m  = _mm512_fmadd_pd( nx, _mm512_loadu_pd(X[0]+j), _mm512_mul_pd( ny, _mm512_loadu_pd(Y[0]+j) ) ) ;
+        m  = _mm512_maskz_min_pd( 0xFF, m, _mm512_fmadd_pd( nx, _mm512_loadu_pd(X[1]+j), _mm512_mul_pd( ny, _mm512_loadu_pd(Y[1]+j) ) ) ) ;
+        m  = _mm512_maskz_min_pd( 0xFF, m, _mm512_fmadd_pd( nx, _mm512_loadu_pd(X[2]+j), _mm512_mul_pd( ny, _mm512_loadu_pd(Y[2]+j) ) ) ) ;
+        mx = _mm512_maskz_max_pd( 0xFF, mx, _mm512_sub_pd( m, _mm512_set1_pd( A.d[k] ) ) ) ;
+        // edges of the batch, projection of the vertices of A
+        nx = _mm512_loadu_pd( NX[k]+j ) ;
+        ny = _mm512_loadu_pd( NY[k]+j ) ;
+        m  = _mm512_fmadd_pd( nx, _mm512_set1_pd(A.x[0]), _mm512_mul_pd( ny, _mm512_set1_pd(A.y[0]) ) ) ;
+        m  = _mm512_maskz_min_pd( 0xFF, m, _mm512_fmadd_pd( nx, _mm512_set1_pd(A.x[1]), _mm512_mul_pd( ny, _mm512_set1_pd(A.y[1]) ) ) ) ;
+        m  = _mm512_maskz_min_pd( 0xFF, m, _mm512_fmadd_pd( nx, _mm512_set1_pd(A.x[2]), _mm512_mul_pd( ny, _mm512_set1_pd(A.y[2]) ) ) ) ;
+        mx = _mm512_maskz_max_pd( 0xFF, mx, _mm512_sub_pd( m, _mm512_loadu_pd( DD[k]+j ) ) ) ;
+      }
+      __m512d  tol = _mm512_add_pd( _mm512_set1_pd(A.tol), _mm512_loadu_pd(TOL+j) ) ;
+      __m512d  acc = _mm512_add_pd( _mm512_set1_pd(A.acc), _mm512_loadu_pd(ACC+j) ) ;
+      unsigned sep = unsigned( out | _mm512_cmp_pd_mask( mx, tol, _CMP_GT_OQ ) ) ;
+      unsigned in  = unsigned( _mm512_cmp_pd_mask( mx, acc, _CMP_LT_OQ ) ) ;
+      for ( indexType b = 0 ; b < 8 ; ++b )
+        if ( ((sep >> b) & 1) == 0 &&
+             ( ((in >> b) & 1) != 0 || A.tri.overlap( tri[j+b] ) ) ) idx[nidx++] = j+b ;
+    }
+    #elif defined(__AVX2__)
+    for ( ; j+4 <= n ; j += 4 ) {
+      __m256d out = _mm256_or_pd( _mm256_or_pd( _mm256_cmp_pd( _mm256_loadu_pd(XMAX+j), _mm256_set1_pd(A.xmin), _CMP_LT_OQ ),
+                                                _mm256_cmp_pd( _mm256_set1_pd(A.xmax), _mm256_loadu_pd(XMIN+j), _CMP_LT_OQ ) ),
+                                  _mm256_or_pd( _mm256_cmp_pd( _mm256_loadu_pd(YMAX+j), _mm256_set1_pd(A.ymin), _CMP_LT_OQ ),
+                                                _mm256_cmp_pd( _mm256_set1_pd(A.ymax), _mm256_loadu_pd(YMIN+j), _CMP_LT_OQ ) ) ) ;
+      if ( _mm256_movemask_pd(out) == 0xF ) continue ;
+      __m256d mx = _mm256_set1_pd( -std::numeric_limits<valueType>::infinity() ) ;
+      for ( int k = 0 ; k < 3 ; ++k ) {
+        // edges of A, projection of the vertices of the batch
+        __m256d nx = _mm256_set1_pd( A.nx[k] ) ;
+        __m256d ny = _mm256_set1_pd( A.ny[k] ) ;
+        __m256d m  = _mm256_add_pd( _mm256_mul_pd( nx, _mm256_loadu_pd(X[0]+j) ), _mm256_mul_pd( ny, _mm256_loadu_pd(Y[0]+j) ) ) ;
+        m  = _mm256_min_pd( m, _mm256_add_pd( _mm256_mul_pd( nx, _mm256_loadu_pd(X[1]+j) ), _mm256_mul_pd( ny, _mm256_loadu_pd(Y[1]+j) ) ) ) ;
+        m  = _mm256_min_pd( m, _mm256_add_pd( _mm256_mul_pd( nx, _mm256_loadu_pd(X[2]+j) ), _mm256_mul_pd( ny, _mm256_loadu_pd(Y[2]+j) ) ) ) ;
+        mx = _mm256_max_pd( mx, _mm256_sub_pd( m, _mm256_set1_pd( A.d[k] ) ) ) ;
+        // edges of the batch, projection of the vertices of A
+        nx = _mm256_loadu_pd( NX[k]+j ) ;
+        ny = _mm256_loadu_pd( NY[k]+j ) ;
+        m  = _mm256_add_pd( _mm256_mul_pd( nx, _mm256_set1_pd(A.x[0]) ), _mm256_mul_pd( ny, _mm256_set1_pd(A.y[0]) ) ) ;
+        m  = _mm256_min_pd( m, _mm256_add_pd( _mm256_mul_pd( nx, _mm256_set1_pd(A.x[1]) ), _mm256_mul_pd( ny, _mm256_set1_pd(A.y[1]) ) ) ) ;
+        m  = _mm256_min_pd( m, _mm256_add_pd( _mm256_mul_pd( nx, _mm256_set1_pd(A.x[2]) ), _mm256_mul_pd( ny, _mm256_set1_pd(A.y[2]) ) ) ) ;
+        mx = _mm256_max_pd( mx, _mm256_sub_pd( m, _mm256_loadu_pd( DD[k]+j ) ) ) ;
+      }
+      __m256d  tol = _mm256_add_pd( _mm256_set1_pd(A.tol), _mm256_loadu_pd(TOL+j) ) ;
+      __m256d  acc = _mm256_add_pd( _mm256_set1_pd(A.acc), _mm256_loadu_pd(ACC+j) ) ;
+      unsigned sep = unsigned( _mm256_movemask_pd( _mm256_or_pd( out, _mm256_cmp_pd( mx, tol, _CMP_GT_OQ ) ) ) ) ;
+      unsigned in  = unsigned( _mm256_movemask_pd( _mm256_cmp_pd( mx, acc, _CMP_LT_OQ ) ) ) ;
+      for ( indexType b = 0 ; b < 4 ; ++b )
+        if ( ((sep >> b) & 1) == 0 &&
+             ( ((in >> b) & 1) != 0 || A.tri.overlap( tri[j+b] ) ) ) idx[nidx++] = j+b ;
+    }
+    #endif
+
+    // scalar loop (and remainder of the vector loop)
+    for ( ; j < n ; ++j ) {
+      if ( XMAX[j] < A.xmin || A.xmax < XMIN[j] ||
+           YMAX[j] < A.ymin || A.ymax < YMIN[j] ) continue ;
+      valueType tol = A.tol + TOL[j] ;
+      valueType mx  = -std::numeric_limits<valueType>::infinity() ;
+      for ( int k = 0 ; k < 3 && mx <= tol ; ++k ) {
+        valueType m0 = std::min( A.nx[k]*X[0][j] + A.ny[k]*Y[0][j],
+                       std::min( A.nx[k]*X[1][j] + A.ny[k]*Y[1][j],
+                                 A.nx[k]*X[2][j] + A.ny[k]*Y[2][j] ) ) ;
+        valueType m1 = std::min( NX[k][j]*A.x[0] + NY[k][j]*A.y[0],
+                       std::min( NX[k][j]*A.x[1] + NY[k][j]*A.y[1],
+                                 NX[k][j]*A.x[2] + NY[k][j]*A.y[2] ) ) ;
+        mx = std::max( mx, std::max( m0 - A.d[k], m1 - DD[k][j] ) ) ;
+      }
+      if ( mx > tol ) continue ;
+      if ( mx < A.acc + ACC[j] || A.tri.overlap( tri[j] ) ) idx[nidx++] = j ;
+    }
+    return nidx ;
   }
 
 }
@@ -0,0 +1,119 @@
+#include "Clothoid.hh"
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <cmath>
+#include <algorithm>
+#ifdef _OPENMP
+  #include <omp.h>
+#endif
+
+Clothoid::valueType m_pi = 3.14159265358979323846264338328 ;
+
+using namespace std ;
+
+static
+Clothoid::valueType
+rnd() {
+  return rand()/Clothoid::valueType(RAND_MAX) ;
+}
+
+// elapsed time in seconds
+static
+Clothoid::valueType
+wallTime() {
+  #ifdef _OPENMP
+  return omp_get_wtime() ;
+  #else
+  return clock()/Clothoid::valueType(CLOCKS_PER_SEC) ;
+  #endif
+}
+
+// distance field of the lane boundaries of a road network
+int
+main() {
+  srand(1) ;
+  // roads as G2 chains of clothoids, each one with 4 lane boundaries
+  std::vector<Clothoid::ClothoidCurve> c ;
+  std::vector<Clothoid::valueType>     offs ;
+  for ( Clothoid::indexType r = 0 ; r < 40 ; ++r ) {
+    Clothoid::valueType x = 200*(rnd()-0.5), y = 200*(rnd()-0.5), theta = 2*m_pi*rnd(), kappa = 0 ;
+    for ( Clothoid::indexType i = 0 ; i < 5 ; ++i ) {
+      Clothoid::valueType L  = 20+30*rnd() ;
+      Clothoid::valueType k1 = 0.06*(rnd()-0.5) ;
+      Clothoid::ClothoidCurve seg( x, y, theta, kappa, (k1-kappa)/L, L ) ;
+      for ( Clothoid::indexType l = 0 ; l < 4 ; ++l ) {
+        c.push_back( seg ) ;
+        offs.push_back( -5.25+3.5*l ) ;
+      }
+      seg.eval( L, theta, kappa, x, y ) ;
+    }
+  }
+
+  Clothoid::valueType h = 0.2 ;
+  Clothoid::indexType nx = 1000, ny = 1000 ;
+  Clothoid::ClothoidDistanceField field( -100, -100, h, nx, ny ) ;
+  std::vector<float> dist( nx*ny ), dist2( nx*ny ) ;
+  Clothoid::valueType t_near, t_edt ;
+
+  Clothoid::valueType t0 = wallTime() ;
+  field.build( c, offs, &dist.front() ) ;
+  Clothoid::valueType t1 = wallTime() ;
+  field.times( t_near, t_edt ) ;
+  Clothoid::valueType mcell = 1e-6*nx*ny ;
+  cout << c.size() << " curves, " << nx << "x" << ny << " cells, "
+       << field.numSites() << " exact\n"
+       << "build:     " << 1e3*(t1-t0)/mcell << " ms per megacell ("
+       << 1e3*t_near << " ms exact band, " << 1e3*t_edt << " ms transform, wall time)\n" ;
+
+  // exact distance of a sample of cells
+  Clothoid::valueType maxerr = 0, sumerr = 0, minerr = 0 ;
+  Clothoid::indexType nsample = 2000 ;
+  for ( Clothoid::indexType l = 0 ; l < nsample ; ++l ) {
+    Clothoid::indexType i = rand()%nx, j = rand()%ny ;
+    Clothoid::valueType xc = -100+(i+0.5)*h, yc = -100+(j+0.5)*h, d = HUGE_VAL, s ;
+    Clothoid::valueType fx = 0, fy = 0 ;
+    for ( size_t k = 0 ; k < c.size() ; ++k ) {
+      Clothoid::valueType dk = c[k].project( xc, yc, offs[k], s ) ;
+      if ( dk < d ) { d = dk ; c[k].eval( s, offs[k], fx, fy ) ; }
+    }
+    // the parts of the curves outside the grid are not seen
+    if ( std::abs(fx) > 100 || std::abs(fy) > 100 ) { --l ; continue ; }
+    Clothoid::valueType err = dist[i+j*nx]-d ;
+    maxerr  = max( maxerr, err ) ;
+    minerr  = min( minerr, err ) ;
+    sumerr += err ;
+  }
+  cout << "error on " << nsample << " cells: max " << maxerr << ", mean "
+       << sumerr/nsample << ", min " << minerr << " (cell " << h << ")\n" ;
+
+  // move the 4 boundaries of a segment of 5 roads
+  std::vector<Clothoid::indexType>     idx ;
+  std::vector<Clothoid::ClothoidCurve> cn ;
+  std::vector<Clothoid::valueType>     on ;
+  for ( Clothoid::indexType r = 0 ; r < 5 ; ++r ) {
+    for ( Clothoid::indexType l = 0 ; l < 4 ; ++l ) {
+      Clothoid::indexType k = 20*r+4*2+l ;
+      Clothoid::ClothoidCurve seg = c[k] ;
+      seg.translate( 2, -1 ) ;
+      idx.push_back( k ) ;
+      cn.push_back( seg ) ;
+      on.push_back( offs[k] ) ;
+      c[k] = seg ;
+    }
+  }
+  t0 = wallTime() ;
+  field.update( idx, cn, on, &dist.front() ) ;
+  t1 = wallTime() ;
+  field.times( t_near, t_edt ) ;
+  cout << "update of " << idx.size() << " curves: " << 1e3*(t1-t0) << " ms ("
+       << 1e3*t_near << " ms exact band, " << 1e3*t_edt << " ms transform)\n" ;
+  Clothoid::ClothoidDistanceField field2( -100, -100, h, nx, ny ) ;
+  field2.build( c, offs, &dist2.front() ) ;
+  Clothoid::indexType ndiff = 0 ;
+  for ( Clothoid::indexType i = 0 ; i < nx*ny ; ++i )
+    if ( dist[i] != dist2[i] ) ++ndiff ;
+  cout << "cells different from a new build: " << ndiff << '\n' ;
+  // the transform is exact up to about a cell, float rounding aside
+  return ndiff > 0 || maxerr > h || minerr < -1e-4 ? 1 : 0 ;
+}
@@ -0,0 +1,187 @@
+#include "Clothoid.hh"
+#include <iostream>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+
+Clothoid::valueType m_pi = 3.14159265358979323846264338328 ;
+
+using namespace std ;
+
+static
+Clothoid::valueType
+rnd() {
+  return rand()/Clothoid::valueType(RAND_MAX) ;
+}
+
+// p inside the triangle t up to tol (either orientation)
+static
+bool
+inside( Clothoid::Triangle2D const & t,
+        Clothoid::valueType          x,
+        Clothoid::valueType          y,
+        Clothoid::valueType          tol ) {
+  Clothoid::valueType px[4] = { t.x1(), t.x2(), t.x3(), t.x1() } ;
+  Clothoid::valueType py[4] = { t.y1(), t.y2(), t.y3(), t.y1() } ;
+  Clothoid::valueType o[3] ;
+  for ( Clothoid::indexType i = 0 ; i < 3 ; ++i ) {
+    Clothoid::valueType ex = px[i+1]-px[i], ey = py[i+1]-py[i] ;
+    // signed distance of the point from the edge
+    o[i] = ( ex*(y-py[i]) - ey*(x-px[i]) )/max( hypot(ex,ey), 1e-300 ) ;
+  }
+  // the box excludes the points on the line of a degenerate triangle
+  bool in_box = x >= min( px[0], min( px[1], px[2] ) )-tol &&
+                x <= max( px[0], max( px[1], px[2] ) )+tol &&
+                y >= min( py[0], min( py[1], py[2] ) )-tol &&
+                y <= max( py[0], max( py[1], py[2] ) )+tol ;
+  return in_box && ( ( o[0] >= -tol && o[1] >= -tol && o[2] >= -tol ) ||
+                     ( o[0] <=  tol && o[1] <=  tol && o[2] <=  tol ) ) ;
+}
+
+static
+bool
+same( Clothoid::Triangle2D const & a, Clothoid::Triangle2D const & b ) {
+  return a.x1() == b.x1() && a.y1() == b.y1() &&
+         a.x2() == b.x2() && a.y2() == b.y2() &&
+         a.x3() == b.x3() && a.y3() == b.y3() ;
+}
+
+// multi offset evaluation and splitting against the single offset calls,
+// ClothoidEvaluator against ClothoidCurve
+int
+main() {
+  std::vector<Clothoid::ClothoidCurve> c ;
+  srand(1) ;
+  for ( Clothoid::indexType i = 0 ; i < 300 ; ++i ) {
+    Clothoid::valueType r  = rnd() ;
+    Clothoid::valueType k  = 0, dk = 0 ;
+    if      ( r > 0.6 ) { k = 0.2*(rnd()-0.5) ; dk = 0.004*(rnd()-0.5) ; }
+    else if ( r > 0.3 ) { k = 0.2*(rnd()-0.5) ; }
+    c.push_back( Clothoid::ClothoidCurve( 100*(rnd()-0.5), 100*(rnd()-0.5),
+                                          2*m_pi*(rnd()-0.5), k, dk, 10+40*rnd() ) ) ;
+  }
+  // |offs*kappa| < 1 on all the curves, the offset curves have no cusp
+  Clothoid::indexType const n_offs = 5 ;
+  Clothoid::valueType offs[n_offs] = { -2, -0.5, 0, 0.75, 2 } ;
+
+  // eval, eval_D and the batch forms
+  Clothoid::indexType const ns = 64 ;
+  Clothoid::indexType neval = 0, ndiff_eval = 0 ;
+  for ( size_t i = 0 ; i < c.size() ; ++i ) {
+    Clothoid::valueType s[ns] ;
+    Clothoid::valueType x[ns*n_offs], y[ns*n_offs], x_D[ns*n_offs], y_D[ns*n_offs] ;
+    Clothoid::valueType xb[ns*n_offs], yb[ns*n_offs] ;
+    for ( Clothoid::indexType l = 0 ; l < ns ; ++l )
+      s[l] = c[i].getSmax()*l/(ns-1) ;
+    c[i].eval( ns, s, n_offs, offs, x, y, x_D, y_D ) ;
+    c[i].eval( ns, s, n_offs, offs, xb, yb ) ;
+    for ( Clothoid::indexType l = 0 ; l < ns ; ++l ) {
+      Clothoid::valueType x1[n_offs], y1[n_offs], x1_D[n_offs], y1_D[n_offs] ;
+      Clothoid::valueType x2[n_offs], y2[n_offs], x2_D[n_offs], y2_D[n_offs] ;
+      c[i].eval( s[l], n_offs, offs, x1, y1 ) ;
+      c[i].eval_D( s[l], n_offs, offs, x1_D, y1_D ) ;
+      c[i].eval( s[l], n_offs, offs, x2, y2, x2_D, y2_D ) ;
+      for ( Clothoid::indexType j = 0 ; j < n_offs ; ++j, ++neval ) {
+        Clothoid::valueType px, py, px_D, py_D ;
+        Clothoid::indexType ij = l*n_offs+j ;
+        c[i].eval( s[l], offs[j], px, py ) ;
+        c[i].eval_D( s[l], offs[j], px_D, py_D ) ;
+        if ( x1[j]   != px   || y1[j]   != py   ||
+             x2[j]   != px   || y2[j]   != py   ||
+             x1_D[j] != px_D || y1_D[j] != py_D ||
+             x2_D[j] != px_D || y2_D[j] != py_D ||
+             x[ij]   != px   || y[ij]   != py   ||
+             xb[ij]  != px   || yb[ij]  != py   ||
+             x_D[ij] != px_D || y_D[ij] != py_D ) ++ndiff_eval ;
+      }
+    }
+  }
+  cout << "multi offset eval:       " << ndiff_eval << " of " << neval
+       << " points differ from the single offset eval\n" ;
+
+  // bbTriangle and bbSplit, bitwise the same triangles and the sampled
+  // points of the offset curves inside them
+  Clothoid::indexType ntri = 0, ndiff_tri = 0, nsample = 0, nout = 0 ;
+  // the last one is split only where a segment turns pi/2 or more
+  Clothoid::valueType split[4][2] = { { m_pi/50, 1 }, { m_pi/10, 5 }, { m_pi/3, 100 }, { 2*m_pi, 1e6 } } ;
+  std::vector<Clothoid::ClothoidCurve> cs, c1 ;
+  std::vector<Clothoid::Triangle2D>    ts, t1 ;
+  for ( size_t i = 0 ; i < c.size() ; ++i ) {
+    for ( Clothoid::indexType m = 0 ; m < 4 ; ++m ) {
+      c[i].bbSplit( split[m][0], split[m][1], n_offs, offs, cs, ts ) ;
+      if ( ts.size() != cs.size()*n_offs ) { ++ndiff_tri ; continue ; }
+      for ( Clothoid::indexType j = 0 ; j < n_offs ; ++j ) {
+        c[i].bbSplit( split[m][0], split[m][1], offs[j], c1, t1 ) ;
+        if ( c1.size() != cs.size() ) { ++ndiff_tri ; continue ; }
+        for ( size_t l = 0 ; l < cs.size() ; ++l, ++ntri ) {
+          Clothoid::Triangle2D const & t = ts[l*n_offs+j] ;
+          Clothoid::Triangle2D tt ;
+          if ( !cs[l].bbTriangle( offs[j], tt ) ) ++ndiff_tri ;
+          if ( c1[l].getSmin() != cs[l].getSmin() ||
+               c1[l].getSmax() != cs[l].getSmax() ||
+               !same( t, t1[l] ) || !same( t, tt ) ) ++ndiff_tri ;
+          Clothoid::valueType a = cs[l].getSmin(), b = cs[l].getSmax() ;
+          for ( Clothoid::indexType k = 0 ; k <= 100 ; ++k, ++nsample ) {
+            Clothoid::valueType x, y ;
+            cs[l].eval( a+(b-a)*k/100, offs[j], x, y ) ;
+            if ( !inside( t, x, y, 1e-9*(1+std::abs(x)+std::abs(y)) ) ) ++nout ;
+          }
+        }
+      }
+      // the triangles of a segment for all the offsets
+      for ( size_t l = 0 ; l < cs.size() ; ++l ) {
+        Clothoid::Triangle2D tm[n_offs] ;
+        cs[l].bbTriangle( n_offs, offs, tm ) ;
+        for ( Clothoid::indexType j = 0 ; j < n_offs ; ++j ) {
+          if ( !same( ts[l*n_offs+j], tm[j] ) ) ++ndiff_tri ;
+        }
+      }
+    }
+  }
+  cout << "multi offset bbSplit:    " << ndiff_tri << " of " << ntri
+       << " triangles differ from the single offset ones\n"
+       << "points out of triangles: " << nout << " of " << nsample << '\n' ;
+
+  // ClothoidEvaluator, the same bits of the ClothoidCurve methods on the
+  // three branches of the Fresnel integrals: a = dk*s^2 zero, small, large
+  Clothoid::indexType npts = 0, ndiff_ev = 0 ;
+  for ( Clothoid::indexType i = 0 ; i < 3000 ; ++i ) {
+    Clothoid::valueType k  = i % 4 == 0 ? 0 : 0.2*(rnd()-0.5) ;
+    Clothoid::valueType dk = 0 ;
+    switch ( i % 3 ) {
+      case 1: dk = 1e-7*(rnd()-0.5) ; break ; // |a| < A_THRESOLD
+      case 2: dk = 0.01*(rnd()-0.5) ; break ;
+    }
+    Clothoid::valueType s_min = i % 5 == 0 ? -30*rnd() : 0 ;
+    Clothoid::ClothoidCurve cc( 100*(rnd()-0.5), 100*(rnd()-0.5), 2*m_pi*(rnd()-0.5),
+                                k, dk, s_min, s_min+5+50*rnd() ) ;
+    Clothoid::ClothoidEvaluator e( cc ) ;
+    for ( Clothoid::indexType l = 0 ; l <= 20 ; ++l, ++npts ) {
+      Clothoid::valueType ss = cc.getSmin() + (cc.getSmax()-cc.getSmin())*l/20 ;
+      Clothoid::valueType os = 2*(rnd()-0.5) ;
+      Clothoid::valueType a[20], b[20] ;
+      cc.eval( ss, a[0], a[1], a[2], a[3] ) ;    e.eval( ss, b[0], b[1], b[2], b[3] ) ;
+      cc.eval( ss, a[4], a[5] ) ;                e.eval( ss, b[4], b[5] ) ;
+      cc.eval_D( ss, a[6], a[7] ) ;              e.eval_D( ss, b[6], b[7] ) ;
+      cc.eval_DD( ss, a[8], a[9] ) ;             e.eval_DD( ss, b[8], b[9] ) ;
+      cc.eval_DDD( ss, a[10], a[11] ) ;          e.eval_DDD( ss, b[10], b[11] ) ;
+      cc.eval( ss, os, a[12], a[13] ) ;          e.eval( ss, os, b[12], b[13] ) ;
+      cc.eval_D( ss, os, a[14], a[15] ) ;        e.eval_D( ss, os, b[14], b[15] ) ;
+      cc.eval_DD( ss, os, a[16], a[17] ) ;       e.eval_DD( ss, os, b[16], b[17] ) ;
+      cc.eval_DDD( ss, os, a[18], a[19] ) ;      e.eval_DDD( ss, os, b[18], b[19] ) ;
+      bool ok = equal( a, a+20, b ) ;
+      Clothoid::valueType px, py, px_D, py_D ;
+      e.eval( ss, os, px, py, px_D, py_D ) ;
+      ok = ok && px == a[12] && py == a[13] && px_D == a[14] && py_D == a[15] ;
+      if ( !ok ) ++ndiff_ev ;
+    }
+    Clothoid::Triangle2D ta, tb ;
+    bool oka = cc.bbTriangle( 0.5, ta ) ;
+    bool okb = e.bbTriangle( cc.getSmin(), cc.getSmax(), 0.5, tb ) ;
+    if ( oka != okb || ( oka && !same( ta, tb ) ) ) ++ndiff_ev ;
+  }
+  cout << "ClothoidEvaluator:       " << ndiff_ev << " of " << npts
+       << " points differ from ClothoidCurve\n" ;
+
+  return ndiff_eval+ndiff_tri+nout+ndiff_ev > 0 ? 1 : 0 ;
+}
@@ -0,0 +1,175 @@
+#include "Clothoid.hh"
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <cmath>
+
+Clothoid::valueType m_pi = 3.14159265358979323846264338328 ;
+
+using namespace std ;
+
+static
+Clothoid::valueType
+rnd() {
+  return rand()/Clothoid::valueType(RAND_MAX) ;
+}
+
+static
+bool
+same( Clothoid::ClothoidCurve const & a, Clothoid::ClothoidCurve const & b ) {
+  return a.getX0()      == b.getX0()      && a.getY0()      == b.getY0()      &&
+         a.getTheta0()  == b.getTheta0()  && a.getKappa()   == b.getKappa()   &&
+         a.getKappa_D() == b.getKappa_D() && a.getSmin()    == b.getSmin()    &&
+         a.getSmax()    == b.getSmax() ;
+}
+
+// number of curves of the batch different from c
+static
+Clothoid::indexType
+compare( Clothoid::ClothoidBatch const & B, vector<Clothoid::ClothoidCurve> const & c ) {
+  Clothoid::indexType ndiff = B.size() == Clothoid::indexType(c.size()) ? 0 : 1 ;
+  for ( Clothoid::indexType i = 0 ; i < B.size() && i < Clothoid::indexType(c.size()) ; ++i ) {
+    Clothoid::ClothoidCurve ci ;
+    B.get( i, ci ) ;
+    if ( !same( ci, c[i] ) ) ++ndiff ;
+  }
+  return ndiff ;
+}
+
+// map tile of curves: ClothoidBatch vs loops on ClothoidCurve
+int
+main() {
+  Clothoid::indexType const N = 100000 ;
+  vector<Clothoid::ClothoidCurve> c ;
+  srand(1) ;
+  for ( Clothoid::indexType i = 0 ; i < N ; ++i ) {
+    Clothoid::valueType r = rnd() ;
+    Clothoid::valueType k = 0, dk = 0 ;
+    if      ( r > 0.85 ) { k = 0.01*(r-0.9) ; dk = 1e-4*(r-0.92) ; }
+    else if ( r > 0.5  ) { k = 0.02*(r-0.7) ; }
+    // angles in (-pi,pi], some exactly 0 and pi
+    Clothoid::valueType th = i % 100 == 0 ? 0 : ( i % 100 == 1 ? m_pi : m_pi*(1-2*rnd()) ) ;
+    c.push_back( Clothoid::ClothoidCurve( 1000*rnd(), 1000*rnd(), th, k, dk, 20+80*rnd() ) ) ;
+  }
+  Clothoid::indexType nfail = 0 ;
+
+  // conversions
+  Clothoid::ClothoidBatch B( c ), V ;
+  vector<Clothoid::ClothoidCurve> cs, cv( c ) ;
+  V.view( cv ) ;
+  B.store( cs ) ;
+  Clothoid::indexType nconv = compare( B, c ) + compare( V, c ) ;
+  for ( Clothoid::indexType i = 0 ; i < N ; ++i ) if ( !same( cs[i], c[i] ) ) ++nconv ;
+  cout << "load/store/view:       " << nconv << " different curves\n" ;
+  nfail += nconv ;
+
+  // evaluation, the same bits of ClothoidCurve::eval
+  vector<Clothoid::valueType> s(N), x(N), y(N), xo(N), yo(N), th(N), ka(N) ;
+  for ( Clothoid::indexType i = 0 ; i < N ; ++i ) s[i] = c[i].getSmax()*rnd() ;
+  Clothoid::indexType neval = 0 ;
+  for ( Clothoid::indexType m = 0 ; m < 2 ; ++m ) {
+    Clothoid::ClothoidBatch const & b = m == 0 ? B : V ;
+    b.eval( &s.front(), &x.front(), &y.front() ) ;
+    b.eval( &s.front(), 1.5, &xo.front(), &yo.front() ) ;
+    for ( Clothoid::indexType i = 0 ; i < N ; ++i ) {
+      Clothoid::valueType px, py, qx, qy ;
+      c[i].eval( s[i], px, py ) ;
+      c[i].eval( s[i], 1.5, qx, qy ) ;
+      if ( x[i] != px || y[i] != py || xo[i] != qx || yo[i] != qy ) ++neval ;
+    }
+    b.eval( &s.front(), &th.front(), &ka.front(), &x.front(), &y.front() ) ;
+    for ( Clothoid::indexType i = 0 ; i < N ; ++i ) {
+      Clothoid::valueType pth, pka, px, py ;
+      c[i].eval( s[i], pth, pka, px, py ) ;
+      if ( th[i] != pth || ka[i] != pka || x[i] != px || y[i] != py ) ++neval ;
+    }
+  }
+  cout << "eval:                  " << neval << " different values\n" ;
+  nfail += neval ;
+
+  // transformations, the same bits of the ClothoidCurve methods
+  // on the owned storage and on the viewed array
+  Clothoid::indexType ntrans = 0 ;
+  vector<Clothoid::ClothoidCurve> cr( c ) ;
+  for ( Clothoid::indexType i = 0 ; i < N ; ++i ) cr[i].rotate( 0.7, 10, -20 ) ;
+  B.rotate( 0.7, 10, -20 ) ; V.rotate( 0.7, 10, -20 ) ;
+  ntrans += compare( B, cr ) + compare( V, cr ) ;
+  for ( Clothoid::indexType i = 0 ; i < N ; ++i ) cr[i].translate( 3, -4 ) ;
+  B.translate( 3, -4 ) ; V.translate( 3, -4 ) ;
+  ntrans += compare( B, cr ) + compare( V, cr ) ;
+  for ( Clothoid::indexType i = 0 ; i < N ; ++i ) cr[i].scale( 1.3 ) ;
+  B.scale( 1.3 ) ; V.scale( 1.3 ) ;
+  ntrans += compare( B, cr ) + compare( V, cr ) ;
+  // reverse from the original angles, including 0 and pi
+  B.load( c ) ; V.view( cv ) ;
+  for ( Clothoid::indexType i = 0 ; i < N ; ++i ) cv[i] = cr[i] = c[i] ;
+  for ( Clothoid::indexType rep = 0 ; rep < 2 ; ++rep ) {
+    for ( Clothoid::indexType i = 0 ; i < N ; ++i ) cr[i].reverse() ;
+    B.reverse() ; V.reverse() ;
+    ntrans += compare( B, cr ) + compare( V, cr ) ;
+  }
+  // the view changes the viewed curves
+  for ( Clothoid::indexType i = 0 ; i < N ; ++i ) if ( !same( cv[i], cr[i] ) ) ++ntrans ;
+  // the evaluation after the transformations uses the new angles
+  for ( Clothoid::indexType m = 0 ; m < 2 ; ++m ) {
+    Clothoid::ClothoidBatch const & b = m == 0 ? B : V ;
+    b.eval( &s.front(), 1.5, &xo.front(), &yo.front() ) ;
+    for ( Clothoid::indexType i = 0 ; i < N ; ++i ) {
+      Clothoid::valueType qx, qy ;
+      cr[i].eval( s[i], 1.5, qx, qy ) ;
+      if ( xo[i] != qx || yo[i] != qy ) ++ntrans ;
+    }
+  }
+  Clothoid::indexType nrange = 0 ;
+  for ( Clothoid::indexType i = 0 ; i < N ; ++i ) {
+    Clothoid::valueType a = B.getTheta0(i) ;
+    if ( !( a > -m_pi && a <= m_pi ) ) ++nrange ;
+  }
+  cout << "transformations:       " << ntrans << " different curves, "
+       << nrange << " angles out of (-pi,pi]\n" ;
+  nfail += ntrans + nrange ;
+
+  // timing of the bulk operations
+  Clothoid::indexType const nrep = 50 ;
+  clock_t t0 = clock() ;
+  for ( Clothoid::indexType rep = 0 ; rep < nrep ; ++rep )
+    for ( Clothoid::indexType i = 0 ; i < N ; ++i ) {
+      cr[i].rotate( 1e-3, 500, 500 ) ;
+      cr[i].translate( 1e-3, -1e-3 ) ;
+      cr[i].reverse() ;
+    }
+  clock_t t1 = clock() ;
+  for ( Clothoid::indexType rep = 0 ; rep < nrep ; ++rep ) {
+    B.rotate( 1e-3, 500, 500 ) ;
+    B.translate( 1e-3, -1e-3 ) ;
+    B.reverse() ;
+  }
+  clock_t t2 = clock() ;
+  for ( Clothoid::indexType rep = 0 ; rep < nrep ; ++rep ) {
+    V.rotate( 1e-3, 500, 500 ) ;
+    V.translate( 1e-3, -1e-3 ) ;
+    V.reverse() ;
+  }
+  clock_t t3 = clock() ;
+  cout << "rotate+translate+reverse, " << nrep << " x " << N << " curves\n"
+       << "  ClothoidCurve loop:  " << 1e3*(t1-t0)/CLOCKS_PER_SEC << " ms\n"
+       << "  ClothoidBatch:       " << 1e3*(t2-t1)/CLOCKS_PER_SEC << " ms\n"
+       << "  ClothoidBatch view:  " << 1e3*(t3-t2)/CLOCKS_PER_SEC << " ms\n" ;
+
+  t0 = clock() ;
+  for ( Clothoid::indexType rep = 0 ; rep < 10 ; ++rep )
+    for ( Clothoid::indexType i = 0 ; i < N ; ++i )
+      cr[i].eval( s[i], 1.5, xo[i], yo[i] ) ;
+  t1 = clock() ;
+  for ( Clothoid::indexType rep = 0 ; rep < 10 ; ++rep )
+    B.eval( &s.front(), 1.5, &xo.front(), &yo.front() ) ;
+  t2 = clock() ;
+  for ( Clothoid::indexType rep = 0 ; rep < 10 ; ++rep )
+    V.eval( &s.front(), 1.5, &xo.front(), &yo.front() ) ;
+  t3 = clock() ;
+  cout << "offset eval, 10 x " << N << " curves\n"
+       << "  ClothoidCurve loop:  " << 1e3*(t1-t0)/CLOCKS_PER_SEC << " ms\n"
+       << "  ClothoidBatch:       " << 1e3*(t2-t1)/CLOCKS_PER_SEC << " ms\n"
+       << "  ClothoidBatch view:  " << 1e3*(t3-t2)/CLOCKS_PER_SEC << " ms\n" ;
+  return nfail > 0 ? 1 : 0 ;
+}
@@ -0,0 +1,349 @@
+#include "Clothoid.hh"
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <cmath>
+
+Clothoid::valueType m_pi = 3.14159265358979323846264338328 ;
+
+using namespace std ;
+
+// benchmark on a road like mix: 50% segments, 35% circle arcs, 15% clothoids
+static
+void
+buildRoad( Clothoid::indexType n, std::vector<Clothoid::ClothoidCurve> & road ) {
+  Clothoid::valueType x = 0, y = 0, th = 0 ;
+  road.clear() ;
+  srand(1) ;
+  for ( Clothoid::indexType i = 0 ; i < n ; ++i ) {
+    Clothoid::valueType L = 20 + 80*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::valueType r = rand()/Clothoid::valueType(RAND_MAX) ;
+    Clothoid::valueType k = 0, dk = 0 ;
+    if      ( r > 0.85 ) { k = 0.01*(r-0.9) ; dk = 1e-4*(r-0.92) ; }
+    else if ( r > 0.5  ) { k = 0.02*(r-0.7) ; }
+    Clothoid::ClothoidCurve c( x, y, th, k, dk, L ) ;
+    road.push_back(c) ;
+    Clothoid::valueType kappa ;
+    c.eval( L, th, kappa, x, y ) ;
+  }
+}
+
+// pairs of abscissae sorted by the first one
+static
+void
+sortPairs( std::vector<Clothoid::valueType> & s1, std::vector<Clothoid::valueType> & s2 ) {
+  for ( size_t i = 1 ; i < s1.size() ; ++i )
+    for ( size_t j = i ; j > 0 && s1[j-1] > s1[j] ; --j ) {
+      std::swap( s1[j-1], s1[j] ) ;
+      std::swap( s2[j-1], s2[j] ) ;
+    }
+}
+
+// the configuration moved around 100 times, the contacts are not exact
+// in floating point; return the number of wrong results
+static
+Clothoid::indexType
+checkContact( Clothoid::ClothoidCurve const & a,
+              Clothoid::valueType             offs_a,
+              Clothoid::ClothoidCurve const & b,
+              Clothoid::valueType             offs_b,
+              Clothoid::indexType             n,
+              Clothoid::valueType const       e1[],
+              Clothoid::valueType const       e2[] ) {
+  std::vector<Clothoid::valueType> s1, s2 ;
+  Clothoid::indexType nwrong = 0 ;
+  for ( Clothoid::indexType rep = 0 ; rep < 100 ; ++rep ) {
+    Clothoid::valueType angle = 2*m_pi*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::valueType dx    = 1000*(rand()/Clothoid::valueType(RAND_MAX)-0.5) ;
+    Clothoid::valueType dy    = 1000*(rand()/Clothoid::valueType(RAND_MAX)-0.5) ;
+    Clothoid::ClothoidCurve ra(a), rb(b) ;
+    ra.rotate( angle, 0, 0 ) ; ra.translate( dx, dy ) ;
+    rb.rotate( angle, 0, 0 ) ; rb.translate( dx, dy ) ;
+    ra.intersect( offs_a, rb, offs_b, s1, s2, 20, 1e-10 ) ;
+    bool ok = Clothoid::indexType(s1.size()) == n ;
+    for ( Clothoid::indexType k = 0 ; ok && k < n ; ++k )
+      ok = std::abs(s1[k]-e1[k]) <= 1e-8 && std::abs(s2[k]-e2[k]) <= 1e-8 ;
+    if ( !ok ) ++nwrong ;
+  }
+  return nwrong ;
+}
+
+int
+main() {
+  std::vector<Clothoid::ClothoidCurve> road, road2 ;
+  buildRoad( 2000, road ) ;
+  road2 = road ;
+  for ( Clothoid::indexType i = 0 ; i < Clothoid::indexType(road2.size()) ; ++i )
+    road2[i].rotate( m_pi/3, 1000, 0 ) ;
+
+  // the same roads with a curvature derivative of 1e-300 on the segments
+  // and arcs, evaluated and intersected by the generic path
+  std::vector<Clothoid::ClothoidCurve> roadg[2] ;
+  std::vector<Clothoid::ClothoidCurve> const * roads[2][2] = {
+    { &road, &road2 }, { &roadg[0], &roadg[1] }
+  } ;
+  for ( Clothoid::indexType k = 0 ; k < 2 ; ++k ) {
+    std::vector<Clothoid::ClothoidCurve> const & rk = *roads[0][k] ;
+    for ( size_t i = 0 ; i < rk.size() ; ++i ) {
+      Clothoid::ClothoidCurve const & c = rk[i] ;
+      roadg[k].push_back( Clothoid::ClothoidCurve( c.getX0(), c.getY0(), c.getTheta0(), c.getKappa(),
+                                                   c.getKappa_D() == 0 ? 1e-300 : c.getKappa_D(),
+                                                   c.getSmin(), c.getSmax() ) ) ;
+    }
+  }
+  char const * path_name[2] = { "closed form", "generic    " } ;
+
+  // evaluation
+  std::vector<Clothoid::valueType> s1, s2 ;
+  clock_t t0, t1 ;
+  for ( Clothoid::indexType m = 0 ; m < 2 ; ++m ) {
+    std::vector<Clothoid::ClothoidCurve> const & rd = *roads[m][0] ;
+    Clothoid::valueType sum = 0 ;
+    t0 = clock() ;
+    for ( Clothoid::indexType rep = 0 ; rep < 20 ; ++rep ) {
+      for ( Clothoid::indexType i = 0 ; i < Clothoid::indexType(rd.size()) ; ++i ) {
+        Clothoid::ClothoidCurve const & c = rd[i] ;
+        for ( Clothoid::indexType j = 0 ; j <= 50 ; ++j ) {
+          Clothoid::valueType x, y ;
+          c.eval( c.getSmin() + j*(c.getSmax()-c.getSmin())/50, 0.5, x, y ) ;
+          sum += x+y ;
+        }
+      }
+    }
+    t1 = clock() ;
+    cout << "eval, " << path_name[m] << ":      " << 1e3*(t1-t0)/CLOCKS_PER_SEC
+         << " ms (checksum " << sum << ")\n" ;
+  }
+
+  // intersection of all pairs with overlapping end points box
+  for ( Clothoid::indexType m = 0 ; m < 2 ; ++m ) {
+    std::vector<Clothoid::ClothoidCurve> const & ra = *roads[m][0] ;
+    std::vector<Clothoid::ClothoidCurve> const & rb = *roads[m][1] ;
+    Clothoid::indexType nint = 0, npairs = 0 ;
+    t0 = clock() ;
+    for ( Clothoid::indexType i = 0 ; i < Clothoid::indexType(ra.size()) ; ++i ) {
+      for ( Clothoid::indexType j = 0 ; j < Clothoid::indexType(rb.size()) ; ++j ) {
+        Clothoid::valueType xa0, ya0, xa1, ya1, xb0, yb0, xb1, yb1 ;
+        ra[i].eval( ra[i].getSmin(), xa0, ya0 ) ;
+        ra[i].eval( ra[i].getSmax(), xa1, ya1 ) ;
+        rb[j].eval( rb[j].getSmin(), xb0, yb0 ) ;
+        rb[j].eval( rb[j].getSmax(), xb1, yb1 ) ;
+        if ( std::abs(xa0-xb0) > 200 || std::abs(ya0-yb0) > 200 ) continue ;
+        ++npairs ;
+        ra[i].intersect( 0, rb[j], 0, s1, s2, 20, 1e-10 ) ;
+        nint += Clothoid::indexType(s1.size()) ;
+      }
+    }
+    t1 = clock() ;
+    cout << "intersect, " << path_name[m] << ": " << 1e3*(t1-t0)/CLOCKS_PER_SEC << " ms ("
+         << npairs << " pairs, " << nint << " intersections)\n" ;
+  }
+
+  // closed form against the numerical path on random segments and arcs, a
+  // curvature derivative of 1e-300 forces the numerical path on the same curves
+  std::vector<Clothoid::ClothoidCurve> la ;
+  for ( Clothoid::indexType i = 0 ; i < 200 ; ++i ) {
+    Clothoid::valueType r = rand()/Clothoid::valueType(RAND_MAX) ;
+    la.push_back( Clothoid::ClothoidCurve( 100*(rand()/Clothoid::valueType(RAND_MAX)),
+                                           100*(rand()/Clothoid::valueType(RAND_MAX)),
+                                           2*m_pi*(rand()/Clothoid::valueType(RAND_MAX)),
+                                           r > 0.5 ? 0.2*(r-0.75) : 0, 0,
+                                           20+60*(rand()/Clothoid::valueType(RAND_MAX)) ) ) ;
+  }
+  std::vector<Clothoid::valueType> r1, r2 ;
+  Clothoid::indexType nla = 0, nla_int = 0, nla_diff = 0 ;
+  Clothoid::valueType la_err = 0 ;
+  for ( Clothoid::indexType i = 0 ; i < Clothoid::indexType(la.size()) ; ++i ) {
+    Clothoid::ClothoidCurve const & a = la[i] ;
+    Clothoid::ClothoidCurve na( a.getX0(), a.getY0(), a.getTheta0(), a.getKappa(), 1e-300,
+                                a.getSmin(), a.getSmax() ) ;
+    for ( Clothoid::indexType j = i+1 ; j < Clothoid::indexType(la.size()) ; ++j, ++nla ) {
+      a.intersect( 0.5, la[j], -0.5, s1, s2, 20, 1e-10 ) ;
+      na.intersect( 0.5, la[j], -0.5, r1, r2, 20, 1e-10 ) ;
+      sortPairs( r1, r2 ) ;
+      nla_int += Clothoid::indexType(s1.size()) ;
+      if ( s1.size() != r1.size() ) { ++nla_diff ; continue ; }
+      for ( size_t k = 0 ; k < s1.size() ; ++k )
+        la_err = max( la_err, max( std::abs(s1[k]-r1[k]), std::abs(s2[k]-r2[k]) ) ) ;
+    }
+  }
+  cout << "closed form vs numerical: " << nla << " pairs, " << nla_int
+       << " intersections, " << nla_diff << " different, max difference " << la_err << '\n' ;
+
+  // tangent contacts, collinear segments and arcs of the same circle
+  Clothoid::ClothoidCurve arc0( 10, 0, m_pi/2, 0.1, 0, 10*m_pi ) ;      // center (0,0), r 10, upper half
+  Clothoid::ClothoidCurve arc1( -10, 20, 1.5*m_pi, 0.1, 0, 10*m_pi ) ;  // center (0,20), lower half
+  Clothoid::ClothoidCurve arc2( 5, 5, m_pi/2, 0.2, 0, 5*m_pi ) ;        // center (0,5), upper half
+  Clothoid::ClothoidCurve arc3( 0, 10, m_pi, 0.1, 0, 10*m_pi ) ;        // center (0,0), left half
+  Clothoid::ClothoidCurve arc4( 0, 8, m_pi, 0.125, 0, 8*m_pi ) ;        // center (0,0), r 8, left half
+  Clothoid::ClothoidCurve seg0( -5, 10, 0, 0, 0, 10 ) ;                 // y = 10
+  Clothoid::ClothoidCurve seg1( -5, 8, 0, 0, 0, 10 ) ;                  // y = 8
+  Clothoid::ClothoidCurve seg2( 0, 0, 0.3, 0, 0, 10 ) ;
+  Clothoid::ClothoidCurve seg3( 5*cos(0.3), 5*sin(0.3), 0.3, 0, 0, 10 ) ;
+  Clothoid::ClothoidCurve seg4( 12*cos(0.3), 12*sin(0.3), 0.3+m_pi, 0, 0, 10 ) ;
+  Clothoid::ClothoidCurve seg5( 0, 0, 0, 0, 0, 10 ) ;
+  Clothoid::ClothoidCurve seg6( 5, -5, m_pi/2, 0, 0, 5 ) ;              // ends on seg5
+  Clothoid::valueType pi5 = 5*m_pi, pi10 = 10*m_pi ;
+  Clothoid::valueType e[][4] = {
+    { 5, pi5 },                 // segment tangent to an arc
+    { 5, pi5 },                 // segment tangent to an offset arc
+    { pi5, pi5 },               // arcs tangent outside
+    { pi5, 2.5*m_pi },          // arcs tangent inside
+    { 5, 10, 0, 5 },            // collinear segments
+    { 2, 10, 10, 2 },           // collinear segments, opposite directions
+    { pi5, pi10, 0, pi5 },      // arcs of the same circle
+    { pi5, pi10, 0, 4*m_pi },   // offset arc on the circle of another arc
+    { 5, 5 }                    // end point on a segment
+  } ;
+  Clothoid::indexType ncontact[9] = {
+    checkContact( seg0, 0, arc0, 0, 1, e[0], e[0]+1 ),
+    checkContact( seg1, 0, arc0, 2, 1, e[1], e[1]+1 ),
+    checkContact( arc0, 0, arc1, 0, 1, e[2], e[2]+1 ),
+    checkContact( arc0, 0, arc2, 0, 1, e[3], e[3]+1 ),
+    checkContact( seg2, 0, seg3, 0, 2, e[4], e[4]+2 ),
+    checkContact( seg2, 0, seg4, 0, 2, e[5], e[5]+2 ),
+    checkContact( arc0, 0, arc3, 0, 2, e[6], e[6]+2 ),
+    checkContact( arc0, 2, arc4, 0, 2, e[7], e[7]+2 ),
+    checkContact( seg5, 0, seg6, 0, 1, e[8], e[8]+1 )
+  } ;
+  Clothoid::indexType nwrong = 0 ;
+  for ( Clothoid::indexType k = 0 ; k < 9 ; ++k ) nwrong += ncontact[k] ;
+  cout << "tangent and overlapping curves: " << nwrong << " wrong of 900\n" ;
+
+  // refinement of the numerical path: a clothoid and its mirror image on
+  // the x axis meet only on the axis, the roots are the sign changes of y,
+  // the distance of the points is within the tolerance at every root
+  Clothoid::indexType nmirror = 0, nmirror_wrong = 0 ;
+  for ( Clothoid::indexType i = 0 ; i < 400 ; ++i ) {
+    Clothoid::valueType th = -0.2-0.6*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::valueType k  = 0.02+0.1*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::valueType dk = 2e-3*(rand()/Clothoid::valueType(RAND_MAX)-0.5) ;
+    Clothoid::valueType L  = 10+20*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::valueType y0 = 4*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::ClothoidCurve a( 0, y0, th, k, dk, L ), b( 0, -y0, -th, -k, -dk, L ) ;
+    Clothoid::indexType nsign = 0 ;
+    Clothoid::valueType ymin = HUGE_VAL, yprev = y0 ;
+    for ( Clothoid::indexType l = 1 ; l <= 4000 ; ++l ) {
+      Clothoid::valueType x, y ;
+      a.eval( L*l/4000, x, y ) ;
+      if ( (y > 0) != (yprev > 0) ) ++nsign ;
+      ymin  = min( ymin, std::abs(y) ) ;
+      yprev = y ;
+    }
+    if ( ymin < 1e-3 ) continue ; // close to a tangent contact or to an end point
+    ++nmirror ;
+    a.intersect( 0, b, 0, s1, s2, 20, 1e-10 ) ;
+    bool ok = Clothoid::indexType(s1.size()) == nsign ;
+    for ( size_t l = 0 ; l < s1.size() ; ++l ) {
+      Clothoid::valueType xa, ya, xb, yb ;
+      a.eval( s1[l], xa, ya ) ;
+      b.eval( s2[l], xb, yb ) ;
+      ok = ok && hypot( xb-xa, yb-ya ) <= 1e-10 && std::abs(s1[l]-s2[l]) <= 1e-8 ;
+    }
+    if ( !ok ) ++nmirror_wrong ;
+  }
+  cout << "clothoid and mirror image: " << nmirror_wrong << " wrong of " << nmirror << '\n' ;
+
+  // junctions: a curve starting or ending on another curve, or a curve
+  // through the start or the end point of another, exactly one root
+  Clothoid::indexType njunction_wrong = 0 ;
+  for ( Clothoid::indexType i = 0 ; i < 400 ; ++i ) {
+    Clothoid::valueType L  = 10+20*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::ClothoidCurve a( 100*(rand()/Clothoid::valueType(RAND_MAX)),
+                               100*(rand()/Clothoid::valueType(RAND_MAX)),
+                               2*m_pi*(rand()/Clothoid::valueType(RAND_MAX)),
+                               0.1*(rand()/Clothoid::valueType(RAND_MAX)-0.5),
+                               2e-3*(rand()/Clothoid::valueType(RAND_MAX)-0.5), L ) ;
+    Clothoid::valueType ss = L*(0.1+0.8*(rand()/Clothoid::valueType(RAND_MAX))) ;
+    Clothoid::valueType sb[2] = { 0, 5 } ; // b on a at its start
+    switch ( i % 4 ) {
+      case 1: sb[0] = -5 ; sb[1] = 0 ; break ;                 // b on a at its end
+      case 2: ss = 0 ; sb[0] = -2.5 ; sb[1] = 2.5 ; break ;    // b through the start of a
+      case 3: ss = L ; sb[0] = -2.5 ; sb[1] = 2.5 ; break ;    // b through the end of a
+    }
+    Clothoid::valueType th, kappa, x, y ;
+    a.eval( ss, th, kappa, x, y ) ;
+    th += 0.3+(m_pi-0.6)*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::ClothoidCurve b( x, y, th, 0.1*(rand()/Clothoid::valueType(RAND_MAX)-0.5),
+                               2e-3*(rand()/Clothoid::valueType(RAND_MAX)-0.5), sb[0], sb[1] ) ;
+    a.intersect( 0, b, 0, s1, s2, 20, 1e-10 ) ;
+    Clothoid::indexType nj = 0 ;
+    for ( size_t l = 0 ; l < s1.size() ; ++l )
+      if ( std::abs(s1[l]-ss) <= 1e-8 && std::abs(s2[l]) <= 1e-8 ) ++nj ;
+    if ( nj != 1 ) ++njunction_wrong ;
+  }
+  cout << "junctions: " << njunction_wrong << " wrong of 400\n" ;
+
+  // splitting in vectors and in preallocated arrays
+  std::vector<Clothoid::ClothoidCurve> cv ;
+  std::vector<Clothoid::Triangle2D>    tv ;
+  Clothoid::indexType nseg = 0 ;
+  t0 = clock() ;
+  for ( Clothoid::indexType rep = 0 ; rep < 20 ; ++rep ) {
+    for ( Clothoid::indexType i = 0 ; i < Clothoid::indexType(road.size()) ; ++i ) {
+      Clothoid::ClothoidCurve const & c = road[i] ;
+      c.bbSplit( m_pi/50, (c.getSmax()-c.getSmin())/30, 0.5, cv, tv ) ;
+      nseg += Clothoid::indexType(cv.size()) ;
+    }
+  }
+  t1 = clock() ;
+  cout << "bbSplit:   " << 1e3*(t1-t0)/CLOCKS_PER_SEC << " ms (" << nseg << " segments)\n" ;
+
+  Clothoid::indexType const capacity = 1024 ;
+  std::vector<Clothoid::ClothoidCurve> ca(capacity) ;
+  std::vector<Clothoid::Triangle2D>    ta(capacity) ;
+  Clothoid::indexType nseg1 = 0, needed = 0 ;
+  t0 = clock() ;
+  for ( Clothoid::indexType rep = 0 ; rep < 20 ; ++rep ) {
+    for ( Clothoid::indexType i = 0 ; i < Clothoid::indexType(road.size()) ; ++i ) {
+      Clothoid::ClothoidCurve const & c = road[i] ;
+      Clothoid::indexType n = c.bbSplit( m_pi/50, (c.getSmax()-c.getSmin())/30, 0.5,
+                                         &ca.front(), &ta.front(), capacity ) ;
+      if ( n > needed ) needed = n ;
+      nseg1 += n ;
+    }
+  }
+  t1 = clock() ;
+  cout << "bbSplit[]: " << 1e3*(t1-t0)/CLOCKS_PER_SEC << " ms (" << nseg1
+       << " segments, max capacity needed " << needed << ")\n" ;
+  // monotone pieces, the curve must be inside the box of the piece
+  std::vector<Clothoid::BBox2D> bv ;
+  Clothoid::indexType npieces = 0, nout = 0 ;
+  t0 = clock() ;
+  for ( Clothoid::indexType rep = 0 ; rep < 20 ; ++rep ) {
+    for ( Clothoid::indexType i = 0 ; i < Clothoid::indexType(road.size()) ; ++i ) {
+      road[i].monotoneSplit( 0.5, cv, bv ) ;
+      npieces += Clothoid::indexType(cv.size()) ;
+    }
+  }
+  t1 = clock() ;
+  Clothoid::ClothoidCurve spiral( 0, 0, 0, -0.5, 0.002, 0, 800 ) ;
+  spiral.bbSplit( m_pi/50, 800/3.0, 0.5, ca, ta ) ;
+  Clothoid::indexType nspiral = Clothoid::indexType(ca.size()) ;
+  road.push_back( spiral ) ;
+  for ( Clothoid::indexType i = 0 ; i < Clothoid::indexType(road.size()) ; ++i ) {
+    for ( Clothoid::valueType offs = -2 ; offs <= 2 ; offs += 2 ) {
+      road[i].monotoneSplit( offs, cv, bv ) ;
+      for ( size_t j = 0 ; j < cv.size() ; ++j ) {
+        for ( Clothoid::indexType k = 0 ; k <= 20 ; ++k ) {
+          Clothoid::valueType x, y ;
+          cv[j].eval( cv[j].getSmin() + k*(cv[j].getSmax()-cv[j].getSmin())/20, offs, x, y ) ;
+          Clothoid::valueType tol = 1e-10*(1+std::abs(x)+std::abs(y)) ;
+          if ( x < bv[j].xmin-tol || x > bv[j].xmax+tol ||
+               y < bv[j].ymin-tol || y > bv[j].ymax+tol ) ++nout ;
+        }
+      }
+    }
+  }
+  cout << "monotoneSplit: " << 1e3*(t1-t0)/CLOCKS_PER_SEC << " ms (" << npieces
+       << " pieces, " << nout << " points out of the boxes)\n"
+       << "spiral: " << cv.size() << " monotone pieces, "
+       << nspiral << " segments of bbSplit\n" ;
+
+  unsigned long n_calls, n_exact ;
+  Clothoid::orient2dStats( n_calls, n_exact ) ;
+  if ( n_calls > 0 )
+    cout << "orient2d: " << n_calls << " calls, " << n_exact << " exact ("
+         << (100.0*n_exact)/n_calls << "%)\n" ;
+  return nla_diff+nwrong+nmirror_wrong+njunction_wrong > 0 ? 1 : 0 ;
+}
@@ -0,0 +1,86 @@
+#include "Clothoid.hh"
+#include <iostream>
+#include <cmath>
+#include <ctime>
+
+using namespace std ;
+
+// analytic gradient of the points of a clothoid against finite differences
+static
+void
+fdGradient( Clothoid::valueType const par[6], // x0, y0, theta0, k, dk, s
+            Clothoid::valueType       offs,
+            Clothoid::valueType       x_grad[6],
+            Clothoid::valueType       y_grad[6] ) {
+  Clothoid::valueType x, y, xh, yh, p[6] ;
+  Clothoid::ClothoidCurve c( par[0], par[1], par[2], par[3], par[4], par[5] ) ;
+  c.eval( par[5], offs, x, y ) ;
+  for ( Clothoid::indexType j = 0 ; j < 6 ; ++j ) {
+    for ( Clothoid::indexType i = 0 ; i < 6 ; ++i ) p[i] = par[i] ;
+    Clothoid::valueType h = 1e-7*(1+std::abs(p[j])) ;
+    p[j] += h ;
+    Clothoid::ClothoidCurve ch( p[0], p[1], p[2], p[3], p[4], p[5] ) ;
+    ch.eval( p[5], offs, xh, yh ) ;
+    x_grad[j] = (xh-x)/h ;
+    y_grad[j] = (yh-y)/h ;
+  }
+}
+
+int
+main() {
+  Clothoid::valueType par[6] = { 1, -2, 0.3, 0.1, -0.01, 0 } ;
+  Clothoid::valueType offs = 1.5 ;
+  Clothoid::ClothoidCurve c( par[0], par[1], par[2], par[3], par[4], 30 ) ;
+
+  Clothoid::indexType const N = 100000 ;
+  Clothoid::valueType err = 0, err0 = 0, chk = 0 ;
+  for ( Clothoid::indexType i = 0 ; i <= 100 ; ++i ) {
+    Clothoid::valueType x, y, gx[6], gy[6], fx[6], fy[6] ;
+    par[5] = 0.3*i ;
+    c.eval_grad( par[5], offs, x, y, gx, gy ) ;
+    fdGradient( par, offs, fx, fy ) ;
+    for ( Clothoid::indexType j = 0 ; j < 6 ; ++j )
+      err = max( err, max( std::abs(gx[j]-fx[j]), std::abs(gy[j]-fy[j]) )/(1+std::abs(gx[j])+std::abs(gy[j])) ) ;
+    // without offset
+    c.eval_grad( par[5], x, y, gx, gy ) ;
+    fdGradient( par, 0, fx, fy ) ;
+    for ( Clothoid::indexType j = 0 ; j < 6 ; ++j )
+      err0 = max( err0, max( std::abs(gx[j]-fx[j]), std::abs(gy[j]-fy[j]) )/(1+std::abs(gx[j])+std::abs(gy[j])) ) ;
+  }
+  cout << "max relative difference analytic vs finite differences = " << err
+       << " (no offset " << err0 << ")\n" ;
+
+  // the batch form against the single point one
+  Clothoid::indexType const ns = 101 ;
+  Clothoid::valueType sb[ns], xb[ns], yb[ns], gxb[6*ns], gyb[6*ns], errb = 0 ;
+  for ( Clothoid::indexType i = 0 ; i < ns ; ++i ) sb[i] = 0.3*i ;
+  c.eval_grad( ns, sb, offs, xb, yb, gxb, gyb ) ;
+  for ( Clothoid::indexType i = 0 ; i < ns ; ++i ) {
+    Clothoid::valueType x, y, gx[6], gy[6] ;
+    c.eval_grad( sb[i], offs, x, y, gx, gy ) ;
+    errb = max( errb, max( std::abs(xb[i]-x), std::abs(yb[i]-y) ) ) ;
+    for ( Clothoid::indexType j = 0 ; j < 6 ; ++j )
+      errb = max( errb, max( std::abs(gxb[6*i+j]-gx[j]), std::abs(gyb[6*i+j]-gy[j]) ) ) ;
+  }
+  cout << "max difference batch vs single point = " << errb << '\n' ;
+
+  clock_t t0 = clock() ;
+  for ( Clothoid::indexType i = 0 ; i < N ; ++i ) {
+    Clothoid::valueType x, y, gx[6], gy[6] ;
+    c.eval_grad( 30.0*i/N, offs, x, y, gx, gy ) ;
+    chk += gx[3]+gy[4] ;
+  }
+  clock_t t1 = clock() ;
+  for ( Clothoid::indexType i = 0 ; i < N ; ++i ) {
+    Clothoid::valueType gx[6], gy[6] ;
+    par[5] = 30.0*i/N ;
+    fdGradient( par, offs, gx, gy ) ;
+    chk += gx[3]+gy[4] ;
+  }
+  clock_t t2 = clock() ;
+  cout << "analytic:           " << 1e3*(t1-t0)/CLOCKS_PER_SEC << " ms\n"
+       << "finite differences: " << 1e3*(t2-t1)/CLOCKS_PER_SEC << " ms"
+       << " (checksum " << chk << ")\n" ;
+  // forward differences are accurate to about sqrt(eps)
+  return err > 1e-4 || err0 > 1e-4 || errb > 1e-12 ? 1 : 0 ;
+}
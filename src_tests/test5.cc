@@ -0,0 +1,278 @@
+#include "Clothoid.hh"
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <cmath>
+
+Clothoid::valueType m_pi = 3.14159265358979323846264338328 ;
+
+using namespace std ;
+
+// a static winding curve queried with many short curves
+int
+main() {
+  // long spiral: the heading turns about 12 times
+  Clothoid::ClothoidCurve road( 0, 0, 0, -0.5, 0.002, 0, 800 ) ;
+
+  std::vector<Clothoid::ClothoidCurve> query ;
+  srand(1) ;
+  for ( Clothoid::indexType i = 0 ; i < 500 ; ++i ) {
+    Clothoid::valueType x  = -60 + 120*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::valueType y  = -60 + 120*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::valueType th = 2*m_pi*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::valueType k  = 0.1*(rand()/Clothoid::valueType(RAND_MAX)-0.5) ;
+    Clothoid::valueType dk = 0.01*(rand()/Clothoid::valueType(RAND_MAX)-0.5) ;
+    query.push_back( Clothoid::ClothoidCurve( x, y, th, k, dk, 40 ) ) ;
+  }
+
+  Clothoid::ClothoidBVH tree( road, 0.5 ) ;
+  cout << "tree: " << tree.numSegments() << " segments, "
+       << tree.numNodes() << " nodes, "
+       << tree.memoryFootprint() << " bytes, build "
+       << 1e3*tree.buildTime() << " ms\n" ;
+
+  std::vector<Clothoid::valueType> s1, s2, r1, r2 ;
+  Clothoid::indexType nint = 0, ndiff = 0 ;
+  clock_t t0 = clock() ;
+  for ( Clothoid::indexType i = 0 ; i < Clothoid::indexType(query.size()) ; ++i ) {
+    road.intersect( 0.5, query[i], 0, s1, s2, 20, 1e-10 ) ;
+    nint += Clothoid::indexType(s1.size()) ;
+  }
+  clock_t t1 = clock() ;
+  cout << "ClothoidCurve::intersect: " << 1e3*(t1-t0)/CLOCKS_PER_SEC
+       << " ms (" << nint << " intersections)\n" ;
+
+  nint = 0 ;
+  t0 = clock() ;
+  for ( Clothoid::indexType i = 0 ; i < Clothoid::indexType(query.size()) ; ++i ) {
+    Clothoid::ClothoidBVH q( query[i], 0 ) ;
+    tree.intersect( q, s1, s2, 20, 1e-10 ) ;
+    nint += Clothoid::indexType(s1.size()) ;
+  }
+  t1 = clock() ;
+  cout << "ClothoidBVH::intersect:   " << 1e3*(t1-t0)/CLOCKS_PER_SEC
+       << " ms (" << nint << " intersections)\n" ;
+
+  // check the two versions give the same result
+  for ( Clothoid::indexType i = 0 ; i < Clothoid::indexType(query.size()) ; ++i ) {
+    Clothoid::ClothoidBVH q( query[i], 0 ) ;
+    tree.intersect( q, s1, s2, 20, 1e-10 ) ;
+    road.intersect( 0.5, query[i], 0, r1, r2, 20, 1e-10,
+                    Clothoid::ClothoidCurve::SPLIT_FIXED ) ;
+    if ( s1 != r1 || s2 != r2 ) ++ndiff ;
+  }
+  cout << "different results: " << ndiff << '\n' ;
+
+  // segments, circle arcs and nearly straight arcs against an arc and a
+  // segment: closed form or trees as ClothoidCurve::intersect, the
+  // buffers of the workspace are not enlarged on the second pass
+  std::vector<Clothoid::ClothoidCurve> la ;
+  for ( Clothoid::indexType i = 0 ; i < 300 ; ++i ) {
+    Clothoid::valueType x  = -60 + 120*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::valueType y  = -60 + 120*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::valueType th = 2*m_pi*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::valueType k  = 0 ;
+    if      ( i % 3 == 1 ) k = 0.2*(rand()/Clothoid::valueType(RAND_MAX)-0.5) ;
+    else if ( i % 3 == 2 ) k = 1e-8 ; // not in closed form
+    la.push_back( Clothoid::ClothoidCurve( x, y, th, k, 0, 60 ) ) ;
+  }
+  Clothoid::ClothoidCurve la_tree[2] = {
+    Clothoid::ClothoidCurve( -50, -40, 0.3, 0.02, 0, 0, 300 ),
+    Clothoid::ClothoidCurve( -50, -40, 0.7, 0,    0, 0, 150 )
+  } ;
+  Clothoid::IntersectWorkspace ws ;
+  Clothoid::indexType ndiff_la = 0, nint_la = 0 ;
+  unsigned long nalloc_la = 0 ;
+  for ( Clothoid::indexType pass = 0 ; pass < 2 ; ++pass ) {
+    ws.resetCounters() ;
+    for ( Clothoid::indexType m = 0 ; m < 2 ; ++m ) {
+      Clothoid::ClothoidBVH T( la_tree[m], 0.5 ) ;
+      for ( Clothoid::indexType i = 0 ; i < Clothoid::indexType(la.size()) ; ++i ) {
+        Clothoid::ClothoidBVH q( la[i], 0 ) ;
+        T.intersect( q, s1, s2, 20, 1e-10, ws ) ;
+        la_tree[m].intersect( 0.5, la[i], 0, r1, r2, 20, 1e-10,
+                              Clothoid::ClothoidCurve::SPLIT_FIXED ) ;
+        if ( s1 != r1 || s2 != r2 ) ++ndiff_la ;
+        nint_la += Clothoid::indexType(s1.size()) ;
+      }
+    }
+    nalloc_la = ws.numGrowths() ;
+  }
+  cout << "segments and arcs:  " << nint_la/2 << " intersections, "
+       << ndiff_la << " different results, " << nalloc_la
+       << " calls enlarging the workspace on the second pass\n" ;
+
+  // all the queries at once, grouped by query
+  std::vector<Clothoid::indexType> begin ;
+  t0 = clock() ;
+  Clothoid::indexType nkept = tree.intersect( query, 0, begin, s1, s2, 20, 1e-10 ) ;
+  t1 = clock() ;
+  ndiff = 0 ;
+  for ( Clothoid::indexType i = 0 ; i < Clothoid::indexType(query.size()) ; ++i ) {
+    road.intersect( 0.5, query[i], 0, r1, r2, 20, 1e-10,
+                    Clothoid::ClothoidCurve::SPLIT_FIXED ) ;
+    std::vector<Clothoid::valueType> g1( s1.begin()+begin[i], s1.begin()+begin[i+1] ) ;
+    std::vector<Clothoid::valueType> g2( s2.begin()+begin[i], s2.begin()+begin[i+1] ) ;
+    if ( g1 != r1 || g2 != r2 ) ++ndiff ;
+  }
+  cout << "ClothoidBVH::intersect, all queries: " << 1e3*(t1-t0)/CLOCKS_PER_SEC
+       << " ms (" << s1.size() << " intersections, " << nkept << " queries not culled, "
+       << ndiff << " different results)\n" ;
+
+  // a trajectory against many lanes spread over a large area
+  std::vector<Clothoid::ClothoidCurve> lanes ;
+  for ( Clothoid::indexType i = 0 ; i < 400 ; ++i ) {
+    Clothoid::valueType x  = -500 + 1000*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::valueType y  = -500 + 1000*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::valueType th = 2*m_pi*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::valueType k  = 0.02*(rand()/Clothoid::valueType(RAND_MAX)-0.5) ;
+    Clothoid::valueType dk = 0.001*(rand()/Clothoid::valueType(RAND_MAX)-0.5) ;
+    lanes.push_back( Clothoid::ClothoidCurve( x, y, th, k, dk, 150 ) ) ;
+  }
+  Clothoid::ClothoidCurve traj( -100, -20, 0.3, 0.01, -1e-4, 0, 250 ) ;
+  nint = 0 ;
+  t0 = clock() ;
+  for ( Clothoid::indexType rep = 0 ; rep < 10 ; ++rep ) {
+    for ( Clothoid::indexType i = 0 ; i < Clothoid::indexType(lanes.size()) ; ++i ) {
+      traj.intersect( 0, lanes[i], 0, s1, s2, 20, 1e-10 ) ;
+      nint += Clothoid::indexType(s1.size()) ;
+    }
+  }
+  t1 = clock() ;
+  cout << "trajectory vs lanes, loop:  " << 1e3*(t1-t0)/CLOCKS_PER_SEC
+       << " ms (" << nint << " intersections)\n" ;
+  t0 = clock() ;
+  for ( Clothoid::indexType rep = 0 ; rep < 10 ; ++rep ) {
+    Clothoid::ClothoidBVH T( traj, 0 ) ;
+    nkept = T.intersect( lanes, 0, begin, s1, s2, 20, 1e-10 ) ;
+  }
+  t1 = clock() ;
+  cout << "trajectory vs lanes, tree:  " << 1e3*(t1-t0)/CLOCKS_PER_SEC
+       << " ms (" << 10*s1.size() << " intersections, " << nkept << " of "
+       << lanes.size() << " lanes not culled)\n" ;
+
+  // collision with the splitting of the trees
+  std::vector<Clothoid::ClothoidCurve> c0, c1 ;
+  std::vector<Clothoid::Triangle2D>    tr0, tr1 ;
+  Clothoid::indexType ncoll = 0, ncoll1 = 0 ;
+  t0 = clock() ;
+  for ( Clothoid::indexType i = 0 ; i < Clothoid::indexType(query.size()) ; ++i )
+    if ( road.approsimate_collision( 0.5, query[i], 0, m_pi/50, 800/3.0 ) ) ++ncoll ;
+  t1 = clock() ;
+  cout << "approsimate_collision:    " << 1e3*(t1-t0)/CLOCKS_PER_SEC
+       << " ms (" << ncoll << " collisions)\n" ;
+
+  // lazy splitting vs full splitting and test of all the triangles
+  Clothoid::indexType n_lazy = 0, n_full = 0, nwrong = 0 ;
+  for ( Clothoid::indexType i = 0 ; i < 100 ; ++i ) {
+    Clothoid::indexType n_eval ;
+    bool coll = road.approsimate_collision( 0.5, query[i], 0, m_pi/50, 800/3.0, n_eval ) ;
+    road.bbSplit( m_pi/50, 800/3.0, 0.5, c0, tr0 ) ;
+    query[i].bbSplit( m_pi/50, 800/3.0, 0, c1, tr1 ) ;
+    bool coll_full = false ;
+    for ( Clothoid::indexType ii = 0 ; ii < Clothoid::indexType(tr0.size()) && !coll_full ; ++ii )
+      for ( Clothoid::indexType jj = 0 ; jj < Clothoid::indexType(tr1.size()) && !coll_full ; ++jj )
+        coll_full = tr0[ii].overlap(tr1[jj]) ;
+    if ( coll != coll_full ) ++nwrong ;
+    n_lazy += n_eval ;
+    n_full += Clothoid::indexType(c0.size()+c1.size()+2) ;
+  }
+  cout << "collision, evaluations: " << n_lazy << " lazy, " << n_full
+       << " full splitting (" << nwrong << " different results)\n" ;
+  Clothoid::ClothoidBVH tree1( road, 0.5, m_pi/50, 800/3.0 ) ;
+  t0 = clock() ;
+  for ( Clothoid::indexType i = 0 ; i < Clothoid::indexType(query.size()) ; ++i ) {
+    Clothoid::ClothoidBVH q( query[i], 0, m_pi/50, 800/3.0 ) ;
+    if ( tree1.collision( q ) ) ++ncoll1 ;
+  }
+  t1 = clock() ;
+  cout << "ClothoidBVH::collision:   " << 1e3*(t1-t0)/CLOCKS_PER_SEC
+       << " ms (" << ncoll1 << " collisions)\n" ;
+
+  // long winding pairs: split + nested loop of triangles vs intersect
+  Clothoid::indexType npairs = 0 ;
+  nint = 0 ;
+  clock_t tl = 0, ti = 0, tp = 0 ;
+  Clothoid::indexType ndiffp = 0 ;
+  for ( Clothoid::indexType i = 0 ; i < 20 ; ++i ) {
+    Clothoid::ClothoidCurve a( 0,  0, i*0.1, -0.2, 0.001+i*1e-4, 0, 400 ) ;
+    Clothoid::ClothoidCurve b( 5, -3, 1+i*0.1, 0.2, -0.001-i*1e-4, 0, 400 ) ;
+    t0 = clock() ;
+    a.bbSplit( m_pi/50, 400/3.0, 0, c0, tr0 ) ;
+    b.bbSplit( m_pi/50, 400/3.0, 0, c1, tr1 ) ;
+    for ( Clothoid::indexType ii = 0 ; ii < Clothoid::indexType(tr0.size()) ; ++ii )
+      for ( Clothoid::indexType jj = 0 ; jj < Clothoid::indexType(tr1.size()) ; ++jj )
+        if ( tr0[ii].overlap(tr1[jj]) ) ++npairs ;
+    t1 = clock() ;
+    tl += t1-t0 ;
+    a.intersect( 0, b, 0, s1, s2, 20, 1e-10 ) ;
+    t0 = clock() ;
+    ti += t0-t1 ;
+    nint += Clothoid::indexType(s1.size()) ;
+    a.intersect_parallel( 0, b, 0, r1, r2, 20, 1e-10, 0 ) ;
+    tp += clock()-t0 ;
+    if ( s1 != r1 || s2 != r2 ) ++ndiffp ;
+  }
+  cout << "long pairs, split + nested loop: " << 1e3*tl/CLOCKS_PER_SEC
+       << " ms (" << npairs << " overlapping triangles)\n"
+       << "long pairs, intersect:           " << 1e3*ti/CLOCKS_PER_SEC
+       << " ms (" << nint << " intersections)\n"
+       << "long pairs, intersect_parallel:  " << 1e3*tp/CLOCKS_PER_SEC
+       << " ms (" << ndiffp << " different results)\n" ;
+
+  // clearance of the queries from the road
+  std::vector<Clothoid::valueType> dist( query.size() ) ;
+  Clothoid::valueType ss1, ss2 ;
+  t0 = clock() ;
+  for ( Clothoid::indexType i = 0 ; i < Clothoid::indexType(query.size()) ; ++i )
+    dist[i] = road.distance( 0.5, query[i], 0, ss1, ss2 ) ;
+  t1 = clock() ;
+  Clothoid::indexType nzero = 0, ncross = 0 ;
+  for ( Clothoid::indexType i = 0 ; i < Clothoid::indexType(query.size()) ; ++i ) {
+    road.intersect( 0.5, query[i], 0, s1, s2, 20, 1e-10 ) ;
+    if ( !s1.empty() ) ++ncross ;
+    if ( dist[i] < 1e-6 ) ++nzero ;
+  }
+  cout << "distance:                 " << 1e3*(t1-t0)/CLOCKS_PER_SEC
+       << " ms (" << nzero << " at zero distance, " << ncross << " intersecting)\n" ;
+
+  Clothoid::indexType nnear = 0, ndiffd = 0 ;
+  t0 = clock() ;
+  for ( Clothoid::indexType i = 0 ; i < Clothoid::indexType(query.size()) ; ++i ) {
+    Clothoid::valueType d = road.distance( 0.5, query[i], 0, ss1, ss2, 1e-8, 2 ) ;
+    if ( d < 2 ) ++nnear ;
+    if ( (d < 2) != (dist[i] < 2) ) ++ndiffd ;
+  }
+  t1 = clock() ;
+  cout << "distance, threshold 2:    " << 1e3*(t1-t0)/CLOCKS_PER_SEC
+       << " ms (" << nnear << " closer, " << ndiffd << " different results)\n" ;
+
+  // dense sampling of a few pairs
+  Clothoid::valueType maxerr = 0 ;
+  for ( Clothoid::indexType i = 0 ; i < 10 ; ++i ) {
+    std::vector<Clothoid::valueType> xr, yr ;
+    for ( Clothoid::valueType s = 0 ; s <= 800 ; s += 0.05 ) {
+      Clothoid::valueType x, y ;
+      road.eval( s, 0.5, x, y ) ;
+      xr.push_back(x) ; yr.push_back(y) ;
+    }
+    Clothoid::valueType dmin = 1e300 ;
+    for ( Clothoid::valueType s = 0 ; s <= 40 ; s += 0.05 ) {
+      Clothoid::valueType x, y ;
+      query[i].eval( s, x, y ) ;
+      for ( size_t k = 0 ; k < xr.size() ; ++k ) {
+        Clothoid::valueType d = hypot( xr[k]-x, yr[k]-y ) ;
+        if ( d < dmin ) dmin = d ;
+      }
+    }
+    // sampling gives an upper bound
+    if ( dist[i]-dmin > maxerr ) maxerr = dist[i]-dmin ;
+  }
+  cout << "distance above sampling:  " << maxerr << '\n' ;
+  unsigned long n_calls, n_exact ;
+  Clothoid::orient2dStats( n_calls, n_exact ) ;
+  if ( n_calls > 0 )
+    cout << "orient2d: " << n_calls << " calls, " << n_exact << " exact ("
+         << (100.0*n_exact)/n_calls << "%)\n" ;
+  return ndiff_la > 0 || nalloc_la > 0 ? 1 : 0 ;
+}
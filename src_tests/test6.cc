@@ -0,0 +1,107 @@
+#include "Clothoid.hh"
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <cmath>
+
+Clothoid::valueType m_pi = 3.14159265358979323846264338328 ;
+
+using namespace std ;
+
+// road network: roads made of segments, arcs and clothoids, two edges per piece
+static
+void
+buildMap( Clothoid::indexType                    nroads,
+          Clothoid::valueType                    size,
+          std::vector<Clothoid::ClothoidCurve> & c,
+          std::vector<Clothoid::valueType>     & offs ) {
+  c.clear() ;
+  offs.clear() ;
+  srand(1) ;
+  for ( Clothoid::indexType r = 0 ; r < nroads ; ++r ) {
+    Clothoid::valueType x  = size*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::valueType y  = size*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::valueType th = 2*m_pi*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    for ( Clothoid::indexType i = 0 ; i < 10 ; ++i ) {
+      Clothoid::valueType L  = 20 + 80*(rand()/Clothoid::valueType(RAND_MAX)) ;
+      Clothoid::valueType rr = rand()/Clothoid::valueType(RAND_MAX) ;
+      Clothoid::valueType k  = 0, dk = 0 ;
+      if      ( rr > 0.85 ) { k = 0.01*(rr-0.9) ; dk = 1e-4*(rr-0.92) ; }
+      else if ( rr > 0.5  ) { k = 0.02*(rr-0.7) ; }
+      Clothoid::ClothoidCurve cc( x, y, th, k, dk, L ) ;
+      c.push_back(cc) ; offs.push_back(-3.5) ;
+      c.push_back(cc) ; offs.push_back(3.5) ;
+      Clothoid::valueType kappa ;
+      cc.eval( L, th, kappa, x, y ) ;
+    }
+  }
+}
+
+int
+main() {
+  std::vector<Clothoid::ClothoidCurve> c ;
+  std::vector<Clothoid::valueType>     offs ;
+  std::vector<Clothoid::ClothoidSetIntersect::Point> res, res1 ;
+  Clothoid::ClothoidSetIntersect I ;
+
+  // check against the loop on all the pairs
+  buildMap( 100, 2000, c, offs ) ;
+  std::vector<Clothoid::valueType> s1, s2 ;
+  Clothoid::indexType nint = 0 ;
+  clock_t t0 = clock() ;
+  for ( Clothoid::indexType i = 0 ; i < Clothoid::indexType(c.size()) ; ++i ) {
+    for ( Clothoid::indexType j = i+1 ; j < Clothoid::indexType(c.size()) ; ++j ) {
+      c[i].intersect( offs[i], c[j], offs[j], s1, s2, 20, 1e-10,
+                      Clothoid::ClothoidCurve::SPLIT_FIXED ) ;
+      for ( size_t k = 0 ; k < s1.size() ; ++k, ++nint ) {
+        if ( nint >= Clothoid::indexType(res1.size()) ) res1.resize( nint+1 ) ;
+        res1[nint].i = i ; res1[nint].j = j ;
+        res1[nint].s_i = s1[k] ; res1[nint].s_j = s2[k] ;
+      }
+    }
+  }
+  clock_t t1 = clock() ;
+  res1.resize( nint ) ;
+  cout << c.size() << " curves, loop on all the pairs: "
+       << 1e3*(t1-t0)/CLOCKS_PER_SEC << " ms (" << nint << " intersections)\n" ;
+
+  Clothoid::ClothoidSetIntersect::SpatialIndex idx[2] = {
+    Clothoid::ClothoidSetIntersect::INDEX_GRID,
+    Clothoid::ClothoidSetIntersect::INDEX_BVH
+  } ;
+  Clothoid::indexType ndiff = 0 ;
+  for ( Clothoid::indexType k = 0 ; k < 2 ; ++k ) {
+    I.setSpatialIndex( idx[k] ) ;
+    t0 = clock() ;
+    I.intersect( c, offs, res, 20, 1e-10 ) ;
+    t1 = clock() ;
+    bool equal = res.size() == res1.size() ;
+    for ( size_t l = 0 ; equal && l < res.size() ; ++l )
+      equal = res[l].i   == res1[l].i   && res[l].j   == res1[l].j &&
+              res[l].s_i == res1[l].s_i && res[l].s_j == res1[l].s_j ;
+    cout << ( I.usedGrid() ? "grid: " : "bvh:  " ) << 1e3*(t1-t0)/CLOCKS_PER_SEC
+         << " ms, same result: " << ( equal ? "yes" : "NO" ) << '\n' ;
+    if ( !equal ) ++ndiff ;
+  }
+
+  // scaling
+  I.setSpatialIndex( Clothoid::ClothoidSetIntersect::INDEX_AUTO ) ;
+  for ( Clothoid::indexType n = 250 ; n <= 4000 ; n *= 2 ) {
+    // same density of roads
+    buildMap( n, 1000*sqrt(n/250.0), c, offs ) ;
+    t0 = clock() ;
+    I.intersect( c, offs, res, 20, 1e-10 ) ;
+    t1 = clock() ;
+    cout << c.size() << " curves, " << I.numLeaves() << " triangles, "
+         << I.numCandidates() << " candidates, "
+         << ( I.usedGrid() ? "grid: " : "bvh: " )
+         << 1e3*(t1-t0)/CLOCKS_PER_SEC << " ms ("
+         << res.size() << " intersections)\n" ;
+  }
+  unsigned long n_calls, n_exact ;
+  Clothoid::orient2dStats( n_calls, n_exact ) ;
+  if ( n_calls > 0 )
+    cout << "orient2d: " << n_calls << " calls, " << n_exact << " exact ("
+         << (100.0*n_exact)/n_calls << "%)\n" ;
+  return ndiff > 0 ? 1 : 0 ;
+}
@@ -0,0 +1,126 @@
+#include "Clothoid.hh"
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <cmath>
+
+Clothoid::valueType m_pi = 3.14159265358979323846264338328 ;
+
+using namespace std ;
+
+// one triangle against many: Triangle2D::overlap vs Triangle2DBatch
+int
+main() {
+  // bounding triangles of a road mix
+  std::vector<Clothoid::Triangle2D> t0, t1, tmp ;
+  std::vector<Clothoid::ClothoidCurve> c ;
+  srand(1) ;
+  for ( Clothoid::indexType i = 0 ; i < 400 ; ++i ) {
+    Clothoid::valueType x  = 200*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::valueType y  = 200*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::valueType th = 2*m_pi*(rand()/Clothoid::valueType(RAND_MAX)) ;
+    Clothoid::valueType r  = rand()/Clothoid::valueType(RAND_MAX) ;
+    Clothoid::valueType k  = 0, dk = 0 ;
+    if      ( r > 0.85 ) { k = 0.1*(r-0.9) ; dk = 1e-2*(r-0.92) ; }
+    else if ( r > 0.5  ) { k = 0.2*(r-0.7) ; }
+    Clothoid::ClothoidCurve cc( x, y, th, k, dk, 30 ) ;
+    cc.bbSplit( m_pi/50, 1, 0, c, tmp ) ;
+    std::vector<Clothoid::Triangle2D> & t = i < 200 ? t0 : t1 ;
+    t.insert( t.end(), tmp.begin(), tmp.end() ) ;
+  }
+  cout << t0.size() << " x " << t1.size() << " triangles\n" ;
+
+  Clothoid::indexType nov = 0 ;
+  clock_t tt0 = clock() ;
+  for ( Clothoid::indexType rep = 0 ; rep < 5 ; ++rep )
+    for ( size_t i = 0 ; i < t0.size() ; ++i )
+      for ( size_t j = 0 ; j < t1.size() ; ++j )
+        if ( t0[i].overlap(t1[j]) ) ++nov ;
+  clock_t tt1 = clock() ;
+  cout << "Triangle2D::overlap:      " << 1e3*(tt1-tt0)/CLOCKS_PER_SEC
+       << " ms (" << nov << " overlaps)\n" ;
+
+  Clothoid::Triangle2DBatch B( t1 ) ;
+  std::vector<Clothoid::indexType> idx( t1.size() ) ;
+  Clothoid::indexType nov1 = 0 ;
+  tt0 = clock() ;
+  for ( Clothoid::indexType rep = 0 ; rep < 5 ; ++rep ) {
+    for ( size_t i = 0 ; i < t0.size() ; ++i ) {
+      Clothoid::PreparedTriangle2D A( t0[i] ) ;
+      nov1 += B.overlap( A, &idx.front() ) ;
+    }
+  }
+  tt1 = clock() ;
+  cout << "Triangle2DBatch::overlap: " << 1e3*(tt1-tt0)/CLOCKS_PER_SEC
+       << " ms (" << nov1 << " overlaps)\n" ;
+
+  // same pairs
+  Clothoid::indexType ndiff = 0 ;
+  for ( size_t i = 0 ; i < t0.size() ; ++i ) {
+    Clothoid::PreparedTriangle2D A( t0[i] ) ;
+    Clothoid::indexType n = B.overlap( A, &idx.front() ), k = 0 ;
+    for ( size_t j = 0 ; j < t1.size() ; ++j ) {
+      if ( t0[i].overlap(t1[j]) ) {
+        if ( k >= n || idx[k] != Clothoid::indexType(j) ) ++ndiff ;
+        ++k ;
+      }
+    }
+    if ( k != n ) ++ndiff ;
+  }
+  cout << "different results: " << ndiff << '\n' ;
+
+  // crowded triangles on a grid: overlapping, sharing vertices and edges,
+  // segments and points, the overlaps accepted without the exact test too
+  std::vector<Clothoid::Triangle2D> g ;
+  for ( Clothoid::indexType i = 0 ; i < 600 ; ++i ) {
+    Clothoid::valueType v[6] ;
+    for ( Clothoid::indexType k = 0 ; k < 6 ; ++k )
+      v[k] = 0.25*(rand()%17) ;
+    switch ( i % 6 ) {
+      case 1: v[4] = v[2] ; v[5] = v[3] ; break ;                 // segment
+      case 2: v[2] = v[4] = v[0] ; v[3] = v[5] = v[1] ; break ;   // point
+      case 3: v[4] = 2*v[2]-v[0] ; v[5] = 2*v[3]-v[1] ; break ;   // collinear
+    }
+    g.push_back( Clothoid::Triangle2D( v[0], v[1], v[2], v[3], v[4], v[5] ) ) ;
+  }
+  Clothoid::Triangle2DBatch G( g ) ;
+  std::vector<Clothoid::indexType> gidx( g.size() ) ;
+  Clothoid::indexType ndiffg = 0, novg = 0 ;
+  for ( size_t i = 0 ; i < g.size() ; ++i ) {
+    Clothoid::indexType n = G.overlap( Clothoid::PreparedTriangle2D( g[i] ), &gidx.front() ), k = 0 ;
+    for ( size_t j = 0 ; j < g.size() ; ++j ) {
+      if ( g[i].overlap(g[j]) ) {
+        if ( k >= n || gidx[k] != Clothoid::indexType(j) ) ++ndiffg ;
+        ++k ;
+      }
+    }
+    if ( k != n ) ++ndiffg ;
+    novg += n ;
+  }
+  cout << "crowded triangles: " << novg << " overlaps, "
+       << ndiffg << " different results\n" ;
+  unsigned long n_calls, n_exact ;
+  Clothoid::orient2dStats( n_calls, n_exact ) ;
+  if ( n_calls > 0 )
+    cout << "orient2d: " << n_calls << " calls, " << n_exact << " exact ("
+         << (100.0*n_exact)/n_calls << "%)\n" ;
+
+  // points close to the line y = x, orientation is the sign of y-x
+  Clothoid::indexType nwrong = 0, nwrong_naive = 0 ;
+  Clothoid::valueType q[2] = { 12, 12 }, r[2] = { 24, 24 }, p[2] ;
+  p[0] = 0.5 ;
+  for ( Clothoid::indexType i = 0 ; i < 256 ; ++i, p[0] = nextafter(p[0],1.0) ) {
+    p[1] = 0.5 ;
+    for ( Clothoid::indexType j = 0 ; j < 256 ; ++j, p[1] = nextafter(p[1],1.0) ) {
+      Clothoid::valueType o  = Clothoid::orient2d( p, q, r ) ;
+      Clothoid::valueType on = (p[0]-r[0])*(q[1]-r[1]) - (p[1]-r[1])*(q[0]-r[0]) ;
+      int sgn = j > i ? 1 : ( j < i ? -1 : 0 ) ;
+      if ( (o  > 0 ? 1 : ( o  < 0 ? -1 : 0 )) != sgn ) ++nwrong ;
+      if ( (on > 0 ? 1 : ( on < 0 ? -1 : 0 )) != sgn ) ++nwrong_naive ;
+    }
+  }
+  cout << "orientation near y = x, wrong signs: "
+       << nwrong << " orient2d, " << nwrong_naive << " floating point (of 65536)\n" ;
+
+  return ndiff+ndiffg+nwrong > 0 ? 1 : 0 ;
+}
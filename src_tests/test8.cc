@@ -0,0 +1,326 @@
+#include "Clothoid.hh"
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <cmath>
+#include <algorithm>
+#include <new>
+
+Clothoid::valueType m_pi = 3.14159265358979323846264338328 ;
+
+using namespace std ;
+
+// all the allocations of the program, the queries with a workspace must not allocate
+static unsigned long n_new = 0 ;
+
+void *
+operator new( std::size_t n ) {
+  ++n_new ;
+  void * p = malloc( n > 0 ? n : 1 ) ;
+  if ( p == 0 ) throw std::bad_alloc() ;
+  return p ;
+}
+
+void
+operator delete( void * p ) throw() {
+  free( p ) ;
+}
+
+static
+Clothoid::valueType
+rnd() {
+  return rand()/Clothoid::valueType(RAND_MAX) ;
+}
+
+// lane markings and stop lines: clothoid vs segment and vs circle
+int
+main() {
+  std::vector<Clothoid::ClothoidCurve> c ;
+  srand(1) ;
+  for ( Clothoid::indexType i = 0 ; i < 200 ; ++i )
+    c.push_back( Clothoid::ClothoidCurve( 0, 0, 2*m_pi*rnd(), 0.1*(rnd()-0.5),
+                                          0.01*(rnd()-0.5), 20+80*rnd() ) ) ;
+  std::vector<Clothoid::valueType> sx0, sy0, sx1, sy1, cx, cy, cr ;
+  for ( Clothoid::indexType i = 0 ; i < 500 ; ++i ) {
+    sx0.push_back( 100*(rnd()-0.5) ) ; sy0.push_back( 100*(rnd()-0.5) ) ;
+    sx1.push_back( 100*(rnd()-0.5) ) ; sy1.push_back( 100*(rnd()-0.5) ) ;
+    cx.push_back( 100*(rnd()-0.5) ) ;  cy.push_back( 100*(rnd()-0.5) ) ;
+    cr.push_back( 1+30*rnd() ) ;
+  }
+  Clothoid::valueType offs = 0.5 ;
+
+  // reference: segments and circles as degenerate curves
+  std::vector<Clothoid::valueType> s1, s2, r1, r2 ;
+  Clothoid::indexType nint = 0, nint1 = 0, ndiff = 0 ;
+  Clothoid::valueType maxerr = 0 ;
+  clock_t t0 = clock() ;
+  for ( size_t i = 0 ; i < c.size() ; ++i ) {
+    for ( size_t j = 0 ; j < sx0.size() ; ++j ) {
+      Clothoid::valueType dx = sx1[j]-sx0[j], dy = sy1[j]-sy0[j] ;
+      Clothoid::ClothoidCurve seg( sx0[j], sy0[j], atan2(dy,dx), 0, 0, hypot(dx,dy) ) ;
+      c[i].intersect( offs, seg, 0, s1, s2, 20, 1e-10 ) ;
+      nint += Clothoid::indexType(s1.size()) ;
+    }
+  }
+  clock_t t1 = clock() ;
+  cout << "segments, intersect:         " << 1e3*(t1-t0)/CLOCKS_PER_SEC
+       << " ms (" << nint << " intersections)\n" ;
+  t0 = clock() ;
+  for ( size_t i = 0 ; i < c.size() ; ++i ) {
+    for ( size_t j = 0 ; j < sx0.size() ; ++j ) {
+      c[i].intersect_segment( offs, sx0[j], sy0[j], sx1[j], sy1[j], r1, r2, 1e-10 ) ;
+      nint1 += Clothoid::indexType(r1.size()) ;
+    }
+  }
+  t1 = clock() ;
+  cout << "segments, intersect_segment: " << 1e3*(t1-t0)/CLOCKS_PER_SEC
+       << " ms (" << nint1 << " intersections, "
+       << 1e-6*c.size()*sx0.size()*CLOCKS_PER_SEC/(t1-t0) << " M/s)\n" ;
+  for ( size_t i = 0 ; i < c.size() ; ++i ) {
+    for ( size_t j = 0 ; j < sx0.size() ; ++j ) {
+      Clothoid::valueType dx = sx1[j]-sx0[j], dy = sy1[j]-sy0[j] ;
+      Clothoid::ClothoidCurve seg( sx0[j], sy0[j], atan2(dy,dx), 0, 0, hypot(dx,dy) ) ;
+      c[i].intersect( offs, seg, 0, s1, s2, 20, 1e-10 ) ;
+      c[i].intersect_segment( offs, sx0[j], sy0[j], sx1[j], sy1[j], r1, r2, 1e-10 ) ;
+      if ( s1.size() != r1.size() ) { ++ndiff ; continue ; }
+      sort( s1.begin(), s1.end() ) ;
+      for ( size_t k = 0 ; k < s1.size() ; ++k )
+        maxerr = max( maxerr, std::abs(s1[k]-r1[k]) ) ;
+    }
+  }
+  cout << "different number of intersections: " << ndiff
+       << ", max difference " << maxerr << '\n' ;
+  Clothoid::indexType nmiss = ndiff ;
+
+  // circles
+  nint = nint1 = ndiff = 0 ;
+  maxerr = 0 ;
+  t0 = clock() ;
+  for ( size_t i = 0 ; i < c.size() ; ++i ) {
+    for ( size_t j = 0 ; j < cx.size() ; ++j ) {
+      Clothoid::ClothoidCurve circ( cx[j]+cr[j], cy[j], m_pi/2, 1/cr[j], 0, 2*m_pi*cr[j] ) ;
+      c[i].intersect( offs, circ, 0, s1, s2, 20, 1e-10 ) ;
+      nint += Clothoid::indexType(s1.size()) ;
+    }
+  }
+  t1 = clock() ;
+  cout << "circles, intersect:          " << 1e3*(t1-t0)/CLOCKS_PER_SEC
+       << " ms (" << nint << " intersections)\n" ;
+  t0 = clock() ;
+  for ( size_t i = 0 ; i < c.size() ; ++i ) {
+    for ( size_t j = 0 ; j < cx.size() ; ++j ) {
+      c[i].intersect_circle( offs, cx[j], cy[j], cr[j], r1, r2, 1e-10 ) ;
+      nint1 += Clothoid::indexType(r1.size()) ;
+    }
+  }
+  t1 = clock() ;
+  cout << "circles, intersect_circle:   " << 1e3*(t1-t0)/CLOCKS_PER_SEC
+       << " ms (" << nint1 << " intersections, "
+       << 1e-6*c.size()*cx.size()*CLOCKS_PER_SEC/(t1-t0) << " M/s)\n" ;
+  for ( size_t i = 0 ; i < c.size() ; ++i ) {
+    for ( size_t j = 0 ; j < cx.size() ; ++j ) {
+      Clothoid::ClothoidCurve circ( cx[j]+cr[j], cy[j], m_pi/2, 1/cr[j], 0, 2*m_pi*cr[j] ) ;
+      c[i].intersect( offs, circ, 0, s1, s2, 20, 1e-10 ) ;
+      c[i].intersect_circle( offs, cx[j], cy[j], cr[j], r1, r2, 1e-10 ) ;
+      if ( s1.size() != r1.size() ) { ++ndiff ; continue ; }
+      sort( s1.begin(), s1.end() ) ;
+      for ( size_t k = 0 ; k < s1.size() ; ++k )
+        maxerr = max( maxerr, std::abs(s1[k]-r1[k]) ) ;
+    }
+  }
+  cout << "different number of intersections: " << ndiff
+       << ", max difference " << maxerr << '\n' ;
+  nmiss += ndiff ;
+
+  // refinement of the segments: Newton on the curves vs cubic models
+  Clothoid::ClothoidCurve::IntersectRefine refine[2] = {
+    Clothoid::ClothoidCurve::REFINE_NEWTON, Clothoid::ClothoidCurve::REFINE_TAYLOR
+  } ;
+  char const * refine_name[2] = { "newton", "taylor" } ;
+  Clothoid::indexType rint[2] ;
+  for ( Clothoid::indexType m = 0 ; m < 2 ; ++m ) {
+    Clothoid::indexType n_eval, neval = 0 ;
+    rint[m] = 0 ;
+    t0 = clock() ;
+    for ( size_t i = 0 ; i < 40 ; ++i ) {
+      for ( size_t j = 0 ; j < cx.size() ; ++j ) {
+        Clothoid::ClothoidCurve circ( cx[j]+cr[j], cy[j], m_pi/2, 1/cr[j], 0, 2*m_pi*cr[j] ) ;
+        c[i].intersect( offs, circ, 0, s1, s2, 20, 1e-10, refine[m], n_eval ) ;
+        rint[m] += Clothoid::indexType(s1.size()) ;
+        neval   += n_eval ;
+      }
+    }
+    t1 = clock() ;
+    cout << "refine " << refine_name[m] << ": " << 1e3*(t1-t0)/CLOCKS_PER_SEC
+         << " ms (" << rint[m] << " intersections, "
+         << neval/Clothoid::valueType(rint[m]) << " evaluations per intersection)\n" ;
+  }
+  if ( rint[0] != rint[1] ) ++nmiss ;
+
+  // splitting: fixed parameters vs adaptive, on segments, circles and spirals
+  std::vector<Clothoid::ClothoidCurve> corpus ;
+  for ( size_t j = 0 ; j < 200 ; ++j ) {
+    Clothoid::valueType dx = sx1[j]-sx0[j], dy = sy1[j]-sy0[j] ;
+    corpus.push_back( Clothoid::ClothoidCurve( sx0[j], sy0[j], atan2(dy,dx), 0, 0, hypot(dx,dy) ) ) ;
+    corpus.push_back( Clothoid::ClothoidCurve( cx[j]+cr[j], cy[j], m_pi/2, 1/cr[j], 0, 2*m_pi*cr[j] ) ) ;
+    corpus.push_back( Clothoid::ClothoidCurve( cx[j], cy[j], 2*m_pi*rnd(), 0.2*(rnd()-0.5),
+                                               0.02*(rnd()-0.5), 50+200*rnd() ) ) ;
+  }
+  Clothoid::ClothoidCurve::SplitPolicy split[2] = {
+    Clothoid::ClothoidCurve::SPLIT_FIXED, Clothoid::ClothoidCurve::SPLIT_ADAPTIVE
+  } ;
+  char const * split_name[2] = { "fixed   ", "adaptive" } ;
+  std::vector<Clothoid::indexType> nsplit[2] ;
+  for ( Clothoid::indexType m = 0 ; m < 2 ; ++m ) {
+    t0 = clock() ;
+    for ( size_t i = 0 ; i < 20 ; ++i ) {
+      for ( size_t j = 0 ; j < corpus.size() ; ++j ) {
+        c[i].intersect( offs, corpus[j], 0, s1, s2, 20, 1e-10, split[m] ) ;
+        nsplit[m].push_back( Clothoid::indexType(s1.size()) ) ;
+      }
+    }
+    t1 = clock() ;
+    Clothoid::indexType ns = 0 ;
+    for ( size_t k = 0 ; k < nsplit[m].size() ; ++k ) ns += nsplit[m][k] ;
+    cout << "split " << split_name[m] << ": " << 1e3*(t1-t0)/CLOCKS_PER_SEC
+         << " ms (" << ns << " intersections)\n" ;
+  }
+  ndiff = 0 ;
+  for ( size_t k = 0 ; k < nsplit[0].size() ; ++k )
+    if ( nsplit[0][k] != nsplit[1][k] ) ++ndiff ;
+  cout << "different number of intersections: " << ndiff << '\n' ;
+
+  // the same queries reusing the buffers of a workspace, also with the
+  // fixed splitting and the parallel refinement: the first pass grows the
+  // buffers, the second one must not allocate
+  Clothoid::IntersectWorkspace ws ;
+  std::vector<Clothoid::valueType> w1, w2 ;
+  for ( Clothoid::indexType pass = 0 ; pass < 2 ; ++pass ) {
+    Clothoid::indexType nw = 0, nmismatch = 0, ncoll = 0, nseg = 0 ;
+    ws.resetCounters() ;
+    unsigned long n_new0 = n_new ;
+    t0 = clock() ;
+    for ( size_t i = 0, k = 0 ; i < 20 ; ++i ) {
+      for ( size_t j = 0 ; j < corpus.size() ; ++j, ++k ) {
+        c[i].intersect( offs, corpus[j], 0, w1, w2, 20, 1e-10, ws ) ;
+        nw += Clothoid::indexType(w1.size()) ;
+        if ( Clothoid::indexType(w1.size()) != nsplit[1][k] ) ++nmismatch ;
+        c[i].intersect( offs, corpus[j], 0, w1, w2, 20, 1e-10,
+                        Clothoid::ClothoidCurve::SPLIT_FIXED, ws ) ;
+        if ( Clothoid::indexType(w1.size()) != nsplit[0][k] ) ++nmismatch ;
+        c[i].intersect_parallel( offs, corpus[j], 0, w1, w2, 20, 1e-10, 4, ws ) ;
+        if ( Clothoid::indexType(w1.size()) != nsplit[1][k] ) ++nmismatch ;
+        if ( c[i].approsimate_collision( offs, corpus[j], 0, m_pi/50, 1, ws ) ) ++ncoll ;
+      }
+      nseg += c[i].bbSplit( m_pi/50, c[i].getSmax()/30, offs, ws ) ;
+    }
+    t1 = clock() ;
+    unsigned long nalloc = n_new-n_new0 ;
+    cout << "workspace, pass " << pass+1 << ": " << 1e3*(t1-t0)/CLOCKS_PER_SEC
+         << " ms (" << nw << " intersections, " << nmismatch << " different, "
+         << ncoll << " collisions, " << nseg << " segments, "
+         << ws.numGrowths() << " of " << ws.numCalls() << " calls grew a buffer, "
+         << nalloc << " allocations)\n" ;
+    nmiss += nmismatch ;
+    if ( pass > 0 ) nmiss += Clothoid::indexType(nalloc) ;
+  }
+
+  // closest point projection vs dense sampling
+  Clothoid::indexType np = Clothoid::indexType(sx0.size()) ;
+  std::vector<Clothoid::valueType> ps(np), pd(np) ;
+  Clothoid::indexType nsample = 2000, nworse = 0 ;
+  Clothoid::valueType tsample = 0, tproj = 0, gain = 0 ;
+  for ( size_t i = 0 ; i < 20 ; ++i ) {
+    t0 = clock() ;
+    for ( Clothoid::indexType j = 0 ; j < np ; ++j )
+      pd[j] = c[i].project( sx0[j], sy0[j], offs, ps[j] ) ;
+    t1 = clock() ;
+    tproj += t1-t0 ;
+    for ( Clothoid::indexType j = 0 ; j < np ; ++j ) {
+      Clothoid::valueType dmin = HUGE_VAL ;
+      for ( Clothoid::indexType k = 0 ; k <= nsample ; ++k ) {
+        Clothoid::valueType px, py ;
+        c[i].eval( c[i].getSmax()*k/nsample, offs, px, py ) ;
+        dmin = min( dmin, hypot( px-sx0[j], py-sy0[j] ) ) ;
+      }
+      if ( pd[j] > dmin+1e-9 ) ++nworse ;
+      gain = max( gain, dmin-pd[j] ) ;
+    }
+    tsample += clock()-t1 ;
+  }
+  cout << "project:         " << 1e3*tproj/CLOCKS_PER_SEC << " ms\n"
+       << "dense sampling:  " << 1e3*tsample/CLOCKS_PER_SEC << " ms ("
+       << nsample << " samples, " << nworse << " closer points, "
+       << "max improvement " << gain << ")\n" ;
+
+  // batch: one tree, many points
+  std::vector<Clothoid::valueType> qx, qy ;
+  for ( Clothoid::indexType i = 0 ; i < 200000 ; ++i ) {
+    qx.push_back( 100*(rnd()-0.5) ) ;
+    qy.push_back( 100*(rnd()-0.5) ) ;
+  }
+  ps.resize( qx.size() ) ;
+  pd.resize( qx.size() ) ;
+  Clothoid::ClothoidBVH B( c[0], offs ) ;
+  t0 = clock() ;
+  B.project( Clothoid::indexType(qx.size()), &qx.front(), &qy.front(), &ps.front(), &pd.front() ) ;
+  t1 = clock() ;
+  cout << "batch project:   " << qx.size() << " points in "
+       << 1e3*(t1-t0)/CLOCKS_PER_SEC << " ms cpu time\n" ;
+
+  // Frenet coordinates of a trajectory along a G2 chain of clothoids
+  std::vector<Clothoid::ClothoidCurve> chain ;
+  Clothoid::valueType x = 0, y = 0, theta = 0, kappa = 0 ;
+  for ( Clothoid::indexType i = 0 ; i < 200 ; ++i ) {
+    Clothoid::valueType L = 20+40*rnd() ;
+    Clothoid::valueType k1 = 0.1*(rnd()-0.5) ;
+    chain.push_back( Clothoid::ClothoidCurve( x, y, theta, kappa, (k1-kappa)/L, L ) ) ;
+    chain.back().eval( L, theta, kappa, x, y ) ;
+  }
+  Clothoid::ClothoidFrenet F( chain ) ;
+  std::vector<Clothoid::valueType> ts, td, tx, ty ;
+  for ( Clothoid::valueType ss = 0 ; ss < F.length() ; ss += 0.1 ) {
+    ts.push_back( ss ) ;
+    td.push_back( 2*sin(ss/30) ) ;
+  }
+  Clothoid::indexType nt = Clothoid::indexType(ts.size()) ;
+  tx.resize( nt ) ; ty.resize( nt ) ; ps.resize( nt ) ; pd.resize( nt ) ;
+  t0 = clock() ;
+  F.toCartesian( nt, &ts.front(), &td.front(), &tx.front(), &ty.front() ) ;
+  t1 = clock() ;
+  cout << "toCartesian:     " << nt << " points in "
+       << 1e3*(t1-t0)/CLOCKS_PER_SEC << " ms cpu time\n" ;
+
+  Clothoid::indexType nlocal, nglobal ;
+  Clothoid::valueType errs = 0, errd = 0 ;
+  t0 = clock() ;
+  F.toFrenet( nt, &tx.front(), &ty.front(), &ps.front(), &pd.front() ) ;
+  t1 = clock() ;
+  F.stats( nlocal, nglobal ) ;
+  for ( Clothoid::indexType i = 0 ; i < nt ; ++i ) {
+    errs = max( errs, std::abs(ps[i]-ts[i]) ) ;
+    errd = max( errd, std::abs(pd[i]-td[i]) ) ;
+  }
+  cout << "toFrenet, warm:  " << 1e3*(t1-t0)/CLOCKS_PER_SEC << " ms ("
+       << nlocal << " local, " << nglobal << " global, max error s "
+       << errs << " d " << errd << ")\n" ;
+
+  // without warm start every point is projected on the closest branch
+  F.statsReset() ;
+  Clothoid::indexType nbranch = 0, nfar = 0, ncold = 0 ;
+  t0 = clock() ;
+  for ( Clothoid::indexType i = 0 ; i < nt ; i += 10, ++ncold ) {
+    F.reset() ;
+    F.toFrenet( tx[i], ty[i], ps[i], pd[i] ) ;
+  }
+  t1 = clock() ;
+  F.stats( nlocal, nglobal ) ;
+  for ( Clothoid::indexType i = 0 ; i < nt ; i += 10 ) {
+    if ( std::abs(ps[i]-ts[i]) > 1e-6 ) ++nbranch ;
+    if ( std::abs(pd[i]) > std::abs(td[i])+1e-9 ) ++nfar ;
+  }
+  cout << "toFrenet, cold:  " << 1e3*(t1-t0)/CLOCKS_PER_SEC << " ms for "
+       << ncold << " points (" << nlocal << " local, " << nglobal << " global, "
+       << nbranch << " on a closer branch, " << nfar << " farther)\n" ;
+  return nmiss > 0 ? 1 : 0 ;
+}
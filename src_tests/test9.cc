@@ -0,0 +1,195 @@
+#include "Clothoid.hh"
+#include <iostream>
+#include <cstdlib>
+#include <ctime>
+#include <cmath>
+#include <algorithm>
+
+Clothoid::valueType m_pi = 3.14159265358979323846264338328 ;
+
+using namespace std ;
+
+static
+Clothoid::valueType
+rnd() {
+  return rand()/Clothoid::valueType(RAND_MAX) ;
+}
+
+static
+Clothoid::valueType
+cross( Clothoid::valueType ax, Clothoid::valueType ay,
+       Clothoid::valueType bx, Clothoid::valueType by,
+       Clothoid::valueType cx, Clothoid::valueType cy ) {
+  return (bx-ax)*(cy-ay)-(by-ay)*(cx-ax) ;
+}
+
+// segment (x0,y0)-(x1,y1) vs counterclockwise convex polygon
+static
+bool
+segmentHit( Clothoid::valueType x0, Clothoid::valueType y0,
+            Clothoid::valueType x1, Clothoid::valueType y1,
+            Clothoid::valueType const qx[], Clothoid::valueType const qy[], int n ) {
+  bool in0 = true, in1 = true ;
+  for ( int i = 0 ; i < n ; ++i ) {
+    int j = (i+1)%n ;
+    Clothoid::valueType c0 = cross( qx[i], qy[i], qx[j], qy[j], x0, y0 ) ;
+    Clothoid::valueType c1 = cross( qx[i], qy[i], qx[j], qy[j], x1, y1 ) ;
+    if ( c0 < 0 ) in0 = false ;
+    if ( c1 < 0 ) in1 = false ;
+    Clothoid::valueType d0 = cross( x0, y0, x1, y1, qx[i], qy[i] ) ;
+    Clothoid::valueType d1 = cross( x0, y0, x1, y1, qx[j], qy[j] ) ;
+    if ( c0*c1 <= 0 && d0*d1 <= 0 ) return true ;
+  }
+  return in0 || in1 ;
+}
+
+// swept footprint of a vehicle along motion primitives vs box obstacles
+int
+main() {
+  srand(1) ;
+  Clothoid::valueType w = 2 ; // width of the vehicle
+  Clothoid::indexType nobs = 2000 ;
+  std::vector<Clothoid::valueType> ox(4*nobs), oy(4*nobs) ;
+  Clothoid::ClothoidSweep sweep ;
+  for ( Clothoid::indexType i = 0 ; i < nobs ; ++i ) {
+    Clothoid::valueType cx = 400*(rnd()-0.5), cy = 400*(rnd()-0.5) ;
+    Clothoid::valueType a  = 0.5+2*rnd(), b = 0.5+2*rnd(), th = m_pi*rnd() ;
+    Clothoid::valueType ux = cos(th), uy = sin(th) ;
+    Clothoid::valueType sa[4] = { -1, 1, 1, -1 }, sb[4] = { -1, -1, 1, 1 } ;
+    for ( Clothoid::indexType k = 0 ; k < 4 ; ++k ) {
+      ox[4*i+k] = cx + sa[k]*a*ux - sb[k]*b*uy ;
+      oy[4*i+k] = cy + sa[k]*a*uy + sb[k]*b*ux ;
+    }
+    sweep.addPolygon( 4, &ox[4*i], &oy[4*i] ) ;
+  }
+  clock_t t0 = clock() ;
+  sweep.build() ;
+  clock_t t1 = clock() ;
+  cout << "obstacles: " << nobs << " boxes, build " << 1e3*(t1-t0)/CLOCKS_PER_SEC << " ms\n" ;
+
+  std::vector<Clothoid::ClothoidCurve> path ;
+  for ( Clothoid::indexType i = 0 ; i < 2000 ; ++i )
+    path.push_back( Clothoid::ClothoidCurve( 400*(rnd()-0.5), 400*(rnd()-0.5), 2*m_pi*rnd(),
+                                             0.2*(rnd()-0.5), 0.02*(rnd()-0.5), 40 ) ) ;
+
+  // reference: the two sides of the vehicle against the edges of the boxes
+  std::vector<Clothoid::ClothoidCurve> edges ;
+  for ( Clothoid::indexType i = 0 ; i < nobs ; ++i ) {
+    for ( Clothoid::indexType k = 0 ; k < 4 ; ++k ) {
+      Clothoid::indexType j = 4*i+(k+1)%4 ;
+      Clothoid::valueType dx = ox[j]-ox[4*i+k], dy = oy[j]-oy[4*i+k] ;
+      edges.push_back( Clothoid::ClothoidCurve( ox[4*i+k], oy[4*i+k], atan2(dy,dx),
+                                                0, 0, hypot(dx,dy) ) ) ;
+    }
+  }
+  Clothoid::indexType nhit = 0, nref = 200 ;
+  std::vector<bool> ref_hit(nref) ;
+  t0 = clock() ;
+  for ( Clothoid::indexType i = 0 ; i < nref ; ++i ) {
+    bool hit = false ;
+    for ( size_t k = 0 ; k < edges.size() && !hit ; ++k )
+      hit = path[i].approsimate_collision( -w/2, edges[k], 0, m_pi/16, 100 ) ||
+            path[i].approsimate_collision(  w/2, edges[k], 0, m_pi/16, 100 ) ;
+    ref_hit[i] = hit ;
+    if ( hit ) ++nhit ;
+  }
+  t1 = clock() ;
+  cout << "approsimate_collision of the sides: " << 1e3*(t1-t0)/CLOCKS_PER_SEC
+       << " ms (" << nhit << " collisions in the first " << nref << " paths)\n" ;
+
+  std::vector<Clothoid::valueType> s(path.size()) ;
+  std::vector<Clothoid::indexType> ip(path.size()) ;
+  std::vector<bool>                hit(path.size()) ;
+  nhit = 0 ;
+  t0 = clock() ;
+  for ( size_t i = 0 ; i < path.size() ; ++i ) {
+    hit[i] = sweep.firstContact( path[i], -w/2, w/2, s[i], ip[i] ) ;
+    if ( hit[i] ) ++nhit ;
+  }
+  t1 = clock() ;
+  cout << "ClothoidSweep::firstContact:        " << 1e3*(t1-t0)/CLOCKS_PER_SEC
+       << " ms (" << nhit << " collisions, "
+       << 1e6*(t1-t0)/CLOCKS_PER_SEC/path.size() << " us per query, "
+       << count( hit.begin(), hit.begin()+nref, true ) << " in the first "
+       << nref << " paths)\n" ;
+  Clothoid::indexType nref_diff = 0 ;
+  for ( Clothoid::indexType i = 0 ; i < nref ; ++i )
+    if ( hit[i] != ref_hit[i] ) ++nref_diff ;
+  cout << "paths with a result different from approsimate_collision: " << nref_diff << '\n' ;
+
+  // check with dense sampling of the cross sections, only the boxes near the path
+  Clothoid::valueType h = 0.01 ;
+  Clothoid::indexType nmiss = 0, nlate = 0, nfar = 0 ;
+  std::vector<Clothoid::indexType> near ;
+  for ( size_t i = 0 ; i < path.size() ; ++i ) {
+    Clothoid::valueType x, y ;
+    path[i].eval( 0, x, y ) ;
+    near.clear() ;
+    for ( Clothoid::indexType k = 0 ; k < nobs ; ++k )
+      if ( hypot( ox[4*k]-x, oy[4*k]-y ) < 40+w+10 ) near.push_back( k ) ;
+    Clothoid::valueType s_first = HUGE_VAL ;
+    for ( Clothoid::valueType ss = 0 ; ss <= 40 && s_first == HUGE_VAL ; ss += h ) {
+      Clothoid::valueType x0, y0, x1, y1 ;
+      path[i].eval( ss, -w/2, x0, y0 ) ;
+      path[i].eval( ss,  w/2, x1, y1 ) ;
+      for ( size_t k = 0 ; k < near.size() ; ++k )
+        if ( segmentHit( x0, y0, x1, y1, &ox[4*near[k]], &oy[4*near[k]], 4 ) ) { s_first = ss ; break ; }
+    }
+    if ( s_first < HUGE_VAL && !hit[i] )     ++nmiss ;
+    else if ( hit[i] && s[i] > s_first+1e-8 ) ++nlate ;
+    else if ( hit[i] && s[i] < s_first-h )   ++nfar ;
+  }
+  cout << "sampling every " << h << ": " << nmiss << " missed, " << nlate
+       << " later, " << nfar << " earlier by more than the step\n" ;
+
+  // costmap of the footprints on a 200x200 m grid of 0.2 m cells
+  Clothoid::valueType cell = 0.2 ;
+  Clothoid::indexType nx = 1000, ny = 1000, ncurves = 500 ;
+  Clothoid::ClothoidRaster raster( -100, -100, cell, nx, ny ) ;
+  std::vector<Clothoid::ClothoidCurve> band( path.begin(), path.begin()+ncurves ) ;
+  std::vector<unsigned char> g_stamp( nx*ny, 0 ), g_dense( nx*ny, 0 ),
+                             g_raster( nx*ny, 0 ), g_par( nx*ny, 0 ) ;
+
+  // stamp the cells of the points of the band sampled with step `hs`
+  Clothoid::valueType hs[2] = { cell/2, cell/10 } ;
+  unsigned char     * gs[2] = { &g_stamp.front(), &g_dense.front() } ;
+  for ( Clothoid::indexType l = 0 ; l < 2 ; ++l ) {
+    t0 = clock() ;
+    for ( size_t i = 0 ; i < band.size() ; ++i ) {
+      for ( Clothoid::valueType ss = 0 ; ss <= 40 ; ss += hs[l] ) {
+        Clothoid::valueType x, y, th, k ;
+        band[i].eval( ss, th, k, x, y ) ;
+        for ( Clothoid::valueType o = -w/2 ; o <= w/2 ; o += hs[l] ) {
+          Clothoid::valueType ix = floor( (x-o*sin(th)+100)/cell ) ;
+          Clothoid::valueType iy = floor( (y+o*cos(th)+100)/cell ) ;
+          if ( ix >= 0 && ix < nx && iy >= 0 && iy < ny ) gs[l][int(ix)+int(iy)*nx] = 1 ;
+        }
+      }
+    }
+    t1 = clock() ;
+    cout << "point stamping, step " << hs[l] << ": " << 1e3*(t1-t0)/CLOCKS_PER_SEC << " ms\n" ;
+  }
+  t0 = clock() ;
+  for ( size_t i = 0 ; i < band.size() ; ++i )
+    raster.rasterize( band[i], -w/2, w/2, &g_raster.front() ) ;
+  t1 = clock() ;
+  cout << "ClothoidRaster::rasterize:  " << 1e3*(t1-t0)/CLOCKS_PER_SEC << " ms\n" ;
+  t0 = clock() ;
+  raster.rasterize( band, -w/2, w/2, &g_par.front() ) ;
+  t1 = clock() ;
+  cout << "ClothoidRaster::rasterize of " << band.size() << " curves: "
+       << 1e3*(t1-t0)/CLOCKS_PER_SEC << " ms cpu time\n" ;
+
+  Clothoid::indexType n_dense = 0, n_stamp = 0, n_raster = 0, n_missed = 0, n_diff = 0 ;
+  for ( Clothoid::indexType i = 0 ; i < nx*ny ; ++i ) {
+    n_dense  += g_dense[i] ;
+    n_raster += g_raster[i] ;
+    if ( g_dense[i] && !g_stamp[i] ) ++n_stamp ;
+    if ( g_dense[i] && !g_raster[i] ) ++n_missed ;
+    if ( g_par[i] != g_raster[i] ) ++n_diff ;
+  }
+  cout << "cells: " << n_dense << " dense stamping, " << n_raster << " raster, "
+       << n_stamp << " missed by stamping, " << n_missed << " missed by raster, "
+       << n_diff << " different in parallel\n" ;
+  return nref_diff+nmiss+nlate+n_missed+n_diff > 0 ? 1 : 0 ;
+}